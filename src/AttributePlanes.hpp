@@ -0,0 +1,80 @@
+
+#ifndef ATTRIBUTE_PLANES_HPP
+#define ATTRIBUTE_PLANES_HPP
+
+#include <stdint.h>
+#include <glm/glm.hpp>
+
+
+// A triangle's N attributes (its varyings) as planes in raster space.
+// Attribute i at pixel (x, y) is
+//
+//     value[i] + dx[i] * (x - origin.x) + dy[i] * (y - origin.y)
+//
+// The attributes must already be divided by w, which makes them linear in
+// screen space, and are multiplied by the pixel's w when they are used.
+template <uint32_t N>
+struct AttributePlanes
+{
+    glm::vec2 origin;
+    float value[N];
+    float dx[N];
+    float dy[N];
+};
+
+
+// Fits the first count planes through the triangle's three raster space
+// positions, which must have some area, and the count attributes each of
+// values points to, one per vertex. The rest are left as they are. The
+// first position is the origin, so the planes are exact there.
+template <uint32_t N>
+void SetupAttributePlanes(const glm::vec2 positions[3], const float* const values[3], uint32_t count, AttributePlanes<N>& rPlanes)
+{
+    const glm::vec2 edge1 = positions[1] - positions[0];
+    const glm::vec2 edge2 = positions[2] - positions[0];
+    const float invArea = 1.0f / (edge1.x * edge2.y - edge2.x * edge1.y);
+
+    rPlanes.origin = positions[0];
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const float delta1 = values[1][i] - values[0][i];
+        const float delta2 = values[2][i] - values[0][i];
+        rPlanes.value[i] = values[0][i];
+        rPlanes.dx[i] = (delta1 * edge2.y - delta2 * edge1.y) * invArea;
+        rPlanes.dy[i] = (delta2 * edge1.x - delta1 * edge2.x) * invArea;
+    }
+}
+
+
+// Attributes first to last - 1 at pixel (x, y). The others are left as they are.
+template <uint32_t N>
+void InterpolatePixel(const AttributePlanes<N>& planes, uint32_t first, uint32_t last, uint32_t x, uint32_t y, float rValues[N])
+{
+    const float offsetX = static_cast<float>(x) - planes.origin.x;
+    const float offsetY = static_cast<float>(y) - planes.origin.y;
+    for (uint32_t i = first; i < last; i++)
+    {
+        rValues[i] = planes.value[i] + planes.dx[i] * offsetX + planes.dy[i] * offsetY;
+    }
+}
+
+
+// Attributes first to last - 1 of a 2x2 quad offset pixels to the right of
+// a pixel whose attributes are start, as InterpolatePixel gives them, in the
+// order top left, top right, bottom left, bottom right. Everything is a step
+// away from start, so a row of quads only evaluates the planes once.
+template <uint32_t N>
+void InterpolateQuad(const AttributePlanes<N>& planes, uint32_t first, uint32_t last, const float start[N], uint32_t offset, float rValues[4][N])
+{
+    const float steps = static_cast<float>(offset);
+    for (uint32_t i = first; i < last; i++)
+    {
+        rValues[0][i] = start[i] + planes.dx[i] * steps;
+        rValues[1][i] = rValues[0][i] + planes.dx[i];
+        rValues[2][i] = rValues[0][i] + planes.dy[i];
+        rValues[3][i] = rValues[2][i] + planes.dx[i];
+    }
+}
+
+
+#endif
@@ -0,0 +1,93 @@
+
+#include <cmath>
+#include <limits>
+
+#include "Bounds.hpp"
+
+
+BoundingBox ComputeBounds(const VertexBuffer& vertices)
+{
+    BoundingBox bounds {
+        glm::vec3 { std::numeric_limits<float>::infinity() },
+        glm::vec3 { -std::numeric_limits<float>::infinity() }
+    };
+    const float* pX = vertices.GetStream(VertexStream::PositionX);
+    const float* pY = vertices.GetStream(VertexStream::PositionY);
+    const float* pZ = vertices.GetStream(VertexStream::PositionZ);
+    for (uint32_t i = 0; i < vertices.GetVertexCount(); i++)
+    {
+        const glm::vec3 position { pX[i], pY[i], pZ[i] };
+        bounds.minimum = glm::min(bounds.minimum, position);
+        bounds.maximum = glm::max(bounds.maximum, position);
+    }
+    return bounds;
+}
+
+
+BoundingBox TransformBounds(const BoundingBox& bounds, const glm::mat4& matrix)
+{
+    // Each axis of the box is moved to a column of the matrix, and
+    // the new half size is the sum of their absolute values.
+    const glm::vec3 center { matrix * glm::vec4 { bounds.GetCenter(), 1.0f } };
+    const glm::vec3 halfSize = (bounds.maximum - bounds.minimum) * 0.5f;
+    const glm::vec3 newHalfSize =
+        glm::abs(glm::vec3 { matrix[0] }) * halfSize.x +
+        glm::abs(glm::vec3 { matrix[1] }) * halfSize.y +
+        glm::abs(glm::vec3 { matrix[2] }) * halfSize.z;
+    return { center - newHalfSize, center + newHalfSize };
+}
+
+
+BoundingBox CombineBounds(const BoundingBox& a, const BoundingBox& b)
+{
+    return { glm::min(a.minimum, b.minimum), glm::max(a.maximum, b.maximum) };
+}
+
+
+Frustum ExtractFrustum(const glm::mat4& viewProjectionMatrix)
+{
+    // A point is inside the view volume when -w <= x, y, z <= w in clip
+    // space, and each of those is a dot product with rows of the matrix.
+    auto row = [&viewProjectionMatrix](int i) {
+        return glm::vec4 { viewProjectionMatrix[0][i], viewProjectionMatrix[1][i], viewProjectionMatrix[2][i], viewProjectionMatrix[3][i] };
+    };
+    const glm::vec4 w = row(3);
+
+    Frustum frustum;
+    frustum.planes[0] = w - row(0);
+    frustum.planes[1] = w + row(0);
+    frustum.planes[2] = w - row(1);
+    frustum.planes[3] = w + row(1);
+    frustum.planes[4] = w - row(2);
+    frustum.planes[5] = w + row(2);
+    return frustum;
+}
+
+
+FrustumCoverage ClassifyBounds(const Frustum& frustum, const BoundingBox& bounds, uint8_t& rPlaneMask)
+{
+    const glm::vec3 center = bounds.GetCenter();
+    const glm::vec3 halfSize = (bounds.maximum - bounds.minimum) * 0.5f;
+    for (uint32_t i = 0; i < FRUSTUM_PLANE_COUNT; i++)
+    {
+        if ((rPlaneMask & (1 << i)) == 0)
+        {
+            continue;
+        }
+
+        // Distance of the center, and how far the box reaches towards the plane.
+        const glm::vec4& rPlane = frustum.planes[i];
+        const glm::vec3 normal { rPlane };
+        const float distance = glm::dot(normal, center) + rPlane.w;
+        const float reach = glm::dot(glm::abs(normal), halfSize);
+        if (distance + reach < 0.0f)
+        {
+            return FrustumCoverage::Outside;
+        }
+        if (distance - reach >= 0.0f)
+        {
+            rPlaneMask &= ~(1 << i);
+        }
+    }
+    return rPlaneMask == 0 ? FrustumCoverage::Inside : FrustumCoverage::Partial;
+}
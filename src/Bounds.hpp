@@ -0,0 +1,61 @@
+
+#ifndef BOUNDS_HPP
+#define BOUNDS_HPP
+
+#include <stdint.h>
+#include <glm/glm.hpp>
+
+#include "VertexBuffer.hpp"
+
+
+// Axis aligned. Empty if minimum is greater than maximum.
+struct BoundingBox
+{
+    glm::vec3 minimum;
+    glm::vec3 maximum;
+
+    glm::vec3 GetCenter() const
+    {
+        return (minimum + maximum) * 0.5f;
+    }
+};
+
+// Of the vertices' positions, in model space. Empty if there are none.
+BoundingBox ComputeBounds(const VertexBuffer& vertices);
+
+// A box around the transformed box, which can be a little bigger than
+// the transformed vertices' own bounds.
+BoundingBox TransformBounds(const BoundingBox& bounds, const glm::mat4& matrix);
+
+BoundingBox CombineBounds(const BoundingBox& a, const BoundingBox& b);
+
+
+// The six planes of the view volume, as (normal, distance) with the normals
+// pointing in, so a point p is inside a plane if dot(plane, (p, 1)) >= 0.
+// In the same order as the outcode bits: +x, -x, +y, -y, far, near.
+struct Frustum
+{
+    glm::vec4 planes[6];
+};
+
+const uint32_t FRUSTUM_PLANE_COUNT = 6;
+const uint8_t FRUSTUM_ALL_PLANES = 0x3f;
+
+// The view volume of a projection * view matrix, in world space.
+Frustum ExtractFrustum(const glm::mat4& viewProjectionMatrix);
+
+
+enum class FrustumCoverage
+{
+    Outside,
+    Inside,
+    Partial,
+};
+
+// Tests the box against the planes set in rPlaneMask. Planes it is entirely
+// inside of are cleared from the mask, so that anything inside the box
+// doesn't have to be tested against them again.
+FrustumCoverage ClassifyBounds(const Frustum& frustum, const BoundingBox& bounds, uint8_t& rPlaneMask);
+
+
+#endif
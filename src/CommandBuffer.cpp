@@ -0,0 +1,156 @@
+
+#include <cassert>
+
+#include "Bounds.hpp"
+#include "CommandBuffer.hpp"
+
+
+CommandBuffer::CommandBuffer() :
+    m_Draws {},
+    m_ProjectionMatrix { 1.0 },
+    m_ViewModelMatrix { 1.0 },
+    m_TextureID { 0 },
+    m_SamplerID { 0 },
+    m_FrontFace { FrontFace::Clockwise },
+    m_CullMode { CullMode::Back },
+    m_DepthTest { true },
+    m_DepthWrite { true },
+    m_ColorWrite { true },
+    m_ColorSource { ColorSource::DebugColor },
+    m_BlendMode { BlendMode::Mix },
+    m_InsideFrustum { false }
+{
+}
+
+
+void CommandBuffer::SetProjectionMatrix(const glm::mat4& value)
+{
+    m_ProjectionMatrix = value;
+}
+
+void CommandBuffer::SetViewModelMatrix(const glm::mat4& value)
+{
+    m_ViewModelMatrix = value;
+}
+
+void CommandBuffer::UseTexture(uint32_t id)
+{
+    m_TextureID = id;
+}
+
+void CommandBuffer::UseSampler(uint32_t id)
+{
+    m_SamplerID = id;
+}
+
+void CommandBuffer::SetFrontFace(FrontFace value)
+{
+    m_FrontFace = value;
+}
+
+void CommandBuffer::SetCullMode(CullMode value)
+{
+    m_CullMode = value;
+}
+
+void CommandBuffer::SetDepthTest(bool value)
+{
+    m_DepthTest = value;
+}
+
+void CommandBuffer::SetDepthWrite(bool value)
+{
+    m_DepthWrite = value;
+}
+
+void CommandBuffer::SetColorWrite(bool value)
+{
+    m_ColorWrite = value;
+}
+
+void CommandBuffer::SetColorSource(ColorSource value)
+{
+    m_ColorSource = value;
+}
+
+void CommandBuffer::SetBlendMode(BlendMode value)
+{
+    m_BlendMode = value;
+}
+
+void CommandBuffer::SetInsideFrustum(bool value)
+{
+    m_InsideFrustum = value;
+}
+
+
+// Bounds are worked out once here, rather than every time the draw is sorted.
+void CommandBuffer::DrawTriangleList(const VertexBuffer& vertices)
+{
+    DrawTriangleList(vertices, ComputeBounds(vertices));
+}
+
+void CommandBuffer::DrawIndexedTriangles(const VertexBuffer& vertices, const std::vector<uint16_t>& indices)
+{
+    DrawIndexedTriangles(vertices, indices, ComputeBounds(vertices));
+}
+
+void CommandBuffer::DrawIndexedTriangles(const VertexBuffer& vertices, const std::vector<uint32_t>& indices)
+{
+    DrawIndexedTriangles(vertices, indices, ComputeBounds(vertices));
+}
+
+
+void CommandBuffer::DrawTriangleList(const VertexBuffer& vertices, const BoundingBox& bounds)
+{
+    Record(DrawType::TriangleList, vertices, nullptr, nullptr, bounds);
+}
+
+void CommandBuffer::DrawIndexedTriangles(const VertexBuffer& vertices, const std::vector<uint16_t>& indices, const BoundingBox& bounds)
+{
+    assert(indices.size() % 3 == 0);
+    Record(DrawType::Indexed16, vertices, &indices, nullptr, bounds);
+}
+
+void CommandBuffer::DrawIndexedTriangles(const VertexBuffer& vertices, const std::vector<uint32_t>& indices, const BoundingBox& bounds)
+{
+    assert(indices.size() % 3 == 0);
+    Record(DrawType::Indexed32, vertices, nullptr, &indices, bounds);
+}
+
+
+void CommandBuffer::Reset()
+{
+    m_Draws.clear();
+    m_ProjectionMatrix = glm::mat4 { 1.0 };
+    m_ViewModelMatrix = glm::mat4 { 1.0 };
+    m_TextureID = 0;
+    m_SamplerID = 0;
+    m_FrontFace = FrontFace::Clockwise;
+    m_CullMode = CullMode::Back;
+    m_DepthTest = true;
+    m_DepthWrite = true;
+    m_ColorWrite = true;
+    m_ColorSource = ColorSource::DebugColor;
+    m_BlendMode = BlendMode::Mix;
+    m_InsideFrustum = false;
+}
+
+
+const std::vector<DrawCommand>& CommandBuffer::GetDraws() const
+{
+    return m_Draws;
+}
+
+
+void CommandBuffer::Record(DrawType type, const VertexBuffer& vertices, const std::vector<uint16_t>* pIndices16, const std::vector<uint32_t>* pIndices32, const BoundingBox& bounds)
+{
+    const glm::vec3 center = vertices.GetVertexCount() == 0 ? glm::vec3 { 0.0f } : bounds.GetCenter();
+
+    m_Draws.push_back({
+        type, &vertices, pIndices16, pIndices32,
+        m_ProjectionMatrix, m_ViewModelMatrix, m_TextureID, m_SamplerID,
+        m_FrontFace, m_CullMode, m_DepthTest, m_DepthWrite, m_ColorWrite,
+        m_ColorSource, m_BlendMode, center, m_InsideFrustum
+    });
+}
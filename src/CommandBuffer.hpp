@@ -0,0 +1,140 @@
+
+#ifndef COMMAND_BUFFER_HPP
+#define COMMAND_BUFFER_HPP
+
+#include <stdint.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "Bounds.hpp"
+#include "RasterState.hpp"
+#include "VertexBuffer.hpp"
+
+
+enum class DrawType
+{
+    TriangleList,
+    Indexed16,
+    Indexed32,
+};
+
+
+// A draw, with a copy of the state it was recorded with.
+struct DrawCommand
+{
+    DrawType type;
+    const VertexBuffer* pVertices;
+    const std::vector<uint16_t>* pIndices16;
+    const std::vector<uint32_t>* pIndices32;
+
+    glm::mat4 projectionMatrix;
+    glm::mat4 viewModelMatrix;
+    uint32_t textureID;
+    uint32_t samplerID;
+    FrontFace frontFace;
+    CullMode cullMode;
+    bool depthTest;
+    bool depthWrite;
+    bool colorWrite;
+    ColorSource colorSource;
+    BlendMode blendMode;
+
+    // The middle of the vertices' bounding box, in model space,
+    // for sorting draws by how far away they are.
+    glm::vec3 center;
+
+    // Known to be entirely inside the view volume, so never clipped.
+    bool insideFrustum;
+};
+
+
+// How SoftwareRenderer::Submit runs a command buffer.
+struct SubmitOptions
+{
+    // Goes in front of each draw's view-model matrix, so that scenery can be
+    // recorded once with just its model matrices and then replayed from
+    // wherever the camera is.
+    glm::mat4 viewMatrix { 1.0f };
+
+    // Draws opaque things nearest first, so that early-Z throws out more of
+    // what's behind them. Alpha tested draws go after all of the opaque ones.
+    bool sortFrontToBack = false;
+
+    // Draws with the same texture and sampler one after another, so that
+    // their texels are still in the cache. Takes priority over depth order.
+    bool groupByTexture = false;
+};
+
+
+// Records draws, and the state they are drawn with, to be drawn later by
+// SoftwareRenderer::Submit, as many times as needed. State starts out as
+// the renderer's does: identity matrices, no texture or sampler, back faces
+// culled, with clockwise front faces, depth and color both tested and
+// written, and debug colors mixed with any texture.
+//
+// Vertex buffers and indices are only referred to, not copied, so they
+// have to outlive the command buffer (or its next Reset).
+class CommandBuffer
+{
+public:
+
+    CommandBuffer();
+
+    void SetProjectionMatrix(const glm::mat4& value);
+    void SetViewModelMatrix(const glm::mat4& value);
+    void UseTexture(uint32_t id);
+    void UseSampler(uint32_t id);
+    void SetFrontFace(FrontFace value);
+    void SetCullMode(CullMode value);
+    void SetDepthTest(bool value);
+    void SetDepthWrite(bool value);
+    void SetColorWrite(bool value);
+    void SetColorSource(ColorSource value);
+    void SetBlendMode(BlendMode value);
+
+    // Promises that the draws which follow are entirely inside the view
+    // volume, so that they can skip clipping. Parts of a draw which
+    // aren't are drawn wrongly.
+    void SetInsideFrustum(bool value);
+
+    void DrawTriangleList(const VertexBuffer& vertices);
+    void DrawIndexedTriangles(const VertexBuffer& vertices, const std::vector<uint16_t>& indices);
+    void DrawIndexedTriangles(const VertexBuffer& vertices, const std::vector<uint32_t>& indices);
+
+    // The same, for vertices whose bounds (from ComputeBounds) are already
+    // known, which saves going through them all again.
+    void DrawTriangleList(const VertexBuffer& vertices, const BoundingBox& bounds);
+    void DrawIndexedTriangles(const VertexBuffer& vertices, const std::vector<uint16_t>& indices, const BoundingBox& bounds);
+    void DrawIndexedTriangles(const VertexBuffer& vertices, const std::vector<uint32_t>& indices, const BoundingBox& bounds);
+
+    // Forgets the draws and puts the state back to how it started.
+    // Keeps its storage, for the next recording.
+    void Reset();
+
+    const std::vector<DrawCommand>& GetDraws() const;
+
+private:
+
+    void Record(DrawType type, const VertexBuffer& vertices, const std::vector<uint16_t>* pIndices16, const std::vector<uint32_t>* pIndices32, const BoundingBox& bounds);
+
+
+    std::vector<DrawCommand> m_Draws;
+
+    glm::mat4 m_ProjectionMatrix;
+    glm::mat4 m_ViewModelMatrix;
+    uint32_t m_TextureID;
+    uint32_t m_SamplerID;
+    FrontFace m_FrontFace;
+    CullMode m_CullMode;
+    bool m_DepthTest;
+    bool m_DepthWrite;
+    bool m_ColorWrite;
+    ColorSource m_ColorSource;
+    BlendMode m_BlendMode;
+    bool m_InsideFrustum;
+
+};
+
+
+#endif
@@ -0,0 +1,174 @@
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+#include "FixedPointRaster.hpp"
+
+
+int64_t SnapToSubpixel(float value, int subpixelBits)
+{
+    return std::llround(value * static_cast<float>(1 << subpixelBits));
+}
+
+
+bool SetupFixedTriangleEdges(
+    int subpixelBits,
+    float x0, float y0, float x1, float y1, float x2, float y2,
+    float oneOverW0, float oneOverW1, float oneOverW2,
+    FixedTriangleEdges& rEdges
+)
+{
+    const int64_t px[3] = { SnapToSubpixel(x0, subpixelBits), SnapToSubpixel(x1, subpixelBits), SnapToSubpixel(x2, subpixelBits) };
+    const int64_t py[3] = { SnapToSubpixel(y0, subpixelBits), SnapToSubpixel(y1, subpixelBits), SnapToSubpixel(y2, subpixelBits) };
+
+    const int64_t area = (px[1] - px[0]) * (py[2] - py[0]) - (py[1] - py[0]) * (px[2] - px[0]);
+    if (area <= 0)
+    {
+        return false;
+    }
+
+    // Same edges as the floating point version: 0 is v0 -> v1,
+    // 1 is v1 -> v2 and 2 is v2 -> v0.
+    for (int i = 0; i < 3; i++)
+    {
+        const int next = (i + 1) % 3;
+        const int64_t dx = px[next] - px[i];
+        const int64_t dy = py[next] - py[i];
+
+        // Top-left fill rule: a pixel exactly on an edge belongs to the
+        // triangle only if that is a top edge (horizontal, with the inside
+        // below it) or a left edge (with the inside to its right). Of two
+        // triangles sharing an edge, exactly one of them gets those pixels.
+        const bool isTopLeft = dy < 0 || (dy == 0 && dx > 0);
+        rEdges.bias[i] = isTopLeft ? 0 : -1;
+
+        rEdges.a[i] = -dy * (int64_t { 1 } << subpixelBits);
+        rEdges.b[i] = dx * (int64_t { 1 } << subpixelBits);
+        rEdges.c[i] = dy * px[i] - dx * py[i] + rEdges.bias[i];
+    }
+
+    rEdges.invArea = (int64_t { 1 } << FIXED_INV_AREA_BITS) / area;
+
+    auto toFixedOneOverW = [](float value) {
+        return std::llround(static_cast<double>(value) * (int64_t { 1 } << FIXED_ONE_OVER_W_BITS));
+    };
+    rEdges.oneOverW0 = toFixedOneOverW(oneOverW0);
+    rEdges.oneOverWDelta1 = toFixedOneOverW(oneOverW1) - rEdges.oneOverW0;
+    rEdges.oneOverWDelta2 = toFixedOneOverW(oneOverW2) - rEdges.oneOverW0;
+
+    // Covered pixels lie between the first pixel at or after the leftmost
+    // vertex and the last one at or before the rightmost.
+    const int64_t subpixelMask = (int64_t { 1 } << subpixelBits) - 1;
+    rEdges.xmin = static_cast<int32_t>((std::min({px[0], px[1], px[2]}) + subpixelMask) >> subpixelBits);
+    rEdges.xmax = static_cast<int32_t>(std::max({px[0], px[1], px[2]}) >> subpixelBits);
+    rEdges.ymin = static_cast<int32_t>((std::min({py[0], py[1], py[2]}) + subpixelMask) >> subpixelBits);
+    rEdges.ymax = static_cast<int32_t>(std::max({py[0], py[1], py[2]}) >> subpixelBits);
+
+    return true;
+}
+
+
+RectCoverage ClassifyRect(const FixedTriangleEdges& edges, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+{
+    bool inside = true;
+    for (int i = 0; i < 3; i++)
+    {
+        const int64_t corner = edges.a[i] * x0 + edges.b[i] * y0 + edges.c[i];
+        const int64_t dx = edges.a[i] * (x1 - x0);
+        const int64_t dy = edges.b[i] * (y1 - y0);
+        const int64_t minimum = corner + std::min<int64_t>(dx, 0) + std::min<int64_t>(dy, 0);
+        const int64_t maximum = corner + std::max<int64_t>(dx, 0) + std::max<int64_t>(dy, 0);
+
+        if (maximum < 0)
+        {
+            return RectCoverage::Outside;
+        }
+        if (minimum < 0)
+        {
+            inside = false;
+        }
+    }
+    return inside ? RectCoverage::Inside : RectCoverage::Partial;
+}
+
+
+float GetNearestDepth(const FixedTriangleEdges& edges, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+{
+    // The same plane RasterRowFixed interpolates 1/w on, without its rounding.
+    const double invArea = std::ldexp(static_cast<double>(edges.invArea), -FIXED_INV_AREA_BITS);
+    double oneOverW = -std::numeric_limits<double>::infinity();
+    for (const uint32_t x : { x0, x1 })
+    {
+        for (const uint32_t y : { y0, y1 })
+        {
+            const int64_t e0 = edges.a[0] * x + edges.b[0] * y + edges.c[0];
+            const int64_t e2 = edges.a[2] * x + edges.b[2] * y + edges.c[2];
+            const double w1 = static_cast<double>(e2 - edges.bias[2]) * invArea;
+            const double w2 = static_cast<double>(e0 - edges.bias[0]) * invArea;
+            oneOverW = std::max(oneOverW, edges.oneOverW0 + w1 * edges.oneOverWDelta1 + w2 * edges.oneOverWDelta2);
+        }
+    }
+
+    // Barycentrics are truncated to FIXED_BARYCENTRIC_BITS, which can
+    // round 1/w either way, and 1/w itself is only ever rounded down.
+    const int64_t deltas = std::abs(edges.oneOverWDelta1) + std::abs(edges.oneOverWDelta2);
+    oneOverW += std::ldexp(static_cast<double>(deltas), -FIXED_BARYCENTRIC_BITS) + 1.0;
+
+    if (oneOverW <= 0.0)
+    {
+        return 0.0f;
+    }
+    return static_cast<float>(1 << FIXED_ONE_OVER_W_BITS) / static_cast<float>(oneOverW);
+}
+
+
+void RasterRowFixed(const FixedTriangleEdges& edges, uint32_t x, uint32_t y, uint64_t activeMask, RasterSpan& rSpan)
+{
+    int64_t e0 = edges.a[0] * x + edges.b[0] * y + edges.c[0];
+    int64_t e1 = edges.a[1] * x + edges.b[1] * y + edges.c[1];
+    int64_t e2 = edges.a[2] * x + edges.b[2] * y + edges.c[2];
+
+    const int barycentricShift = FIXED_INV_AREA_BITS - FIXED_BARYCENTRIC_BITS;
+    const float oneOverWScale = static_cast<float>(1 << FIXED_ONE_OVER_W_BITS);
+    const float invArea = static_cast<float>(edges.invArea) * std::ldexp(1.0f, -FIXED_INV_AREA_BITS);
+
+    uint64_t coverage = 0;
+    const uint32_t count = activeMask == 0 ? 0 : 64 - __builtin_clzll(activeMask);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (((activeMask >> i) & 1) != 0)
+        {
+            // All three are >= 0 exactly when none of their sign bits are set.
+            if ((e0 | e1 | e2) >= 0)
+            {
+                coverage |= uint64_t { 1 } << i;
+
+                const int64_t w1 = ((e2 - edges.bias[2]) * edges.invArea) >> barycentricShift;
+                const int64_t w2 = ((e0 - edges.bias[0]) * edges.invArea) >> barycentricShift;
+                const int64_t oneOverW = edges.oneOverW0 + ((w1 * edges.oneOverWDelta1 + w2 * edges.oneOverWDelta2) >> FIXED_BARYCENTRIC_BITS);
+
+                rSpan.depth[i] = oneOverWScale / static_cast<float>(oneOverW);
+            }
+            else
+            {
+                // Outside the triangle, barycentrics can be big enough to overflow
+                // the multiply above. This depth is only used for texture
+                // derivatives, so floating point is close enough.
+                const float w1 = static_cast<float>(e2 - edges.bias[2]) * invArea;
+                const float w2 = static_cast<float>(e0 - edges.bias[0]) * invArea;
+                const float oneOverW = static_cast<float>(edges.oneOverW0) +
+                    w1 * static_cast<float>(edges.oneOverWDelta1) + w2 * static_cast<float>(edges.oneOverWDelta2);
+
+                rSpan.depth[i] = oneOverWScale / oneOverW;
+            }
+        }
+
+        e0 += edges.a[0];
+        e1 += edges.a[1];
+        e2 += edges.a[2];
+    }
+
+    rSpan.coverage = coverage;
+}
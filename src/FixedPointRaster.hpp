@@ -0,0 +1,78 @@
+
+#ifndef FIXED_POINT_RASTER_HPP
+#define FIXED_POINT_RASTER_HPP
+
+#include <stdint.h>
+
+#include "RasterKernel.hpp"
+
+
+// Barycentric weights are fractions with this many bits.
+const int FIXED_BARYCENTRIC_BITS = 16;
+
+// 1/w is interpolated with this many fractional bits.
+const int FIXED_ONE_OVER_W_BITS = 24;
+
+// Precision of the reciprocal of the triangle's area.
+const int FIXED_INV_AREA_BITS = 62;
+
+
+// Integer version of TriangleEdges, the way the hardware would do it.
+//
+// Vertices are snapped to a grid of 1 / 2^subpixelBits pixels, so edge
+// functions are exact integers and adjacent triangles agree exactly on
+// their shared edges. Edge values are in units of (subpixels)^2, but
+// a and b are the change per whole pixel, so that stepping from one
+// pixel to the next is a single add.
+struct FixedTriangleEdges
+{
+    int64_t a[3];
+    int64_t b[3];
+
+    // Includes the fill rule bias: a pixel is covered if every
+    // E(x, y) = a * x + b * y + c is >= 0.
+    int64_t c[3];
+
+    // 0 for top and left edges, -1 for the others.
+    int64_t bias[3];
+
+    // 2^FIXED_INV_AREA_BITS / area, to turn edge values into barycentrics
+    // with a multiply and shift instead of a divide.
+    int64_t invArea;
+
+    int64_t oneOverW0;
+    int64_t oneOverWDelta1;
+    int64_t oneOverWDelta2;
+
+    // Inclusive bounds of the pixels which might be covered,
+    // from the snapped vertices. Can be empty (min > max).
+    int32_t xmin;
+    int32_t xmax;
+    int32_t ymin;
+    int32_t ymax;
+};
+
+
+// Snaps a raster space coordinate to the subpixel grid, in subpixels.
+int64_t SnapToSubpixel(float value, int subpixelBits);
+
+// Snaps a raster space triangle to the subpixel grid and sets up its edges.
+// Returns false if it has no area (or is back facing) once it is snapped.
+bool SetupFixedTriangleEdges(
+    int subpixelBits,
+    float x0, float y0, float x1, float y1, float x2, float y2,
+    float oneOverW0, float oneOverW1, float oneOverW2,
+    FixedTriangleEdges& rEdges
+);
+
+RectCoverage ClassifyRect(const FixedTriangleEdges& edges, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1);
+float GetNearestDepth(const FixedTriangleEdges& edges, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1);
+
+// Evaluates the pixels of row y set in activeMask, where bit 0 is pixel x.
+// Coverage is exact, and depth (w) is written for every active pixel,
+// covered or not, as a float for the shading code. Varyings come from the
+// triangle's attribute planes.
+void RasterRowFixed(const FixedTriangleEdges& edges, uint32_t x, uint32_t y, uint64_t activeMask, RasterSpan& rSpan);
+
+
+#endif
@@ -0,0 +1,2407 @@
+
+// Microbenchmarks for the pieces of the rasterizer's inner loops.
+// Doesn't need SDL or a window.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <new>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "CommandBuffer.hpp"
+#include "FixedPointRaster.hpp"
+#include "RasterKernel.hpp"
+#include "Scene.hpp"
+#include "SoftwareRenderer.hpp"
+#include "Texture.hpp"
+#include "VertexBuffer.hpp"
+#include "VertexTransform.hpp"
+
+
+// Every heap allocation in the program goes through these,
+// so that allocations can be counted. None of them are inlined,
+// or GCC would see malloc's pointers reach operator delete, or
+// operator new's reach free, and warn that they don't match.
+static std::atomic<uint64_t> heapAllocations { 0 };
+
+__attribute__((noinline)) void* operator new(size_t size)
+{
+    heapAllocations++;
+    void* p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc {};
+    }
+    return p;
+}
+
+__attribute__((noinline)) void* operator new(size_t size, std::align_val_t alignment)
+{
+    heapAllocations++;
+    const size_t align = static_cast<size_t>(alignment);
+    void* p = aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) / align * align);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc {};
+    }
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, std::align_val_t) noexcept
+{
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t, std::align_val_t) noexcept
+{
+    free(p);
+}
+
+
+// Cycle counter where there is one, nanoseconds otherwise.
+static uint64_t ReadCycleCounter()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+#endif
+}
+
+
+struct BenchTriangle
+{
+    float x[3];
+    float y[3];
+    float oneOverW[3];
+};
+
+
+static std::vector<BenchTriangle> MakeTriangles(uint32_t count, float size, std::mt19937& rRandom)
+{
+    std::uniform_real_distribution<float> position { 0.0f, 512.0f };
+    std::uniform_real_distribution<float> offset { -size, size };
+    std::uniform_real_distribution<float> oneOverW { 0.01f, 0.2f };
+
+    std::vector<BenchTriangle> triangles;
+    while (triangles.size() < count)
+    {
+        BenchTriangle triangle;
+        const float cx = position(rRandom);
+        const float cy = position(rRandom);
+        for (int i = 0; i < 3; i++)
+        {
+            triangle.x[i] = std::max(0.0f, cx + offset(rRandom));
+            triangle.y[i] = std::max(0.0f, cy + offset(rRandom));
+            triangle.oneOverW[i] = oneOverW(rRandom);
+        }
+
+        // The rasterizer only draws clockwise (positive area) triangles.
+        const float area =
+            (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) -
+            (triangle.y[1] - triangle.y[0]) * (triangle.x[2] - triangle.x[0]);
+        if (area < 1.0f)
+        {
+            std::swap(triangle.x[1], triangle.x[2]);
+            std::swap(triangle.y[1], triangle.y[2]);
+            std::swap(triangle.oneOverW[1], triangle.oneOverW[2]);
+            if (-area < 1.0f)
+            {
+                continue;
+            }
+        }
+        triangles.push_back(triangle);
+    }
+    return triangles;
+}
+
+
+struct KernelResult
+{
+    uint64_t evaluatedPixels;
+    uint64_t coveredPixels;
+    uint64_t cycles;
+    uint64_t checksum;
+};
+
+
+// Walks each triangle's bounding box in 64x64 tiles, like the renderer does.
+static KernelResult RunKernel(const RasterKernel& kernel, const std::vector<BenchTriangle>& triangles)
+{
+    KernelResult result { 0, 0, 0, 1469598103934665603ull };
+    RasterSpan span;
+
+    const uint64_t start = ReadCycleCounter();
+    for (const auto& rTriangle : triangles)
+    {
+        const TriangleEdges edges = SetupTriangleEdges(
+            rTriangle.x[0], rTriangle.y[0],
+            rTriangle.x[1], rTriangle.y[1],
+            rTriangle.x[2], rTriangle.y[2],
+            rTriangle.oneOverW[0], rTriangle.oneOverW[1], rTriangle.oneOverW[2]
+        );
+
+        const uint32_t xmin = static_cast<uint32_t>(*std::min_element(rTriangle.x, rTriangle.x + 3));
+        const uint32_t xmax = static_cast<uint32_t>(*std::max_element(rTriangle.x, rTriangle.x + 3));
+        const uint32_t ymin = static_cast<uint32_t>(*std::min_element(rTriangle.y, rTriangle.y + 3));
+        const uint32_t ymax = static_cast<uint32_t>(*std::max_element(rTriangle.y, rTriangle.y + 3));
+
+        for (uint32_t spanX = xmin; spanX <= xmax; spanX += RASTER_SPAN_MAX)
+        {
+            const uint32_t spanLength = std::min(xmax - spanX + 1, RASTER_SPAN_MAX);
+            const uint64_t activeMask = spanLength == 64 ? ~uint64_t { 0 } : (uint64_t { 1 } << spanLength) - 1;
+            float rowEdges[3];
+            for (int i = 0; i < 3; i++)
+            {
+                rowEdges[i] = edges.a[i] * static_cast<float>(spanX) + edges.b[i] * static_cast<float>(ymin) + edges.c[i];
+            }
+
+            for (uint32_t y = ymin; y <= ymax; y++)
+            {
+                kernel.function(edges, rowEdges, activeMask, span);
+                for (int i = 0; i < 3; i++)
+                {
+                    rowEdges[i] += edges.b[i];
+                }
+
+                result.evaluatedPixels += spanLength;
+                result.coveredPixels += __builtin_popcountll(span.coverage);
+                result.checksum = (result.checksum ^ span.coverage) * 1099511628211ull;
+            }
+        }
+    }
+    result.cycles = ReadCycleCounter() - start;
+
+    return result;
+}
+
+
+static void BenchRasterKernels()
+{
+    struct SizeClass
+    {
+        const char* name;
+        float size;
+        uint32_t count;
+    };
+    const SizeClass sizeClasses[] = {
+        { "small", 4.0f, 200000 },
+        { "medium", 32.0f, 20000 },
+        { "large", 256.0f, 200 },
+    };
+
+    printf("Raster kernels (pixels per cycle)\n");
+    printf("%-8s %-8s %12s %12s %10s %8s\n", "kernel", "size", "covered/cyc", "tested/cyc", "Mpix", "same");
+
+    std::mt19937 random { 1234 };
+    for (const auto& rSizeClass : sizeClasses)
+    {
+        const auto triangles = MakeTriangles(rSizeClass.count, rSizeClass.size, random);
+
+        const KernelResult reference = RunKernel(GetAvailableRasterKernels().front(), triangles);
+        for (const auto& rKernel : GetAvailableRasterKernels())
+        {
+            // Once to warm up, once to measure.
+            RunKernel(rKernel, triangles);
+            const KernelResult result = RunKernel(rKernel, triangles);
+
+            printf(
+                "%-8s %-8s %12.3f %12.3f %10.2f %8s\n",
+                rKernel.name,
+                rSizeClass.name,
+                static_cast<double>(result.coveredPixels) / static_cast<double>(result.cycles),
+                static_cast<double>(result.evaluatedPixels) / static_cast<double>(result.cycles),
+                static_cast<double>(result.coveredPixels) / 1e6,
+                result.checksum == reference.checksum ? "yes" : "NO"
+            );
+        }
+    }
+    printf("\n");
+}
+
+
+// Transforms a big mesh's positions to clip space, like a draw does.
+// Every kernel has to match glm exactly.
+static void BenchTransformKernels()
+{
+    const uint32_t vertexCount = 1 << 19;
+
+    std::mt19937 random { 4321 };
+    std::uniform_real_distribution<float> position { -10.0f, 10.0f };
+    VertexBuffer vertices;
+    vertices.Resize(vertexCount);
+    for (uint32_t i = 0; i < vertexCount; i++)
+    {
+        vertices.SetVertex(i, { glm::vec3 { position(random), position(random), position(random) }, {}, {} });
+    }
+
+    const glm::mat4 matrix =
+        glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 1.0f, 100.0f) *
+        glm::rotate(glm::translate(glm::mat4 { 1.0f }, { 1.0f, -2.0f, -30.0f }), 0.7f, { 0.3f, 1.0f, 0.0f });
+
+    const float* const pPositions[4] = {
+        vertices.GetStream(VertexStream::PositionX),
+        vertices.GetStream(VertexStream::PositionY),
+        vertices.GetStream(VertexStream::PositionZ),
+        vertices.GetStream(VertexStream::PositionW),
+    };
+    AlignedVector<float> clipPositions[4];
+    for (auto& rStream : clipPositions)
+    {
+        rStream.resize(vertexCount);
+    }
+    float* const pClipPositions[4] = {
+        clipPositions[0].data(),
+        clipPositions[1].data(),
+        clipPositions[2].data(),
+        clipPositions[3].data(),
+    };
+
+    printf("Transform kernels (%u vertices)\n", vertexCount);
+    printf("%-8s %12s %8s\n", "kernel", "cyc/vertex", "same");
+
+    for (const auto& rKernel : GetAvailableTransformKernels())
+    {
+        // Once to warm up, once to measure.
+        rKernel.function(matrix, pPositions, pClipPositions, vertexCount);
+        const uint64_t start = ReadCycleCounter();
+        rKernel.function(matrix, pPositions, pClipPositions, vertexCount);
+        const uint64_t cycles = ReadCycleCounter() - start;
+
+        bool same = true;
+        for (uint32_t i = 0; i < vertexCount; i++)
+        {
+            const glm::vec4 expected = matrix * vertices.GetVertex(i).position;
+            for (int component = 0; component < 4; component++)
+            {
+                same = same && std::memcmp(&expected[component], &pClipPositions[component][i], sizeof(float)) == 0;
+            }
+        }
+
+        printf(
+            "%-8s %12.3f %8s\n",
+            rKernel.name,
+            static_cast<double>(cycles) / static_cast<double>(vertexCount),
+            same ? "yes" : "NO"
+        );
+    }
+    printf("\n");
+}
+
+
+// Walks a screen of screenSize x screenSize pixels over a texture,
+// rotated by angle and with texelsPerPixel texels between pixels,
+// and calls sample(x, y) with the nearest texel for each pixel.
+template <typename Func>
+static void ForEachScreenSample(uint32_t textureSize, uint32_t screenSize, float angle, float texelsPerPixel, Func&& sample)
+{
+    const float scale = texelsPerPixel / static_cast<float>(textureSize);
+    const float du = std::cos(angle) * scale;
+    const float dv = std::sin(angle) * scale;
+    for (uint32_t y = 0; y < screenSize; y++)
+    {
+        for (uint32_t x = 0; x < screenSize; x++)
+        {
+            float u = static_cast<float>(x) * du - static_cast<float>(y) * dv;
+            float v = static_cast<float>(x) * dv + static_cast<float>(y) * du;
+            u -= std::floor(u);
+            v -= std::floor(v);
+            sample(
+                std::min(static_cast<uint32_t>(textureSize * u), textureSize - 1),
+                std::min(static_cast<uint32_t>(textureSize * v), textureSize - 1)
+            );
+        }
+    }
+}
+
+
+// Nearest sampling of a 2k texture across a rotated, magnified screen,
+// the way the shading code walks it. "float" is the old layout, with
+// every channel expanded to a float. Best of a few passes, since misses
+// in a texture this much bigger than the cache vary from pass to pass.
+static void BenchTextureSampling()
+{
+    const uint32_t size = 2048;
+    const uint32_t screenSize = 1024;
+
+    std::mt19937 random { 2468 };
+    std::vector<uint8_t> bgra(size * size * 4);
+    for (auto& rChannel : bgra)
+    {
+        rChannel = static_cast<uint8_t>(random());
+    }
+
+    // Visits the same texels in the same order for every format.
+    auto forEachSample = [](auto&& sample) {
+        ForEachScreenSample(size, screenSize, 0.5f, 3.0f, sample);
+    };
+
+    printf("Texture sampling (%ux%u texture, %u samples)\n", size, size, screenSize * screenSize);
+    printf("%-8s %10s %12s %10s\n", "format", "MiB", "cyc/sample", "checksum");
+
+    auto report = [](const char* name, size_t bytes, uint64_t cycles, float checksum) {
+        printf(
+            "%-8s %10.1f %12.3f %10.1f\n",
+            name,
+            static_cast<double>(bytes) / (1024.0 * 1024.0),
+            static_cast<double>(cycles) / static_cast<double>(screenSize * screenSize),
+            static_cast<double>(checksum)
+        );
+    };
+
+    {
+        std::vector<float> expanded(bgra.size());
+        for (size_t i = 0; i < bgra.size(); i++)
+        {
+            expanded[i] = static_cast<float>(bgra[i]) / static_cast<float>(0xff);
+        }
+
+        float checksum = 0.0f;
+        uint64_t cycles = UINT64_MAX;
+        for (int pass = 0; pass < 5; pass++)
+        {
+            checksum = 0.0f;
+            const uint64_t start = ReadCycleCounter();
+            forEachSample([&](uint32_t x, uint32_t y) {
+                const float* pTexel = &expanded[(y * size + x) * 4];
+                checksum += pTexel[2] + pTexel[1] + pTexel[0] + pTexel[3];
+            });
+            cycles = std::min(cycles, ReadCycleCounter() - start);
+        }
+        report("float", expanded.size() * sizeof(float), cycles, checksum);
+    }
+
+    const std::pair<const char*, TextureFormat> formats[] = {
+        { "rgba8", TextureFormat::RGBA8 },
+        { "rgb565", TextureFormat::RGB565 },
+        { "rgb666", TextureFormat::RGB666 },
+    };
+    for (const auto& rFormat : formats)
+    {
+        std::vector<uint8_t> texels(size * size * GetTexelSize(rFormat.second));
+        ConvertTexels(bgra.data(), size * size, rFormat.second, texels.data());
+        Texture texture { 0, 0, rFormat.second, TextureLayout::Linear, 0, {}, 1.0f, {} };
+        StoreTexels(texture, size, size, texels.data(), false);
+
+        float checksum = 0.0f;
+        uint64_t cycles = UINT64_MAX;
+        for (int pass = 0; pass < 5; pass++)
+        {
+            checksum = 0.0f;
+            const uint64_t start = ReadCycleCounter();
+            forEachSample([&](uint32_t x, uint32_t y) {
+                const glm::vec4 texel = FetchTexel(texture, 0, x, y);
+                checksum += texel.r + texel.g + texel.b + texel.a;
+            });
+            cycles = std::min(cycles, ReadCycleCounter() - start);
+        }
+        report(rFormat.first, texture.data.size(), cycles, checksum);
+    }
+    printf("\n");
+}
+
+
+// A small set associative cache with LRU replacement, roughly an L1 data
+// cache, to count the misses a sequence of texel reads would cause.
+class CacheModel
+{
+public:
+
+    CacheModel() :
+        m_Tags(SET_COUNT * WAY_COUNT, UINT64_MAX),
+        m_Misses {0}
+    {
+    }
+
+    void Access(const void* pAddress)
+    {
+        const uint64_t line = reinterpret_cast<uintptr_t>(pAddress) / LINE_SIZE;
+        uint64_t* pSet = &m_Tags[(line % SET_COUNT) * WAY_COUNT];
+
+        // Ways are kept from most to least recently used.
+        uint32_t way = 0;
+        while (way < WAY_COUNT && pSet[way] != line)
+        {
+            way++;
+        }
+        if (way == WAY_COUNT)
+        {
+            m_Misses++;
+            way = WAY_COUNT - 1;
+        }
+        std::move_backward(pSet, pSet + way, pSet + way + 1);
+        pSet[0] = line;
+    }
+
+    uint64_t GetMisses() const
+    {
+        return m_Misses;
+    }
+
+private:
+
+    static const uint32_t LINE_SIZE = 64;
+    static const uint32_t WAY_COUNT = 8;
+    static const uint32_t SET_COUNT = 32 * 1024 / (LINE_SIZE * WAY_COUNT);
+
+    std::vector<uint64_t> m_Tags;
+    uint64_t m_Misses;
+};
+
+
+// Sampling an RGBA8 2k texture one texel per pixel, at different angles,
+// with each layout. Misses are from CacheModel, not the real cache.
+static void BenchTextureLayouts()
+{
+    const uint32_t size = 2048;
+    const uint32_t screenSize = 1024;
+
+    std::mt19937 random { 1357 };
+    std::vector<uint8_t> bgra(size * size * 4);
+    for (auto& rChannel : bgra)
+    {
+        rChannel = static_cast<uint8_t>(random());
+    }
+
+    const std::pair<const char*, TextureLayout> layouts[] = {
+        { "linear", TextureLayout::Linear },
+        { "tiled", TextureLayout::Tiled },
+    };
+    Texture textures[2] = {
+        { 0, 0, TextureFormat::RGBA8, TextureLayout::Linear, 0, {}, 1.0f, {} },
+        { 0, 0, TextureFormat::RGBA8, TextureLayout::Tiled, 0, {}, 1.0f, {} },
+    };
+    for (auto& rTexture : textures)
+    {
+        StoreTexels(rTexture, size, size, bgra.data(), false);
+    }
+
+    printf("Texture layouts (%ux%u rgba8 texture, %u samples)\n", size, size, screenSize * screenSize);
+    printf("%-8s %6s %12s %12s %10s\n", "layout", "angle", "cyc/sample", "miss/sample", "checksum");
+
+    for (int degrees = 0; degrees <= 90; degrees += 30)
+    {
+        const float angle = glm::radians(static_cast<float>(degrees));
+        for (uint32_t i = 0; i < 2; i++)
+        {
+            const Texture& texture = textures[i];
+
+            CacheModel cache;
+            ForEachScreenSample(size, screenSize, angle, 1.0f, [&](uint32_t x, uint32_t y) {
+                cache.Access(GetTexelPointer(texture, 0, x, y));
+            });
+
+            float checksum = 0.0f;
+            uint64_t cycles = 0;
+            for (int pass = 0; pass < 2; pass++)
+            {
+                checksum = 0.0f;
+                const uint64_t start = ReadCycleCounter();
+                ForEachScreenSample(size, screenSize, angle, 1.0f, [&](uint32_t x, uint32_t y) {
+                    const glm::vec4 texel = FetchTexel(texture, 0, x, y);
+                    checksum += texel.r + texel.g + texel.b + texel.a;
+                });
+                cycles = ReadCycleCounter() - start;
+            }
+
+            const double samples = static_cast<double>(screenSize * screenSize);
+            printf(
+                "%-8s %6d %12.3f %12.4f %10.1f\n",
+                layouts[i].first,
+                degrees,
+                static_cast<double>(cycles) / samples,
+                static_cast<double>(cache.GetMisses()) / samples,
+                static_cast<double>(checksum)
+            );
+        }
+    }
+    printf("\n");
+}
+
+
+// A far away, rotated 2k texture, 12 texels to a pixel, sampled from the
+// base level and with each mip filter. Counts how much of the texture's
+// memory is read, in cache lines.
+static void BenchTextureMipmaps()
+{
+    const uint32_t size = 2048;
+    const uint32_t screenSize = 128;
+    const float texelsPerPixel = 12.0f;
+
+    std::mt19937 random { 8642 };
+    std::vector<uint8_t> bgra(size * size * 4);
+    for (auto& rChannel : bgra)
+    {
+        rChannel = static_cast<uint8_t>(random());
+    }
+
+    Texture texture { 0, 0, TextureFormat::RGBA8, TextureLayout::Tiled, 0, {}, 1.0f, {} };
+    StoreTexels(texture, size, size, bgra.data(), true);
+
+    // Pixels are a constant distance apart in the texture, so every quad has the same level of detail.
+    const float angle = 0.4f;
+    const float step = texelsPerPixel / static_cast<float>(size);
+    const glm::vec2 texcoordsDx { std::cos(angle) * step, std::sin(angle) * step };
+    const glm::vec2 texcoordsDy { -texcoordsDx.y, texcoordsDx.x };
+    const float lod = ComputeTextureLod(texture, texcoordsDx, texcoordsDy);
+
+    printf("Texture mipmaps (%ux%u rgba8 texture, %u levels, %u samples, lod %.2f)\n", size, size, texture.levelCount, screenSize * screenSize, static_cast<double>(lod));
+    printf("%-8s %12s %12s %10s\n", "filter", "cyc/sample", "KiB read", "checksum");
+
+    const std::pair<const char*, MipFilter> filters[] = {
+        { "none", MipFilter::None },
+        { "nearest", MipFilter::Nearest },
+        { "linear", MipFilter::Linear },
+    };
+    for (const auto& rFilter : filters)
+    {
+        SamplerState sampler;
+        sampler.mipFilter = rFilter.second;
+
+        std::vector<bool> linesRead(texture.data.size() / 64 + 1);
+        float checksum = 0.0f;
+        uint64_t cycles = 0;
+        for (int pass = 0; pass < 2; pass++)
+        {
+            checksum = 0.0f;
+            const uint64_t start = ReadCycleCounter();
+            ForEachScreenSample(size, screenSize, angle, texelsPerPixel, [&](uint32_t x, uint32_t y) {
+                const float u = (static_cast<float>(x) + 0.5f) / static_cast<float>(size);
+                const float v = (static_cast<float>(y) + 0.5f) / static_cast<float>(size);
+                const glm::vec4 texel = SampleTexture(texture, sampler, { u, v }, lod);
+                checksum += texel.r + texel.g + texel.b + texel.a;
+            });
+            cycles = ReadCycleCounter() - start;
+        }
+
+        // Again, for the addresses: the same levels SampleTexture picks.
+        const float clampedLod = std::min(lod, static_cast<float>(texture.levelCount - 1));
+        uint32_t levels[2] = { 0, 0 };
+        if (rFilter.second == MipFilter::Nearest)
+        {
+            levels[0] = levels[1] = static_cast<uint32_t>(clampedLod + 0.5f);
+        }
+        else if (rFilter.second == MipFilter::Linear)
+        {
+            levels[0] = static_cast<uint32_t>(clampedLod);
+            levels[1] = std::min(levels[0] + 1, texture.levelCount - 1);
+        }
+        ForEachScreenSample(size, screenSize, angle, texelsPerPixel, [&](uint32_t x, uint32_t y) {
+            const float u = (static_cast<float>(x) + 0.5f) / static_cast<float>(size);
+            const float v = (static_cast<float>(y) + 0.5f) / static_cast<float>(size);
+            for (uint32_t level : levels)
+            {
+                const TextureLevel& rLevel = texture.levels[level];
+                const uint32_t levelX = static_cast<uint32_t>(std::floor(u * static_cast<float>(rLevel.width))) & (rLevel.width - 1);
+                const uint32_t levelY = static_cast<uint32_t>(std::floor((1.0f - v) * static_cast<float>(rLevel.height))) & (rLevel.height - 1);
+                linesRead[(GetTexelPointer(texture, level, levelX, levelY) - texture.data.data()) / 64] = true;
+            }
+        });
+
+        printf(
+            "%-8s %12.3f %12.1f %10.1f\n",
+            rFilter.first,
+            static_cast<double>(cycles) / static_cast<double>(screenSize * screenSize),
+            static_cast<double>(std::count(linesRead.begin(), linesRead.end(), true) * 64) / 1024.0,
+            static_cast<double>(checksum)
+        );
+    }
+    printf("\n");
+}
+
+
+// Sampling a texture across a rotated screen with texture coordinates
+// running from about -1.5 to 1.5, so they wrap. "fmod" is how textures
+// used to be addressed: fmod and a fix up for negatives in each direction,
+// then nearest sampling. The others sample 2x2 quads with a sampler picked
+// once, the way a draw does, except "repeat any", which goes through
+// SampleTexture for every sample. The texture stays in cache, so this is
+// the cost of addressing and filtering rather than of memory.
+static void BenchTextureSamplers()
+{
+    const uint32_t size = 256;
+    const uint32_t screenSize = 1024;
+
+    std::mt19937 random { 9753 };
+    std::vector<uint8_t> bgra(size * size * 4);
+    for (auto& rChannel : bgra)
+    {
+        rChannel = static_cast<uint8_t>(random());
+    }
+
+    Texture texture { 0, 0, TextureFormat::RGBA8, TextureLayout::Tiled, 0, {}, 1.0f, {} };
+    StoreTexels(texture, size, size, bgra.data(), false);
+
+    // Each quad's texture coordinates, row by row.
+    auto forEachQuad = [](auto&& sample) {
+        const float angle = 0.3f;
+        const float step = 3.0f / static_cast<float>(screenSize);
+        const glm::vec2 dx { std::cos(angle) * step, std::sin(angle) * step };
+        const glm::vec2 dy { -dx.y, dx.x };
+        const glm::vec2 origin { -1.5f, -1.5f };
+        for (uint32_t y = 0; y < screenSize; y += 2)
+        {
+            for (uint32_t x = 0; x < screenSize; x += 2)
+            {
+                const glm::vec2 topLeft = origin + static_cast<float>(x) * dx + static_cast<float>(y) * dy;
+                const glm::vec2 texcoords[4] = { topLeft, topLeft + dx, topLeft + dy, topLeft + dx + dy };
+                sample(texcoords);
+            }
+        }
+    };
+
+    printf("Texture samplers (%ux%u rgba8 texture, %u samples)\n", size, size, screenSize * screenSize);
+    printf("%-16s %12s %10s\n", "sampler", "cyc/sample", "checksum");
+
+    // The fastest of a few passes. Sums per channel, so that
+    // adding up the checksum doesn't hold up the next sample.
+    auto run = [&](const char* name, auto&& sampleQuad) {
+        glm::vec4 sum {};
+        uint64_t cycles = UINT64_MAX;
+        for (int pass = 0; pass < 8; pass++)
+        {
+            sum = {};
+            const uint64_t start = ReadCycleCounter();
+            forEachQuad([&](const glm::vec2 texcoords[]) {
+                glm::vec4 texels[4];
+                sampleQuad(texcoords, texels);
+                sum += (texels[0] + texels[1]) + (texels[2] + texels[3]);
+            });
+            cycles = std::min(cycles, ReadCycleCounter() - start);
+        }
+        printf(
+            "%-16s %12.3f %10.1f\n",
+            name,
+            static_cast<double>(cycles) / static_cast<double>(screenSize * screenSize),
+            static_cast<double>(sum.r + sum.g + sum.b + sum.a)
+        );
+    };
+
+    run("fmod", [&](const glm::vec2 texcoords[], glm::vec4 texels[]) {
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            float u = std::fmod(texcoords[i].x, 1.0f);
+            float v = std::fmod(texcoords[i].y, 1.0f);
+            if (u < 0)
+            {
+                u += 1.0f;
+            }
+            if (v < 0)
+            {
+                v += 1.0f;
+            }
+            const uint32_t x = std::min(static_cast<uint32_t>(texture.width * u), texture.width - 1);
+            const uint32_t y = std::min(static_cast<uint32_t>(texture.height * (1.0 - v)), texture.height - 1);
+            texels[i] = FetchTexel(texture, 0, x, y);
+        }
+    });
+
+    const std::pair<const char*, SamplerState> samplers[] = {
+        { "repeat", { TextureWrap::Repeat, TextureWrap::Repeat, TextureFilter::Nearest, MipFilter::None } },
+        { "mirror", { TextureWrap::MirroredRepeat, TextureWrap::MirroredRepeat, TextureFilter::Nearest, MipFilter::None } },
+        { "clamp", { TextureWrap::ClampToEdge, TextureWrap::ClampToEdge, TextureFilter::Nearest, MipFilter::None } },
+        { "repeat bilinear", { TextureWrap::Repeat, TextureWrap::Repeat, TextureFilter::Bilinear, MipFilter::None } },
+    };
+    for (const auto& rSampler : samplers)
+    {
+        const SampleQuadFunction sampleQuad = GetSampleQuadFunction(texture, rSampler.second);
+        run(rSampler.first, [&](const glm::vec2 texcoords[], glm::vec4 texels[]) {
+            sampleQuad(texture, rSampler.second, texcoords, 0.0f, 0xf, texels);
+        });
+    }
+    run("repeat any", [&](const glm::vec2 texcoords[], glm::vec4 texels[]) {
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            texels[i] = SampleTexture(texture, samplers[0].second, texcoords[i], 0.0f);
+        }
+    });
+    printf("\n");
+}
+
+
+// Long, thin, diagonal triangles are the worst case for a bounding box
+// scan. Shows how much of that the block and quad tests skip.
+static void BenchSkinnyTriangles()
+{
+    const uint32_t frameSize = 1024;
+    SoftwareRenderer renderer { frameSize, frameSize };
+
+    std::vector<Vertex> triangles;
+    std::mt19937 random { 5678 };
+    std::uniform_real_distribution<float> position { -0.9f, 0.9f };
+    std::uniform_real_distribution<float> width { 0.002f, 0.02f };
+    for (int i = 0; i < 2000; i++)
+    {
+        const glm::vec3 start { position(random), position(random), 0.0f };
+        const glm::vec3 end { position(random), position(random), 0.0f };
+        const glm::vec3 side = glm::normalize(glm::cross(end - start, glm::vec3 { 0.0f, 0.0f, 1.0f })) * width(random);
+
+        // Both windings, since only one of them is front facing.
+        triangles.push_back({ start, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } });
+        triangles.push_back({ end, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } });
+        triangles.push_back({ start + side, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } });
+        triangles.push_back({ start, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } });
+        triangles.push_back({ start + side, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } });
+        triangles.push_back({ end, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } });
+    }
+
+    renderer.Clear(0, 0, 0);
+    renderer.DrawTriangleList(triangles);
+    renderer.Flush();
+    const RasterStats stats = renderer.GetRasterStats();
+
+    printf("Skinny triangles (%ux%u)\n", frameSize, frameSize);
+    printf("  blocks   rejected %10llu  accepted %10llu  partial %10llu\n",
+        static_cast<unsigned long long>(stats.rejectedBlocks),
+        static_cast<unsigned long long>(stats.acceptedBlocks),
+        static_cast<unsigned long long>(stats.partialBlocks));
+    printf("  quads    rejected %10llu  accepted %10llu  partial %10llu\n",
+        static_cast<unsigned long long>(stats.rejectedQuads),
+        static_cast<unsigned long long>(stats.acceptedQuads),
+        static_cast<unsigned long long>(stats.partialQuads));
+    printf("  pixels   tested %10llu of %10llu in bounding boxes (%.1f%%)\n",
+        static_cast<unsigned long long>(stats.testedPixels),
+        static_cast<unsigned long long>(stats.boundingBoxPixels),
+        100.0 * static_cast<double>(stats.testedPixels) / static_cast<double>(stats.boundingBoxPixels));
+    printf("\n");
+}
+
+
+// Clearing a 4K frame, on one thread. Lazy clears should cost next to
+// nothing until the frame is read back, and then only for color.
+static void BenchClears()
+{
+    const uint32_t frameWidth = 3840;
+    const uint32_t frameHeight = 2160;
+    const int frameCount = 20;
+
+    // What Clear used to do: a byte at a time, then depth.
+    std::vector<uint8_t> framebuffer(frameWidth * frameHeight * 4);
+    std::vector<float> depthBuffer(frameWidth * frameHeight);
+    auto byteLoop = [&]() {
+        for (uint32_t i = 0; i < framebuffer.size(); i += 4)
+        {
+            framebuffer[i + 0] = 0x10;
+            framebuffer[i + 1] = 0x20;
+            framebuffer[i + 2] = 0x30;
+            framebuffer[i + 3] = 0xff;
+        }
+        for (uint32_t i = 0; i < depthBuffer.size(); i++)
+        {
+            depthBuffer[i] = std::numeric_limits<float>::infinity();
+        }
+    };
+
+    // A small triangle, so that a few tiles get drawn in.
+    const std::vector<Vertex> triangle = {
+        { glm::vec3 { -0.1f, 0.1f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } },
+        { glm::vec3 { 0.1f, 0.1f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } },
+        { glm::vec3 { 0.0f, -0.1f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } },
+    };
+
+    RendererOptions eagerOptions;
+    eagerOptions.threadCount = 1;
+    SoftwareRenderer eager { frameWidth, frameHeight, eagerOptions };
+    RendererOptions lazyOptions = eagerOptions;
+    lazyOptions.lazyClears = true;
+    SoftwareRenderer lazy { frameWidth, frameHeight, lazyOptions };
+
+    auto time = [frameCount](auto func) {
+        func();
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frameCount; i++)
+        {
+            func();
+        }
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frameCount;
+    };
+
+    printf("Clears (%ux%u, ms)\n", frameWidth, frameHeight);
+    printf("  byte loop, color and depth       %8.3f\n", time(byteLoop));
+    printf("  color and depth                  %8.3f\n", time([&]() { eager.Clear(ClearFlags::All, 0x30, 0x20, 0x10); }));
+    printf("  color                            %8.3f\n", time([&]() { eager.Clear(ClearFlags::Color, 0x30, 0x20, 0x10); }));
+    printf("  depth                            %8.3f\n", time([&]() { eager.Clear(ClearFlags::Depth, 0, 0, 0); }));
+    printf("  lazy, color and depth            %8.3f\n", time([&]() { lazy.Clear(ClearFlags::All, 0x30, 0x20, 0x10); }));
+    printf("  lazy, then a triangle            %8.3f\n", time([&]() {
+        lazy.Clear(ClearFlags::All, 0x30, 0x20, 0x10);
+        lazy.DrawTriangleList(triangle);
+        lazy.Flush();
+    }));
+    printf("  lazy, then a triangle, read back %8.3f\n", time([&]() {
+        lazy.Clear(ClearFlags::All, 0x30, 0x20, 0x10);
+        lazy.DrawTriangleList(triangle);
+        lazy.GetFramebufferPointer();
+    }));
+    printf("\n");
+}
+
+
+// Layers of screen filling, textured quads, 4x overdraw, drawn front to back
+// and back to front. Pixels behind what is already drawn shouldn't be
+// textured, and whole blocks of them shouldn't even be rasterized. With a
+// visibility buffer, each pixel should be shaded once whatever the order.
+static void BenchOverdraw()
+{
+    const uint32_t frameWidth = 640;
+    const uint32_t frameHeight = 480;
+    const uint32_t layerCount = 4;
+    const int frameCount = 20;
+
+    // One opaque texture, and one with holes for the alpha test.
+    const uint32_t size = 256;
+    std::mt19937 random { 2468 };
+    std::vector<uint8_t> cutoutTexels(size * size * 4);
+    for (auto& rTexel : cutoutTexels)
+    {
+        rTexel = random() & 0xff;
+    }
+    std::vector<uint8_t> opaqueTexels = cutoutTexels;
+    for (uint32_t i = 3; i < opaqueTexels.size(); i += 4)
+    {
+        opaqueTexels[i] = 0xff;
+    }
+
+    // Each layer just covers the screen at its own distance.
+    const float aspect = static_cast<float>(frameWidth) / static_cast<float>(frameHeight);
+    const std::vector<Vertex> quad = {
+        { glm::vec3 { -aspect, 1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 4.0f } },
+        { glm::vec3 { aspect, 1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 4.0f, 4.0f } },
+        { glm::vec3 { -aspect, -1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } },
+        { glm::vec3 { aspect, 1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 4.0f, 4.0f } },
+        { glm::vec3 { aspect, -1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 4.0f, 0.0f } },
+        { glm::vec3 { -aspect, -1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } },
+    };
+    const float fieldOfView = glm::radians(60.0f);
+
+    struct Pass
+    {
+        const char* name;
+        bool cutout;
+        bool frontToBack;
+    };
+    const Pass passes[] = {
+        { "opaque, back to front", false, false },
+        { "opaque, front to back", false, true },
+        { "alpha test, back to front", true, false },
+        { "alpha test, front to back", true, true },
+    };
+    const std::pair<const char*, ShadingMode> shadingModes[] = {
+        { "forward", ShadingMode::Forward },
+        { "visibility", ShadingMode::VisibilityBuffer },
+    };
+
+    const double screenPixels = static_cast<double>(frameWidth) * frameHeight * frameCount;
+    printf("Overdraw (%ux%u, %u screen filling layers)\n", frameWidth, frameHeight, layerCount);
+    printf("%-11s %-26s %9s %9s %9s %10s %11s\n", "shading", "order", "ms/frame", "shaded", "z failed", "hi-z tris", "hi-z blocks");
+    for (const auto& rShadingMode : shadingModes)
+    {
+        RendererOptions options;
+        options.threadCount = 1;
+        options.shadingMode = rShadingMode.second;
+        SoftwareRenderer renderer { frameWidth, frameHeight, options };
+
+        const uint32_t cutoutTexture = renderer.CreateTexture();
+        renderer.UpdateTexture(cutoutTexture, size, size, cutoutTexels.data(), TextureFormat::RGBA8, TextureLayout::Tiled, true);
+        const uint32_t opaqueTexture = renderer.CreateTexture();
+        renderer.UpdateTexture(opaqueTexture, size, size, opaqueTexels.data(), TextureFormat::RGBA8, TextureLayout::Tiled, true);
+        renderer.UseSampler(renderer.CreateSampler({ TextureWrap::Repeat, TextureWrap::Repeat, TextureFilter::Bilinear, MipFilter::Linear }));
+        renderer.SetProjectionMatrix(glm::perspective(fieldOfView, aspect, 0.5f, 50.0f));
+
+        for (const auto& rPass : passes)
+        {
+            renderer.UseTexture(rPass.cutout ? cutoutTexture : opaqueTexture);
+            double milliseconds = 0.0;
+            RasterStats stats;
+            for (int frame = 0; frame < frameCount; frame++)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                renderer.Clear(0, 0, 0);
+                for (uint32_t i = 0; i < layerCount; i++)
+                {
+                    const uint32_t layer = rPass.frontToBack ? i : layerCount - 1 - i;
+                    const float distance = 2.0f + static_cast<float>(layer);
+                    const float scale = distance * std::tan(fieldOfView / 2.0f);
+                    renderer.SetViewModelMatrix(glm::scale(glm::translate(glm::mat4 { 1.0f }, { 0.0f, 0.0f, -distance }), { scale, scale, 1.0f }));
+                    renderer.DrawTriangleList(quad);
+                }
+                renderer.Flush();
+                milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                stats += renderer.GetRasterStats();
+            }
+
+            printf("%-11s %-26s %9.2f %8.2fx %8.2fx %10llu %11llu\n",
+                rShadingMode.first,
+                rPass.name,
+                milliseconds / frameCount,
+                static_cast<double>(stats.shadedPixels) / screenPixels,
+                static_cast<double>(stats.depthRejectedPixels) / screenPixels,
+                static_cast<unsigned long long>(stats.hiZRejectedTriangles / frameCount),
+                static_cast<unsigned long long>(stats.hiZRejectedBlocks / frameCount));
+        }
+
+        renderer.DestroyTexture(opaqueTexture);
+        renderer.DestroyTexture(cutoutTexture);
+    }
+    printf("\n");
+}
+
+
+// Screen filling layers, back to front, drawn with each kind of raster
+// state. Each picks per-pixel loops built for just that state.
+static void BenchRasterState()
+{
+    const uint32_t frameWidth = 640;
+    const uint32_t frameHeight = 480;
+    const uint32_t layerCount = 4;
+    const int frameCount = 20;
+
+    const uint32_t size = 256;
+    std::mt19937 random { 1357 };
+    std::vector<uint8_t> texels(size * size * 4);
+    for (auto& rTexel : texels)
+    {
+        rTexel = random() | 0x80;
+    }
+
+    const float aspect = static_cast<float>(frameWidth) / static_cast<float>(frameHeight);
+    const std::vector<Vertex> quad = {
+        { glm::vec3 { -aspect, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 4.0f } },
+        { glm::vec3 { aspect, 1.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 4.0f, 4.0f } },
+        { glm::vec3 { -aspect, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f } },
+        { glm::vec3 { aspect, 1.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 4.0f, 4.0f } },
+        { glm::vec3 { aspect, -1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 4.0f, 0.0f } },
+        { glm::vec3 { -aspect, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f } },
+    };
+    const float fieldOfView = glm::radians(60.0f);
+
+    struct Pass
+    {
+        const char* name;
+        bool textured;
+        ColorSource colorSource;
+        BlendMode blendMode;
+        bool depthTest;
+        bool colorWrite;
+    };
+    const Pass passes[] = {
+        { "untextured, debug color", false, ColorSource::DebugColor, BlendMode::Mix, true, true },
+        { "untextured, vertex color", false, ColorSource::VertexColor, BlendMode::Mix, true, true },
+        { "textured, mix", true, ColorSource::DebugColor, BlendMode::Mix, true, true },
+        { "textured, modulate", true, ColorSource::VertexColor, BlendMode::Modulate, true, true },
+        { "textured, replace", true, ColorSource::DebugColor, BlendMode::Replace, true, true },
+        { "untextured, no depth test", false, ColorSource::DebugColor, BlendMode::Mix, false, true },
+        { "depth only", false, ColorSource::DebugColor, BlendMode::Mix, true, false },
+    };
+
+    RendererOptions options;
+    options.threadCount = 1;
+    SoftwareRenderer renderer { frameWidth, frameHeight, options };
+    const uint32_t texture = renderer.CreateTexture();
+    renderer.UpdateTexture(texture, size, size, texels.data(), TextureFormat::RGBA8, TextureLayout::Tiled, true);
+    renderer.UseSampler(renderer.CreateSampler({ TextureWrap::Repeat, TextureWrap::Repeat, TextureFilter::Bilinear, MipFilter::Linear }));
+    renderer.SetProjectionMatrix(glm::perspective(fieldOfView, aspect, 0.5f, 50.0f));
+
+    const double screenPixels = static_cast<double>(frameWidth) * frameHeight * frameCount;
+    printf("Raster state (%ux%u, %u screen filling layers, back to front)\n", frameWidth, frameHeight, layerCount);
+    printf("%-27s %9s %9s\n", "", "ms/frame", "written");
+    for (const auto& rPass : passes)
+    {
+        renderer.UseTexture(rPass.textured ? texture : 0);
+        renderer.SetColorSource(rPass.colorSource);
+        renderer.SetBlendMode(rPass.blendMode);
+        renderer.SetDepthTest(rPass.depthTest);
+        renderer.SetColorWrite(rPass.colorWrite);
+
+        double milliseconds = 0.0;
+        PipelineStats stats;
+        for (int frame = 0; frame < frameCount; frame++)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            renderer.Clear(0, 0, 0);
+            for (uint32_t i = 0; i < layerCount; i++)
+            {
+                const float distance = 2.0f + static_cast<float>(layerCount - 1 - i);
+                const float scale = distance * std::tan(fieldOfView / 2.0f);
+                renderer.SetViewModelMatrix(glm::scale(glm::translate(glm::mat4 { 1.0f }, { 0.0f, 0.0f, -distance }), { scale, scale, 1.0f }));
+                renderer.DrawTriangleList(quad);
+            }
+            renderer.Flush();
+            milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            stats += renderer.GetPipelineStats();
+        }
+
+        printf("%-27s %9.2f %8.2fx\n", rPass.name, milliseconds / frameCount, static_cast<double>(stats.pixelsWritten) / screenPixels);
+    }
+    renderer.DestroyTexture(texture);
+    printf("\n");
+}
+
+
+// Screen filling layers, back to front, at a size where the color and depth
+// buffers are far bigger than the caches, with each pair of buffer formats.
+// Flat colors and every thread, so that the buffers are most of the work.
+// Reading back converts the frame to RGBA8, when it isn't already.
+static void BenchRenderTargetFormats()
+{
+    const uint32_t frameWidth = 1920;
+    const uint32_t frameHeight = 1080;
+    const uint32_t layerCount = 4;
+    const int frameCount = 10;
+
+    const float aspect = static_cast<float>(frameWidth) / static_cast<float>(frameHeight);
+    const std::vector<Vertex> quad = {
+        { glm::vec3 { -aspect, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f } },
+        { glm::vec3 { aspect, 1.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 1.0f, 1.0f } },
+        { glm::vec3 { -aspect, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f } },
+        { glm::vec3 { aspect, 1.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 1.0f, 1.0f } },
+        { glm::vec3 { aspect, -1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 1.0f, 0.0f } },
+        { glm::vec3 { -aspect, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f } },
+    };
+    const float fieldOfView = glm::radians(60.0f);
+
+    struct Pass
+    {
+        const char* name;
+        TextureFormat colorFormat;
+        DepthFormat depthFormat;
+        uint32_t bytesPerPixel;
+    };
+    const Pass passes[] = {
+        { "rgba8, float32", TextureFormat::RGBA8, DepthFormat::Float32, 8 },
+        { "rgba8, unorm24", TextureFormat::RGBA8, DepthFormat::Unorm24, 7 },
+        { "rgb666, unorm24", TextureFormat::RGB666, DepthFormat::Unorm24, 6 },
+        { "rgba8, unorm16", TextureFormat::RGBA8, DepthFormat::Unorm16, 6 },
+        { "rgb565, unorm16", TextureFormat::RGB565, DepthFormat::Unorm16, 4 },
+    };
+
+    const uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+    printf("Render target formats (%ux%u, %u screen filling layers, back to front, %u threads)\n", frameWidth, frameHeight, layerCount, threadCount);
+    printf("%-17s %9s %9s %12s\n", "color, depth", "bytes/px", "ms/frame", "readback ms");
+    for (const auto& rPass : passes)
+    {
+        RendererOptions options;
+        options.threadCount = threadCount;
+        options.colorFormat = rPass.colorFormat;
+        options.depthFormat = rPass.depthFormat;
+        options.depthNear = 0.5f;
+        SoftwareRenderer renderer { frameWidth, frameHeight, options };
+        renderer.SetProjectionMatrix(glm::perspective(fieldOfView, aspect, 0.5f, 50.0f));
+
+        double milliseconds = 0.0;
+        double readbackMilliseconds = 0.0;
+        for (int frame = 0; frame < frameCount; frame++)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            renderer.Clear(0, 0, 0);
+            for (uint32_t i = 0; i < layerCount; i++)
+            {
+                const float distance = 2.0f + static_cast<float>(layerCount - 1 - i);
+                const float scale = distance * std::tan(fieldOfView / 2.0f);
+                renderer.SetViewModelMatrix(glm::scale(glm::translate(glm::mat4 { 1.0f }, { 0.0f, 0.0f, -distance }), { scale, scale, 1.0f }));
+                renderer.DrawTriangleList(quad);
+            }
+            renderer.Flush();
+            const auto drawn = std::chrono::steady_clock::now();
+            renderer.GetFramebufferPointer();
+            milliseconds += std::chrono::duration<double, std::milli>(drawn - start).count();
+            readbackMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - drawn).count();
+        }
+
+        printf("%-17s %9u %9.2f %12.2f\n", rPass.name, rPass.bytesPerPixel, milliseconds / frameCount, readbackMilliseconds / frameCount);
+    }
+    printf("\n");
+}
+
+
+// Quads scattered through a box in front of the camera, in a random order,
+// with two textures. They are recorded once and submitted every frame, in
+// the order they were recorded, front to back, and grouped by texture.
+static void BenchCommandBuffers()
+{
+    const uint32_t frameWidth = 640;
+    const uint32_t frameHeight = 480;
+    const uint32_t quadCount = 64;
+    const int frameCount = 20;
+
+    const std::vector<Vertex> quad = {
+        { glm::vec3 { -1.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 1.0f } },
+        { glm::vec3 { 1.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 1.0f, 1.0f } },
+        { glm::vec3 { -1.0f, -1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } },
+        { glm::vec3 { 1.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 1.0f, 1.0f } },
+        { glm::vec3 { 1.0f, -1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 1.0f, 0.0f } },
+        { glm::vec3 { -1.0f, -1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } },
+    };
+    const VertexBuffer quadBuffer { quad };
+
+    RendererOptions options;
+    options.threadCount = 1;
+    SoftwareRenderer renderer { frameWidth, frameHeight, options };
+
+    const uint32_t size = 256;
+    std::mt19937 random { 97531 };
+    uint32_t textures[2];
+    for (auto& rTexture : textures)
+    {
+        std::vector<uint8_t> texels(size * size * 4);
+        for (auto& rTexel : texels)
+        {
+            rTexel = random() | 0x80;
+        }
+        rTexture = renderer.CreateTexture();
+        renderer.UpdateTexture(rTexture, size, size, texels.data(), TextureFormat::RGBA8, TextureLayout::Tiled, true);
+    }
+    const uint32_t sampler = renderer.CreateSampler({ TextureWrap::Repeat, TextureWrap::Repeat, TextureFilter::Bilinear, MipFilter::Linear });
+
+    // Model matrices only. The camera is given to Submit.
+    CommandBuffer commands;
+    commands.SetProjectionMatrix(glm::perspective(glm::radians(60.0f), static_cast<float>(frameWidth) / frameHeight, 0.5f, 50.0f));
+    commands.UseSampler(sampler);
+    std::uniform_real_distribution<float> across { -2.0f, 2.0f };
+    std::uniform_real_distribution<float> along { 0.0f, 12.0f };
+    for (uint32_t i = 0; i < quadCount; i++)
+    {
+        commands.UseTexture(textures[i % 2]);
+        commands.SetViewModelMatrix(glm::translate(glm::mat4 { 1.0f }, { across(random), across(random), -along(random) }));
+        commands.DrawTriangleList(quadBuffer);
+    }
+    const glm::mat4 view = glm::translate(glm::mat4 { 1.0f }, { 0.0f, 0.0f, -3.0f });
+
+    struct Pass
+    {
+        const char* name;
+        bool sortFrontToBack;
+        bool groupByTexture;
+    };
+    const Pass passes[] = {
+        { "as recorded", false, false },
+        { "front to back", true, false },
+        { "by texture", false, true },
+        { "by texture, front to back", true, true },
+    };
+
+    const double screenPixels = static_cast<double>(frameWidth) * frameHeight * frameCount;
+    printf("Command buffers (%ux%u, %u textured quads)\n", frameWidth, frameHeight, quadCount);
+    printf("%-26s %9s %9s\n", "order", "ms/frame", "shaded");
+    for (const auto& rPass : passes)
+    {
+        SubmitOptions submitOptions;
+        submitOptions.viewMatrix = view;
+        submitOptions.sortFrontToBack = rPass.sortFrontToBack;
+        submitOptions.groupByTexture = rPass.groupByTexture;
+
+        double milliseconds = 0.0;
+        RasterStats stats;
+        for (int frame = 0; frame < frameCount; frame++)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            renderer.Clear(0, 0, 0);
+            renderer.Submit(commands, submitOptions);
+            renderer.Flush();
+            milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            stats += renderer.GetRasterStats();
+        }
+
+        printf("%-26s %9.2f %8.2fx\n",
+            rPass.name,
+            milliseconds / frameCount,
+            static_cast<double>(stats.shadedPixels) / screenPixels);
+    }
+
+    for (const uint32_t texture : textures)
+    {
+        renderer.DestroyTexture(texture);
+    }
+    printf("\n");
+}
+
+
+// Lots of small props, all the same mesh, drawn one at a time and then
+// as instances. Both should give exactly the same image.
+static void BenchInstancing()
+{
+    const uint32_t frameWidth = 640;
+    const uint32_t frameHeight = 480;
+    const uint32_t propCount = 10000;
+    const int frameCount = 10;
+
+    std::vector<Vertex> cube;
+    std::vector<uint16_t> cubeIndices;
+    for (int side = 0; side < 6; side++)
+    {
+        const glm::mat4 turn = side < 4
+            ? glm::rotate(glm::mat4 { 1.0f }, glm::radians(90.0f * side), { 0.0f, 1.0f, 0.0f })
+            : glm::rotate(glm::mat4 { 1.0f }, glm::radians(side == 4 ? 90.0f : -90.0f), { 1.0f, 0.0f, 0.0f });
+        const uint16_t base = cube.size();
+        for (const glm::vec2 corner : { glm::vec2 { -1.0f, 1.0f }, glm::vec2 { 1.0f, 1.0f }, glm::vec2 { -1.0f, -1.0f }, glm::vec2 { 1.0f, -1.0f } })
+        {
+            cube.push_back({ turn * glm::vec4 { corner, 1.0f, 1.0f }, { 1.0f, 1.0f, 1.0f }, corner * 0.5f + 0.5f });
+        }
+        cubeIndices.insert(cubeIndices.end(), { base, static_cast<uint16_t>(base + 1), static_cast<uint16_t>(base + 2) });
+        cubeIndices.insert(cubeIndices.end(), { static_cast<uint16_t>(base + 1), static_cast<uint16_t>(base + 3), static_cast<uint16_t>(base + 2) });
+    }
+    const VertexBuffer cubeBuffer { cube };
+
+    std::mt19937 random { 112233 };
+    std::uniform_real_distribution<float> across { -20.0f, 20.0f };
+    std::uniform_real_distribution<float> along { 5.0f, 60.0f };
+    std::uniform_real_distribution<float> angle { 0.0f, 6.2831853f };
+    std::vector<glm::mat4> models;
+    for (uint32_t i = 0; i < propCount; i++)
+    {
+        glm::mat4 model = glm::translate(glm::mat4 { 1.0f }, { across(random), across(random) * 0.5f, -along(random) });
+        model = glm::rotate(model, angle(random), glm::normalize(glm::vec3 { 1.0f, 2.0f, 3.0f }));
+        models.push_back(glm::scale(model, glm::vec3 { 0.2f }));
+    }
+
+    RendererOptions options;
+    options.threadCount = 0;
+    SoftwareRenderer renderer { frameWidth, frameHeight, options };
+    renderer.SetProjectionMatrix(glm::perspective(glm::radians(60.0f), static_cast<float>(frameWidth) / frameHeight, 0.5f, 100.0f));
+    const glm::mat4 view = glm::translate(glm::mat4 { 1.0f }, { 0.0f, 0.0f, -2.0f });
+
+    struct Pass
+    {
+        const char* name;
+        bool instanced;
+    };
+    const Pass passes[] = {
+        { "separate draws", false },
+        { "instanced", true },
+    };
+
+    printf("Instancing (%ux%u, %u cubes)\n", frameWidth, frameHeight, propCount);
+    printf("%-16s %9s %12s %9s %8s\n", "", "ms/frame", "geometry ms", "flush ms", "same");
+    std::vector<uint8_t> firstImage;
+    for (const auto& rPass : passes)
+    {
+        auto drawFrame = [&]() {
+            renderer.Clear(0, 0, 0);
+            if (rPass.instanced)
+            {
+                renderer.SetViewModelMatrix(view);
+                renderer.DrawIndexedTrianglesInstanced(cubeBuffer, cubeIndices, models);
+            }
+            else
+            {
+                for (const auto& rModel : models)
+                {
+                    renderer.SetViewModelMatrix(view * rModel);
+                    renderer.DrawIndexedTriangles(cubeBuffer, cubeIndices);
+                }
+            }
+            renderer.Flush();
+        };
+
+        drawFrame();
+        double milliseconds = 0.0;
+        PipelineStats stats;
+        for (int frame = 0; frame < frameCount; frame++)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            drawFrame();
+            milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            stats += renderer.GetPipelineStats();
+        }
+
+        const uint8_t* pPixels = renderer.GetFramebufferPointer();
+        const std::vector<uint8_t> image { pPixels, pPixels + frameWidth * frameHeight * 4 };
+        if (firstImage.empty())
+        {
+            firstImage = image;
+        }
+        printf("%-16s %9.2f %12.2f %9.2f %8s\n",
+            rPass.name,
+            milliseconds / frameCount,
+            stats.geometryNanoseconds / 1e6 / frameCount,
+            stats.flushNanoseconds / 1e6 / frameCount,
+            image == firstImage ? "yes" : "NO");
+    }
+    printf("\n");
+}
+
+
+// A world of cubes on a grid, seen from just above the ground, so that only
+// a few percent of them are in view at once. Every cube drawn, against just
+// the ones the scene's hierarchy finds might be visible.
+static void BenchSceneCulling()
+{
+    const uint32_t frameWidth = 640;
+    const uint32_t frameHeight = 480;
+    const uint32_t gridSize = 150;
+    const float spacing = 4.0f;
+    const int frameCount = 10;
+
+    std::vector<Vertex> cube;
+    std::vector<uint16_t> cubeIndices;
+    for (int side = 0; side < 6; side++)
+    {
+        // Corners of the side facing +z, turned to face each way.
+        const glm::mat4 turn = side < 4
+            ? glm::rotate(glm::mat4 { 1.0f }, glm::radians(90.0f * side), { 0.0f, 1.0f, 0.0f })
+            : glm::rotate(glm::mat4 { 1.0f }, glm::radians(side == 4 ? 90.0f : -90.0f), { 1.0f, 0.0f, 0.0f });
+        const uint16_t base = cube.size();
+        for (const glm::vec2 corner : { glm::vec2 { -1.0f, 1.0f }, glm::vec2 { 1.0f, 1.0f }, glm::vec2 { -1.0f, -1.0f }, glm::vec2 { 1.0f, -1.0f } })
+        {
+            cube.push_back({ turn * glm::vec4 { corner, 1.0f, 1.0f }, { 1.0f, 1.0f, 1.0f }, corner * 0.5f + 0.5f });
+        }
+        cubeIndices.insert(cubeIndices.end(), { base, static_cast<uint16_t>(base + 1), static_cast<uint16_t>(base + 2) });
+        cubeIndices.insert(cubeIndices.end(), { static_cast<uint16_t>(base + 1), static_cast<uint16_t>(base + 3), static_cast<uint16_t>(base + 2) });
+    }
+    const VertexBuffer cubeBuffer { cube };
+
+    RendererOptions options;
+    options.threadCount = 1;
+    SoftwareRenderer renderer { frameWidth, frameHeight, options };
+    const glm::mat4 projection = glm::perspective(glm::radians(60.0f), static_cast<float>(frameWidth) / frameHeight, 0.5f, 80.0f);
+
+    // Everything, recorded once, with model matrices only.
+    Scene scene;
+    CommandBuffer everything;
+    everything.SetProjectionMatrix(projection);
+    std::mt19937 random { 24680 };
+    std::uniform_real_distribution<float> height { 0.5f, 3.0f };
+    for (uint32_t z = 0; z < gridSize; z++)
+    {
+        for (uint32_t x = 0; x < gridSize; x++)
+        {
+            const glm::vec3 position { (x - gridSize / 2.0f) * spacing, 0.0f, (z - gridSize / 2.0f) * spacing };
+            const glm::mat4 model = glm::scale(glm::translate(glm::mat4 { 1.0f }, position), { 1.0f, height(random), 1.0f });
+            scene.AddObject(cubeBuffer, cubeIndices, model);
+            everything.SetViewModelMatrix(model);
+            everything.DrawIndexedTriangles(cubeBuffer, cubeIndices);
+        }
+    }
+    const glm::mat4 view = glm::lookAt(glm::vec3 { 0.0f, 6.0f, 0.0f }, glm::vec3 { 20.0f, 2.0f, -40.0f }, glm::vec3 { 0.0f, 1.0f, 0.0f });
+
+    SubmitOptions everythingOptions;
+    everythingOptions.viewMatrix = view;
+    CommandBuffer visible;
+    scene.Cull(projection, view, visible);
+
+    auto time = [&](const std::function<void()>& drawFrame) {
+        drawFrame();
+        const auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frameCount; frame++)
+        {
+            drawFrame();
+        }
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frameCount;
+    };
+    const double everythingMilliseconds = time([&]() {
+        renderer.Clear(0, 0, 0);
+        renderer.Submit(everything, everythingOptions);
+        renderer.Flush();
+    });
+    const uint64_t everythingTriangles = renderer.GetPipelineStats().trianglesRasterized;
+    const double cullMilliseconds = time([&]() {
+        visible.Reset();
+        scene.Cull(projection, view, visible);
+    });
+    const double culledMilliseconds = time([&]() {
+        renderer.Clear(0, 0, 0);
+        visible.Reset();
+        scene.Cull(projection, view, visible);
+        renderer.Submit(visible);
+        renderer.Flush();
+    });
+    const uint64_t culledTriangles = renderer.GetPipelineStats().trianglesRasterized;
+    const SceneCullStats stats = scene.GetCullStats();
+
+    printf("Scene culling (%ux%u, %u cubes, %llu visible, %llu of them inside, %llu nodes visited)\n",
+        frameWidth, frameHeight, scene.GetObjectCount(),
+        static_cast<unsigned long long>(stats.visibleObjects), static_cast<unsigned long long>(stats.insideObjects),
+        static_cast<unsigned long long>(stats.visitedNodes));
+    printf("%-20s %9s %14s\n", "", "ms/frame", "rasterized");
+    printf("%-20s %9.2f %14llu\n", "everything", everythingMilliseconds, static_cast<unsigned long long>(everythingTriangles));
+    printf("%-20s %9.2f %14llu\n", "culled", culledMilliseconds, static_cast<unsigned long long>(culledTriangles));
+    printf("%-20s %9.3f\n", "  of which culling", cullMilliseconds);
+    printf("\n");
+}
+
+
+// A present function which takes about as long as drawing a frame, standing
+// in for copying it out to the display. With one buffer the two take turns,
+// and with more they should overlap.
+static void BenchPresent()
+{
+    const uint32_t frameWidth = 640;
+    const uint32_t frameHeight = 480;
+    const int frameCount = 30;
+
+    const std::vector<Vertex> triangles = [&]() {
+        std::mt19937 random { 1357 };
+        std::uniform_real_distribution<float> position { -1.0f, 1.0f };
+        std::vector<Vertex> vertices;
+        for (int i = 0; i < 3 * 100; i++)
+        {
+            vertices.push_back({ glm::vec3 { position(random), position(random), 0.0f }, { 1.0f, 0.5f, 0.25f }, { 0.0f, 0.0f } });
+        }
+        return vertices;
+    }();
+
+    auto drawFrame = [&](SoftwareRenderer& rRenderer) {
+        rRenderer.Clear(0, 0, 0);
+        rRenderer.DrawTriangleList(triangles);
+    };
+
+    // How long a frame takes to draw, to size the present function.
+    double drawMilliseconds = 0.0;
+    {
+        RendererOptions options;
+        options.threadCount = 1;
+        SoftwareRenderer renderer { frameWidth, frameHeight, options };
+        drawFrame(renderer);
+        const auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frameCount; frame++)
+        {
+            drawFrame(renderer);
+            renderer.Flush();
+        }
+        drawMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frameCount;
+    }
+
+    std::vector<uint8_t> display(frameWidth * frameHeight * 4);
+    const auto presentTime = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli> { drawMilliseconds });
+    auto present = [&display, presentTime](const uint8_t* pPixels) {
+        const auto start = std::chrono::steady_clock::now();
+        memcpy(display.data(), pPixels, display.size());
+        std::this_thread::sleep_until(start + presentTime);
+    };
+
+    printf("Present (%ux%u, %.2f ms to draw and to present a frame)\n", frameWidth, frameHeight, drawMilliseconds);
+    printf("%-8s %9s %12s\n", "buffers", "ms/frame", "ms waiting");
+    for (const uint32_t swapChainLength : { 1u, 2u, 3u })
+    {
+        RendererOptions options;
+        options.threadCount = 1;
+        options.swapChainLength = swapChainLength;
+        SoftwareRenderer renderer { frameWidth, frameHeight, options };
+        renderer.SetPresentFunction(present);
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frameCount; frame++)
+        {
+            drawFrame(renderer);
+            renderer.Present();
+        }
+        const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        const PresentStats stats = renderer.GetPresentStats();
+        renderer.SetPresentFunction(nullptr);
+
+        printf("%-8u %9.2f %12.2f\n", swapChainLength, milliseconds / frameCount, stats.waitMilliseconds / frameCount);
+    }
+    printf("\n");
+}
+
+
+// Covers a square with a mesh of jittered triangles and counts how often
+// each pixel gets covered in fixed point mode. With the top-left fill rule,
+// that has to be exactly once: no cracks and no pixels drawn twice.
+static bool CheckFixedPointWatertight()
+{
+    const uint32_t cellsWide = 24;
+    const uint32_t cellSize = 12;
+    const uint32_t regionSize = cellsWide * cellSize;
+
+    std::mt19937 random { 91011 };
+    std::uniform_real_distribution<float> jitter { -0.2f * cellSize, 0.2f * cellSize };
+
+    // The outside of the mesh stays on the square, so every pixel in it
+    // belongs to some triangle. Some vertices are moved onto pixels or
+    // half pixels, so that plenty of edges run exactly through pixels.
+    std::vector<glm::vec2> grid;
+    for (uint32_t y = 0; y <= cellsWide; y++)
+    {
+        for (uint32_t x = 0; x <= cellsWide; x++)
+        {
+            glm::vec2 p { static_cast<float>(x * cellSize), static_cast<float>(y * cellSize) };
+            if (x != 0 && x != cellsWide)
+            {
+                p.x += jitter(random);
+            }
+            if (y != 0 && y != cellsWide)
+            {
+                p.y += jitter(random);
+            }
+            switch (grid.size() % 3)
+            {
+            case 0: p = glm::round(p); break;
+            case 1: p = glm::round(p * 2.0f) * 0.5f; break;
+            default: break;
+            }
+            grid.push_back(p);
+        }
+    }
+
+    bool allPassed = true;
+    for (const int subpixelBits : { 0, 4, 8 })
+    {
+        std::vector<uint32_t> counts(regionSize * regionSize, 0);
+        RasterSpan span;
+
+        auto drawTriangle = [&](const glm::vec2& p0, const glm::vec2& p1, const glm::vec2& p2) {
+            FixedTriangleEdges edges;
+            if ( ! SetupFixedTriangleEdges(subpixelBits, p0.x, p0.y, p1.x, p1.y, p2.x, p2.y, 1.0f, 1.0f, 1.0f, edges))
+            {
+                return;
+            }
+            for (int32_t y = std::max(edges.ymin, 0); y <= std::min(edges.ymax, static_cast<int32_t>(regionSize) - 1); y++)
+            {
+                const int32_t xmax = std::min(edges.xmax, static_cast<int32_t>(regionSize) - 1);
+                for (int32_t x = std::max(edges.xmin, 0); x <= xmax; x += RASTER_SPAN_MAX)
+                {
+                    const uint32_t spanLength = std::min<uint32_t>(xmax - x + 1, RASTER_SPAN_MAX);
+                    const uint64_t activeMask = spanLength == 64 ? ~uint64_t { 0 } : (uint64_t { 1 } << spanLength) - 1;
+                    RasterRowFixed(edges, x, y, activeMask, span);
+                    for (uint64_t coverage = span.coverage; coverage != 0; coverage &= coverage - 1)
+                    {
+                        counts[y * regionSize + x + __builtin_ctzll(coverage)]++;
+                    }
+                }
+            }
+        };
+
+        for (uint32_t y = 0; y < cellsWide; y++)
+        {
+            for (uint32_t x = 0; x < cellsWide; x++)
+            {
+                const glm::vec2& p00 = grid[y * (cellsWide + 1) + x];
+                const glm::vec2& p10 = grid[y * (cellsWide + 1) + x + 1];
+                const glm::vec2& p01 = grid[(y + 1) * (cellsWide + 1) + x];
+                const glm::vec2& p11 = grid[(y + 1) * (cellsWide + 1) + x + 1];
+
+                // Alternate the diagonal, to get edges of every slope.
+                if ((x + y) % 2 == 0)
+                {
+                    drawTriangle(p00, p10, p01);
+                    drawTriangle(p10, p11, p01);
+                }
+                else
+                {
+                    drawTriangle(p00, p10, p11);
+                    drawTriangle(p00, p11, p01);
+                }
+            }
+        }
+
+        const auto holes = std::count(counts.begin(), counts.end(), 0u);
+        const auto overdrawn = std::count_if(counts.begin(), counts.end(), [](uint32_t count) { return count > 1; });
+        const bool passed = holes == 0 && overdrawn == 0;
+        allPassed = allPassed && passed;
+
+        printf("Fixed point mesh, %d subpixel bits: %ld cracks, %ld pixels drawn twice (%s)\n",
+            subpixelBits, static_cast<long>(holes), static_cast<long>(overdrawn), passed ? "ok" : "FAILED");
+    }
+    printf("\n");
+
+    return allPassed;
+}
+
+
+// Once a renderer has warmed up, drawing the same frame again
+// shouldn't need the heap at all.
+static bool CheckSteadyStateAllocations()
+{
+    SoftwareRenderer renderer { 640, 480, RendererOptions { 4 } };
+
+    std::vector<uint8_t> texels(64 * 64 * 4, 0xff);
+    const uint32_t texture = renderer.CreateTexture();
+    renderer.UpdateTexture(texture, 64, 64, texels.data());
+
+    // A grid of quads, drawn from every kind of vertex and index array.
+    std::vector<Vertex> vertices;
+    std::vector<uint16_t> indices16;
+    std::vector<uint32_t> indices32;
+    const uint32_t gridSize = 16;
+    for (uint32_t y = 0; y <= gridSize; y++)
+    {
+        for (uint32_t x = 0; x <= gridSize; x++)
+        {
+            const float u = static_cast<float>(x) / gridSize;
+            const float v = static_cast<float>(y) / gridSize;
+            vertices.push_back({ glm::vec3 { u * 2.0f - 1.0f, 1.0f - v * 2.0f, 0.0f }, { u, v, 1.0f }, { u, v } });
+        }
+    }
+    for (uint32_t y = 0; y < gridSize; y++)
+    {
+        for (uint32_t x = 0; x < gridSize; x++)
+        {
+            const uint16_t i = y * (gridSize + 1) + x;
+            indices16.insert(indices16.end(), { i, static_cast<uint16_t>(i + 1), static_cast<uint16_t>(i + gridSize + 1) });
+            indices16.insert(indices16.end(), { static_cast<uint16_t>(i + 1), static_cast<uint16_t>(i + gridSize + 2), static_cast<uint16_t>(i + gridSize + 1) });
+        }
+    }
+    indices32.assign(indices16.begin(), indices16.end());
+    std::vector<Vertex> triangleList;
+    for (const uint16_t index : indices16)
+    {
+        triangleList.push_back(vertices[index]);
+    }
+    const VertexBuffer vertexBuffer { vertices };
+
+    // Some of the copies cross the near plane, or the edge of the guard band.
+    const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 4.0f / 3.0f, 1.0f, 50.0f);
+    const glm::mat4 models[] = {
+        glm::translate(glm::mat4 { 1.0f }, { 0.0f, 0.0f, -3.0f }),
+        glm::rotate(glm::translate(glm::mat4 { 1.0f }, { 0.5f, 0.0f, -1.2f }), 1.2f, { 0.0f, 1.0f, 0.0f }),
+        glm::scale(glm::translate(glm::mat4 { 1.0f }, { 0.0f, 0.0f, -2.0f }), { 40.0f, 40.0f, 1.0f }),
+    };
+
+    // The same draws again, recorded once and sorted every time they're submitted.
+    CommandBuffer commands;
+    commands.SetProjectionMatrix(projection);
+    commands.UseTexture(texture);
+    for (const auto& rModel : models)
+    {
+        commands.SetViewModelMatrix(rModel);
+        commands.DrawTriangleList(vertexBuffer);
+        commands.DrawIndexedTriangles(vertexBuffer, indices16);
+        commands.DrawIndexedTriangles(vertexBuffer, indices32);
+    }
+    SubmitOptions submitOptions;
+    submitOptions.sortFrontToBack = true;
+    submitOptions.groupByTexture = true;
+    const std::vector<glm::mat4> instanceMatrices { std::begin(models), std::end(models) };
+
+    auto drawFrame = [&]() {
+        renderer.Clear(0, 0, 0);
+        renderer.SetProjectionMatrix(projection);
+        renderer.UseTexture(texture);
+        for (const auto& rModel : models)
+        {
+            renderer.SetViewModelMatrix(rModel);
+            renderer.DrawTriangleList(triangleList);
+            renderer.DrawTriangleList(vertexBuffer);
+            renderer.DrawIndexedTriangles(vertices, indices16);
+            renderer.DrawIndexedTriangles(vertexBuffer, indices32);
+        }
+        renderer.Submit(commands, submitOptions);
+        renderer.SetViewModelMatrix(glm::mat4 { 1.0f });
+        renderer.DrawTriangleListInstanced(vertexBuffer, instanceMatrices);
+        renderer.DrawIndexedTrianglesInstanced(vertexBuffer, indices16, instanceMatrices);
+        renderer.DrawIndexedTrianglesInstanced(vertexBuffer, indices32, instanceMatrices);
+        renderer.GetFramebufferPointer();
+    };
+
+    for (int i = 0; i < 3; i++)
+    {
+        drawFrame();
+    }
+    const uint64_t before = heapAllocations;
+    for (int i = 0; i < 3; i++)
+    {
+        drawFrame();
+    }
+    const uint64_t allocations = heapAllocations - before;
+
+    const ScratchArenaStats drawStats = renderer.GetDrawArenaStats();
+    const ScratchArenaStats frameStats = renderer.GetFrameArenaStats();
+    const bool passed = allocations == 0;
+    printf("Steady state frames: %llu heap allocations (%s)\n", static_cast<unsigned long long>(allocations), passed ? "ok" : "FAILED");
+    printf("  draw arena   high water %8zu bytes, capacity %8zu, %llu blocks allocated\n",
+        drawStats.highWaterMark, drawStats.capacity, static_cast<unsigned long long>(drawStats.blockAllocations));
+    printf("  frame arena  high water %8zu bytes, capacity %8zu, %llu blocks allocated\n",
+        frameStats.highWaterMark, frameStats.capacity, static_cast<unsigned long long>(frameStats.blockAllocations));
+    printf("\n");
+
+    renderer.DestroyTexture(texture);
+    return passed;
+}
+
+
+// Every frame presented should be whole, and they should come out in order,
+// even while the next frames are being drawn.
+static bool CheckPresentedFrames()
+{
+    const uint32_t frameWidth = 160;
+    const uint32_t frameHeight = 120;
+    const uint32_t frameCount = 50;
+
+    RendererOptions options;
+    options.threadCount = 2;
+    options.swapChainLength = 3;
+    SoftwareRenderer renderer { frameWidth, frameHeight, options };
+
+    // Frame i is cleared to a gray of i, and a triangle is drawn over the middle
+    // half of it. The rows above and below that should all still be gray.
+    const std::vector<Vertex> triangle = {
+        { glm::vec3 { -0.5f, 0.5f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } },
+        { glm::vec3 { 0.5f, 0.5f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } },
+        { glm::vec3 { 0.0f, -0.5f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } },
+    };
+    std::vector<int> presented;
+    presented.reserve(frameCount);
+    renderer.SetPresentFunction([&presented](const uint8_t* pPixels) {
+        // Give the next frame time to be drawn, over this one if it could.
+        std::this_thread::sleep_for(std::chrono::microseconds { 200 });
+
+        const uint8_t gray = pPixels[0];
+        bool whole = true;
+        for (uint32_t y = 0; y < frameHeight; y++)
+        {
+            if (frameHeight / 5 <= y && y < frameHeight * 4 / 5)
+            {
+                continue;
+            }
+            for (uint32_t x = 0; x < frameWidth; x++)
+            {
+                whole = whole && pPixels[(y * frameWidth + x) * 4] == gray;
+            }
+        }
+        presented.push_back(whole ? gray : -1);
+    });
+
+    for (uint32_t frame = 0; frame < frameCount; frame++)
+    {
+        const uint8_t gray = static_cast<uint8_t>(frame);
+        renderer.Clear(gray, gray, gray);
+        renderer.DrawTriangleList(triangle);
+        renderer.Present();
+    }
+    renderer.SetPresentFunction(nullptr);
+
+    bool passed = presented.size() == frameCount;
+    for (uint32_t i = 0; passed && i < frameCount; i++)
+    {
+        passed = presented[i] == static_cast<int>(i);
+    }
+    printf("Presented frames: %zu of %u, whole and in order (%s)\n", presented.size(), frameCount, passed ? "ok" : "FAILED");
+    printf("\n");
+    return passed;
+}
+
+
+static bool CheckPipelineStats()
+{
+    if ( ! PIPELINE_STATS_ENABLED)
+    {
+        printf("Pipeline stats: compiled out (skipped)\n");
+        printf("\n");
+        return true;
+    }
+
+    SoftwareRenderer renderer { 160, 120 };
+
+    // One triangle for each way through the front end. The first is drawn
+    // twice, so that its second time fails the depth test everywhere.
+    auto vertex = [](float x, float y, float z) { return Vertex { glm::vec3 { x, y, z }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } }; };
+    const std::vector<Vertex> triangles = {
+        vertex(-0.5f, 0.5f, 0.0f), vertex(0.5f, 0.5f, 0.0f), vertex(0.0f, -0.5f, 0.0f),
+        vertex(-0.5f, 0.5f, 0.0f), vertex(0.5f, 0.5f, 0.0f), vertex(0.0f, -0.5f, 0.0f),
+        vertex(-0.5f, 0.5f, 0.0f), vertex(0.0f, -0.5f, 0.0f), vertex(0.5f, 0.5f, 0.0f),  // back facing
+        vertex(-0.5f, 0.0f, 0.0f), vertex(0.0f, 0.0f, 0.0f), vertex(0.5f, 0.0f, 0.0f),   // zero area
+        vertex(-0.8725f, 0.83f, 0.0f), vertex(-0.865f, 0.83f, 0.0f), vertex(-0.86875f, 0.82f, 0.0f),  // between pixel centers
+        vertex(2.0f, 0.5f, 0.0f), vertex(3.0f, 0.5f, 0.0f), vertex(2.5f, -0.5f, 0.0f),   // off to the right
+        vertex(-0.5f, -0.6f, 0.5f), vertex(0.5f, -0.6f, 0.5f), vertex(0.0f, -0.9f, -2.0f),  // through the near plane
+    };
+
+    renderer.Clear(0, 0, 0);
+    renderer.DrawTriangleList(triangles);
+    renderer.Flush();
+    const PipelineStats stats = renderer.GetPipelineStats();
+    const RasterStats rasterStats = renderer.GetRasterStats();
+
+    // The triangle through the near plane is clipped into two.
+    const bool passed =
+        stats.verticesTransformed >= triangles.size() &&
+        stats.trianglesSubmitted == 7 &&
+        stats.trianglesFrustumCulled == 1 &&
+        stats.trianglesClipped == 1 &&
+        stats.trianglesBackfaceCulled == 1 &&
+        stats.trianglesZeroArea == 1 &&
+        stats.trianglesTooSmall == 1 &&
+        stats.trianglesRasterized == 4 &&
+        stats.fragmentsDepthTested == rasterStats.shadedPixels + rasterStats.depthRejectedPixels &&
+        stats.fragmentsPassedDepth == rasterStats.shadedPixels &&
+        stats.fragmentsDepthTested > stats.fragmentsPassedDepth &&
+        stats.fragmentsAlphaTested == 0 &&
+        stats.pixelsWritten == stats.fragmentsPassedDepth &&
+        stats.geometryNanoseconds > 0 &&
+        stats.rasterNanoseconds > 0 &&
+        stats.flushNanoseconds > 0;
+
+    printf("Pipeline stats: %llu submitted, %llu frustum culled, %llu clipped, %llu back facing, %llu zero area, %llu too small, %llu rasterized\n",
+        static_cast<unsigned long long>(stats.trianglesSubmitted), static_cast<unsigned long long>(stats.trianglesFrustumCulled),
+        static_cast<unsigned long long>(stats.trianglesClipped), static_cast<unsigned long long>(stats.trianglesBackfaceCulled),
+        static_cast<unsigned long long>(stats.trianglesZeroArea), static_cast<unsigned long long>(stats.trianglesTooSmall),
+        static_cast<unsigned long long>(stats.trianglesRasterized));
+    printf("  %llu fragments depth tested, %llu passed, %llu pixels written (%s)\n",
+        static_cast<unsigned long long>(stats.fragmentsDepthTested), static_cast<unsigned long long>(stats.fragmentsPassedDepth),
+        static_cast<unsigned long long>(stats.pixelsWritten), passed ? "ok" : "FAILED");
+    printf("\n");
+    return passed;
+}
+
+
+// Back facing triangles drawn with culling off must come out exactly the
+// same as the same triangles wound the other way.
+static bool CheckCullModes()
+{
+    const uint32_t frameWidth = 160;
+    const uint32_t frameHeight = 120;
+    SoftwareRenderer renderer { frameWidth, frameHeight };
+
+    auto vertex = [](float x, float y) { return Vertex { glm::vec3 { x, y, 0.0f }, { 1.0f, 0.5f, 0.25f }, { 0.0f, 0.0f } }; };
+    const std::vector<Vertex> clockwise = { vertex(-0.9f, 0.8f), vertex(-0.1f, 0.7f), vertex(-0.6f, -0.8f) };
+    const std::vector<Vertex> counterClockwise = { vertex(0.1f, 0.7f), vertex(0.4f, -0.9f), vertex(0.8f, 0.6f) };
+    const std::vector<Vertex> counterClockwiseTurned = { counterClockwise[0], counterClockwise[2], counterClockwise[1] };
+
+    auto draw = [&](FrontFace frontFace, CullMode cullMode, std::initializer_list<const std::vector<Vertex>*> meshes) {
+        renderer.SetFrontFace(frontFace);
+        renderer.SetCullMode(cullMode);
+        renderer.Clear(0, 0, 0);
+        for (const auto* pMesh : meshes)
+        {
+            renderer.DrawTriangleList(*pMesh);
+        }
+        const uint8_t* pPixels = renderer.GetFramebufferPointer();
+        return std::vector<uint8_t> { pPixels, pPixels + frameWidth * frameHeight * 4 };
+    };
+
+    const auto left = draw(FrontFace::Clockwise, CullMode::Back, { &clockwise });
+    const auto right = draw(FrontFace::Clockwise, CullMode::Back, { &counterClockwiseTurned });
+    const auto both = draw(FrontFace::Clockwise, CullMode::Back, { &clockwise, &counterClockwiseTurned });
+
+    const bool passed =
+        draw(FrontFace::Clockwise, CullMode::Back, { &clockwise, &counterClockwise }) == left &&
+        draw(FrontFace::Clockwise, CullMode::Front, { &clockwise, &counterClockwise }) == right &&
+        draw(FrontFace::Clockwise, CullMode::None, { &clockwise, &counterClockwise }) == both &&
+        draw(FrontFace::CounterClockwise, CullMode::Back, { &clockwise, &counterClockwise }) == right &&
+        draw(FrontFace::CounterClockwise, CullMode::Front, { &clockwise, &counterClockwise }) == left &&
+        left != right;
+
+    // A command buffer that changes the cull mode and front face between
+    // draws keeps only the right triangle, whatever the renderer's own state,
+    // and leaves that state alone.
+    const VertexBuffer clockwiseBuffer { clockwise };
+    const VertexBuffer counterClockwiseBuffer { counterClockwise };
+    CommandBuffer commands;
+    commands.SetCullMode(CullMode::Front);
+    commands.DrawTriangleList(clockwiseBuffer);
+    commands.SetFrontFace(FrontFace::CounterClockwise);
+    commands.SetCullMode(CullMode::Back);
+    commands.DrawTriangleList(counterClockwiseBuffer);
+
+    renderer.SetFrontFace(FrontFace::Clockwise);
+    renderer.SetCullMode(CullMode::None);
+    auto frame = [&]() {
+        const uint8_t* pPixels = renderer.GetFramebufferPointer();
+        return std::vector<uint8_t> { pPixels, pPixels + frameWidth * frameHeight * 4 };
+    };
+    renderer.Clear(0, 0, 0);
+    renderer.Submit(commands);
+    const auto replayedFrame = frame();
+    renderer.Clear(0, 0, 0);
+    renderer.DrawTriangleList(clockwise);
+    renderer.DrawTriangleList(counterClockwiseTurned);
+    const bool replayed = replayedFrame == right && frame() == both;
+
+    printf("Cull modes: front faces, back faces and both drawn as expected (%s)\n", passed ? "ok" : "FAILED");
+    printf("Cull modes: command buffer replayed with its own cull modes (%s)\n", replayed ? "ok" : "FAILED");
+    printf("\n");
+    return passed && replayed;
+}
+
+
+// Each raster state against what it should draw, in the middle of the frame.
+static bool CheckRasterState()
+{
+    const uint32_t frameWidth = 64;
+    const uint32_t frameHeight = 64;
+    SoftwareRenderer renderer { frameWidth, frameHeight };
+    renderer.SetColorSource(ColorSource::VertexColor);
+    renderer.SetProjectionMatrix(glm::perspective(glm::radians(90.0f), 1.0f, 0.5f, 10.0f));
+
+    // Blue, green, red and alpha.
+    const uint8_t texel[4] = { 0xff, 0x80, 0x40, 0xff };
+    const uint32_t texture = renderer.CreateTexture();
+    renderer.UpdateTexture(texture, 1, 1, texel);
+
+    // A flat colored square at the given depth, covering the middle.
+    auto square = [](float z, const glm::vec3& color) {
+        return std::vector<Vertex> {
+            { glm::vec3 { -0.5f, 0.5f, z }, color, { 0.0f, 0.0f } },
+            { glm::vec3 { 0.5f, 0.5f, z }, color, { 0.0f, 0.0f } },
+            { glm::vec3 { -0.5f, -0.5f, z }, color, { 0.0f, 0.0f } },
+            { glm::vec3 { 0.5f, 0.5f, z }, color, { 0.0f, 0.0f } },
+            { glm::vec3 { 0.5f, -0.5f, z }, color, { 0.0f, 0.0f } },
+            { glm::vec3 { -0.5f, -0.5f, z }, color, { 0.0f, 0.0f } },
+        };
+    };
+    const std::vector<Vertex> nearRed = square(-1.0f, { 1.0f, 0.0f, 0.0f });
+    const std::vector<Vertex> farBlue = square(-2.0f, { 0.0f, 0.0f, 1.0f });
+
+    // As R, G, B. Off the diagonal the square's triangles share.
+    auto center = [&]() {
+        const uint8_t* pPixel = renderer.GetFramebufferPointer() + ((frameHeight / 2 - 4) * frameWidth + frameWidth / 2 - 4) * 4;
+        return glm::ivec3 { pPixel[2], pPixel[1], pPixel[0] };
+    };
+
+    bool passed = true;
+    auto expect = [&](const char* pName, const glm::ivec3& expected) {
+        const glm::ivec3 actual = center();
+        if (actual != expected)
+        {
+            printf("  %s: got %d %d %d, expected %d %d %d\n", pName, actual.r, actual.g, actual.b, expected.r, expected.g, expected.b);
+            passed = false;
+        }
+    };
+
+    renderer.Clear(0, 0, 0);
+    renderer.DrawTriangleList(nearRed);
+    renderer.DrawTriangleList(farBlue);
+    expect("depth test", { 255, 0, 0 });
+
+    renderer.Clear(0, 0, 0);
+    renderer.DrawTriangleList(nearRed);
+    renderer.SetDepthTest(false);
+    renderer.DrawTriangleList(farBlue);
+    renderer.SetDepthTest(true);
+    expect("no depth test", { 0, 0, 255 });
+
+    renderer.Clear(0, 0, 0);
+    renderer.SetDepthWrite(false);
+    renderer.DrawTriangleList(nearRed);
+    renderer.SetDepthWrite(true);
+    renderer.DrawTriangleList(farBlue);
+    expect("no depth write", { 0, 0, 255 });
+
+    renderer.Clear(0, 0, 0);
+    renderer.SetColorWrite(false);
+    renderer.DrawTriangleList(nearRed);
+    renderer.SetColorWrite(true);
+    renderer.DrawTriangleList(farBlue);
+    expect("depth only", { 0, 0, 0 });
+
+    renderer.UseTexture(texture);
+    renderer.Clear(0, 0, 0);
+    renderer.SetBlendMode(BlendMode::Replace);
+    renderer.DrawTriangleList(nearRed);
+    expect("replace", { 0x40, 0x80, 0xff });
+
+    renderer.Clear(0, 0, 0);
+    renderer.SetBlendMode(BlendMode::Modulate);
+    renderer.DrawTriangleList(nearRed);
+    expect("modulate", { 0x40, 0, 0 });
+
+    renderer.Clear(0, 0, 0);
+    renderer.SetBlendMode(BlendMode::Mix);
+    renderer.DrawTriangleList(nearRed);
+    expect("mix", { static_cast<int>(0xff * (0.5f + 0.5f * 0x40 / 255.0f)), static_cast<int>(0xff * (0.5f * 0x80 / 255.0f)), static_cast<int>(0xff * (0.5f * 0xff / 255.0f)) });
+
+    // The visibility buffer can't turn any of them off, and says so.
+    RendererOptions deferredOptions;
+    deferredOptions.shadingMode = ShadingMode::VisibilityBuffer;
+    SoftwareRenderer deferred { frameWidth, frameHeight, deferredOptions };
+    if (deferred.SetDepthTest(false) || deferred.SetDepthWrite(false) || deferred.SetColorWrite(false) || ! deferred.SetDepthTest(true))
+    {
+        printf("  visibility buffer: depth test, depth write or color write turned off\n");
+        passed = false;
+    }
+
+    // A run of draws, each with its own state, drawn directly and then
+    // replayed from a command buffer while the renderer is set up otherwise.
+    auto shifted = [](std::vector<Vertex> vertices, float x, float y) {
+        for (auto& rVertex : vertices)
+        {
+            rVertex.position += glm::vec4 { x, y, 0.0f, 0.0f };
+        }
+        return vertices;
+    };
+    struct Step
+    {
+        std::vector<Vertex> vertices;
+        bool depthTest;
+        bool depthWrite;
+        bool colorWrite;
+        ColorSource colorSource;
+        BlendMode blendMode;
+    };
+    const Step steps[] = {
+        { nearRed, true, false, true, ColorSource::VertexColor, BlendMode::Replace },
+        { farBlue, true, true, true, ColorSource::DebugColor, BlendMode::Mix },
+        { shifted(nearRed, -0.3f, 0.2f), true, true, false, ColorSource::VertexColor, BlendMode::Mix },
+        { shifted(farBlue, -0.2f, 0.1f), true, true, true, ColorSource::VertexColor, BlendMode::Modulate },
+        { shifted(farBlue, 0.3f, -0.2f), false, true, true, ColorSource::DebugColor, BlendMode::Replace },
+    };
+    auto frame = [&]() {
+        const uint8_t* pPixels = renderer.GetFramebufferPointer();
+        return std::vector<uint8_t> { pPixels, pPixels + frameWidth * frameHeight * 4 };
+    };
+
+    renderer.Clear(0, 0, 0);
+    for (const auto& rStep : steps)
+    {
+        renderer.SetDepthTest(rStep.depthTest);
+        renderer.SetDepthWrite(rStep.depthWrite);
+        renderer.SetColorWrite(rStep.colorWrite);
+        renderer.SetColorSource(rStep.colorSource);
+        renderer.SetBlendMode(rStep.blendMode);
+        renderer.DrawTriangleList(rStep.vertices);
+    }
+    const auto direct = frame();
+
+    std::vector<VertexBuffer> buffers;
+    buffers.reserve(sizeof(steps) / sizeof(steps[0]));
+    CommandBuffer commands;
+    commands.SetProjectionMatrix(glm::perspective(glm::radians(90.0f), 1.0f, 0.5f, 10.0f));
+    commands.UseTexture(texture);
+    for (const auto& rStep : steps)
+    {
+        buffers.emplace_back(rStep.vertices);
+        commands.SetDepthTest(rStep.depthTest);
+        commands.SetDepthWrite(rStep.depthWrite);
+        commands.SetColorWrite(rStep.colorWrite);
+        commands.SetColorSource(rStep.colorSource);
+        commands.SetBlendMode(rStep.blendMode);
+        commands.DrawTriangleList(buffers.back());
+    }
+
+    // The renderer's own state, which Submit must leave as it found it.
+    renderer.SetDepthTest(true);
+    renderer.SetDepthWrite(false);
+    renderer.SetColorWrite(true);
+    renderer.SetColorSource(ColorSource::VertexColor);
+    renderer.SetBlendMode(BlendMode::Modulate);
+    renderer.Clear(0, 0, 0);
+    renderer.DrawTriangleList(nearRed);
+    renderer.DrawTriangleList(farBlue);
+    const auto before = frame();
+
+    renderer.Clear(0, 0, 0);
+    renderer.Submit(commands);
+    const auto replayed = frame();
+
+    renderer.Clear(0, 0, 0);
+    renderer.DrawTriangleList(nearRed);
+    renderer.DrawTriangleList(farBlue);
+    const bool replayPassed = replayed == direct && frame() == before;
+
+    printf("Raster state: depth test and write, color write and blend modes (%s)\n", passed ? "ok" : "FAILED");
+    printf("Raster state: command buffer replayed with its own raster state (%s)\n", replayPassed ? "ok" : "FAILED");
+    printf("\n");
+    return passed && replayPassed;
+}
+
+
+// Vertex buffers with more varyings than a Vertex has, or fewer, must draw
+// just what the standard ones do with the varyings they share, clipped or not.
+static bool CheckVaryingCounts()
+{
+    const uint32_t frameWidth = 64;
+    const uint32_t frameHeight = 64;
+    SoftwareRenderer renderer { frameWidth, frameHeight };
+    renderer.SetColorSource(ColorSource::VertexColor);
+    renderer.SetProjectionMatrix(glm::perspective(glm::radians(90.0f), 1.0f, 0.5f, 10.0f));
+
+    // A 2x2 checker, as blue, green, red and alpha.
+    const uint8_t texels[16] = {
+        0xff, 0x00, 0x00, 0xff, 0x00, 0xff, 0x00, 0xff,
+        0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    };
+    const uint32_t texture = renderer.CreateTexture();
+    renderer.UpdateTexture(texture, 2, 2, texels);
+    renderer.UseSampler(renderer.CreateSampler({ TextureWrap::Repeat, TextureWrap::Repeat, TextureFilter::Bilinear, MipFilter::None }));
+
+    // A floor running from behind the camera into the distance,
+    // so that it gets clipped against the near plane.
+    const std::vector<Vertex> vertices {
+        { glm::vec3 { -2.0f, -1.0f, 1.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f } },
+        { glm::vec3 { -2.0f, -1.0f, -8.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 5.0f } },
+        { glm::vec3 { 2.0f, -1.0f, 1.0f }, { 0.0f, 1.0f, 0.0f }, { 3.0f, 0.0f } },
+        { glm::vec3 { 2.0f, -1.0f, 1.0f }, { 0.0f, 1.0f, 0.0f }, { 3.0f, 0.0f } },
+        { glm::vec3 { -2.0f, -1.0f, -8.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 5.0f } },
+        { glm::vec3 { 2.0f, -1.0f, -8.0f }, { 1.0f, 1.0f, 0.0f }, { 3.0f, 5.0f } },
+    };
+    auto makeBuffer = [&vertices](uint32_t varyingCount) {
+        VertexBuffer buffer { varyingCount };
+        buffer.Resize(vertices.size());
+        for (uint32_t i = 0; i < vertices.size(); i++)
+        {
+            buffer.SetVertex(i, vertices[i]);
+        }
+
+        // Anything at all in the ones past a Vertex's.
+        for (uint32_t i = VERTEX_VARYING_COUNT; i < varyingCount; i++)
+        {
+            for (uint32_t j = 0; j < vertices.size(); j++)
+            {
+                buffer.GetVaryingStream(i)[j] = static_cast<float>(i * 7 + j) * 0.3f - 2.0f;
+            }
+        }
+        return buffer;
+    };
+    const VertexBuffer standard = makeBuffer(VERTEX_VARYING_COUNT);
+    const VertexBuffer extra = makeBuffer(VERTEX_MAX_VARYINGS);
+    const VertexBuffer colorOnly = makeBuffer(static_cast<uint32_t>(VertexVarying::ColorB) + 1);
+
+    auto draw = [&](const VertexBuffer& buffer) {
+        renderer.Clear(0, 0, 0);
+        renderer.DrawTriangleList(buffer);
+        const uint8_t* pPixels = renderer.GetFramebufferPointer();
+        return std::vector<uint8_t> { pPixels, pPixels + frameWidth * frameHeight * 4 };
+    };
+
+    const bool colorPassed = draw(colorOnly) == draw(standard);
+
+    renderer.UseTexture(texture);
+    const auto textured = draw(standard);
+    bool drawn = false;
+    for (uint32_t i = 0; i < frameWidth * frameHeight; i++)
+    {
+        drawn = drawn || textured[i * 4 + 0] != 0 || textured[i * 4 + 1] != 0 || textured[i * 4 + 2] != 0;
+    }
+    const bool texturedPassed = drawn && draw(extra) == textured;
+
+    printf("Varying counts: color only, as the standard ones (%s)\n", colorPassed ? "ok" : "FAILED");
+    printf("Varying counts: %u varyings, as the standard ones, textured and clipped (%s)\n", VERTEX_MAX_VARYINGS, texturedPassed ? "ok" : "FAILED");
+    printf("\n");
+    return colorPassed && texturedPassed;
+}
+
+
+// Overlapping squares drawn in every pair of buffer formats must come out
+// as they do in RGBA8 and float depth, give or take the color format's
+// rounding. Then again, cleared to a depth between the squares.
+static bool CheckRenderTargetFormats()
+{
+    const uint32_t frameWidth = 64;
+    const uint32_t frameHeight = 64;
+    const float nearPlane = 0.5f;
+
+    // A square with a color to each corner, at a distance, in front of
+    // or behind the others depending on where it is drawn.
+    auto square = [](float x, float y, float z) {
+        return std::vector<Vertex> {
+            { glm::vec3 { x - 0.6f, y + 0.6f, z }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f } },
+            { glm::vec3 { x + 0.6f, y + 0.6f, z }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f } },
+            { glm::vec3 { x - 0.6f, y - 0.6f, z }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f } },
+            { glm::vec3 { x + 0.6f, y + 0.6f, z }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f } },
+            { glm::vec3 { x + 0.6f, y - 0.6f, z }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } },
+            { glm::vec3 { x - 0.6f, y - 0.6f, z }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f } },
+        };
+    };
+    const std::vector<Vertex> squares[] = {
+        square(0.0f, 0.0f, -2.0f),
+        square(-0.4f, 0.3f, -1.0f),
+        square(0.5f, -0.2f, -3.0f),
+        square(0.2f, 0.4f, -1.5f),
+        square(-0.3f, -0.5f, -4.0f),
+    };
+
+    auto render = [&](TextureFormat colorFormat, DepthFormat depthFormat, float clearDepth) {
+        RendererOptions options;
+        options.colorFormat = colorFormat;
+        options.depthFormat = depthFormat;
+        options.depthNear = nearPlane;
+        SoftwareRenderer renderer { frameWidth, frameHeight, options };
+        renderer.SetColorSource(ColorSource::VertexColor);
+        renderer.SetProjectionMatrix(glm::perspective(glm::radians(90.0f), 1.0f, nearPlane, 10.0f));
+        renderer.Clear(ClearFlags::All, 0x20, 0x40, 0x60, clearDepth);
+        for (const auto& rSquare : squares)
+        {
+            renderer.DrawTriangleList(rSquare);
+        }
+        const uint8_t* pPixels = renderer.GetFramebufferPointer();
+        return std::vector<uint8_t>(pPixels, pPixels + frameWidth * frameHeight * 4);
+    };
+
+    const std::pair<const char*, TextureFormat> colorFormats[] = {
+        { "rgba8", TextureFormat::RGBA8 },
+        { "rgb565", TextureFormat::RGB565 },
+        { "rgb666", TextureFormat::RGB666 },
+    };
+    const std::pair<const char*, DepthFormat> depthFormats[] = {
+        { "float32", DepthFormat::Float32 },
+        { "unorm16", DepthFormat::Unorm16 },
+        { "unorm24", DepthFormat::Unorm24 },
+    };
+
+    bool passed = true;
+    for (const float clearDepth : { std::numeric_limits<float>::infinity(), 2.5f })
+    {
+        const std::vector<uint8_t> expected = render(TextureFormat::RGBA8, DepthFormat::Float32, clearDepth);
+        for (const auto& rColorFormat : colorFormats)
+        {
+            // Rounded to 5 or 6 bits, then widened back to 8.
+            const int tolerance = rColorFormat.second == TextureFormat::RGBA8 ? 0 : rColorFormat.second == TextureFormat::RGB565 ? 6 : 4;
+            for (const auto& rDepthFormat : depthFormats)
+            {
+                const std::vector<uint8_t> actual = render(rColorFormat.second, rDepthFormat.second, clearDepth);
+                uint32_t badPixels = 0;
+                for (size_t i = 0; i < actual.size(); i += 4)
+                {
+                    for (size_t channel = 0; channel < 3; channel++)
+                    {
+                        if (std::abs(actual[i + channel] - expected[i + channel]) > tolerance)
+                        {
+                            badPixels++;
+                            break;
+                        }
+                    }
+                }
+                if (badPixels != 0)
+                {
+                    printf("  %s, %s, cleared to %g: %u pixels off\n", rColorFormat.first, rDepthFormat.first, clearDepth, badPixels);
+                    passed = false;
+                }
+            }
+        }
+    }
+
+    // Colors outside 0 to 1 are clamped, in every format, rather than
+    // spilling into the next channel's bits.
+    auto flat = [&](TextureFormat colorFormat, const glm::vec3& color) {
+        RendererOptions options;
+        options.colorFormat = colorFormat;
+        SoftwareRenderer renderer { frameWidth, frameHeight, options };
+        renderer.SetColorSource(ColorSource::VertexColor);
+        renderer.Clear(0, 0, 0);
+        renderer.DrawTriangleList({
+            { glm::vec3 { -0.5f, 0.5f, 0.0f }, color, { 0.0f, 0.0f } },
+            { glm::vec3 { 0.5f, 0.5f, 0.0f }, color, { 0.0f, 0.0f } },
+            { glm::vec3 { 0.0f, -0.5f, 0.0f }, color, { 0.0f, 0.0f } },
+        });
+        const uint8_t* pPixels = renderer.GetFramebufferPointer();
+        return std::vector<uint8_t>(pPixels, pPixels + frameWidth * frameHeight * 4);
+    };
+    for (const auto& rColorFormat : colorFormats)
+    {
+        if (flat(rColorFormat.second, { 1.5f, -0.5f, 1.04f }) != flat(rColorFormat.second, { 1.0f, 0.0f, 1.0f }))
+        {
+            printf("  %s: out of range color not clamped\n", rColorFormat.first);
+            passed = false;
+        }
+    }
+
+    printf("Render target formats: every color and depth format drawn as expected (%s)\n", passed ? "ok" : "FAILED");
+    printf("\n");
+    return passed;
+}
+
+
+// The hierarchy must find exactly the objects a test of every one of them
+// would, wherever the camera is, and after objects have moved.
+static bool CheckSceneCulling()
+{
+    const std::vector<Vertex> triangle = {
+        { glm::vec3 { -1.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } },
+        { glm::vec3 { 1.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } },
+        { glm::vec3 { 0.0f, -1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } },
+    };
+    const VertexBuffer triangleBuffer { triangle };
+
+    std::mt19937 random { 13579 };
+    std::uniform_real_distribution<float> position { -100.0f, 100.0f };
+    std::uniform_real_distribution<float> angle { -3.1415927f, 3.1415927f };
+    auto randomModel = [&]() {
+        return glm::rotate(glm::translate(glm::mat4 { 1.0f }, { position(random), position(random) * 0.1f, position(random) }), angle(random), { 0.0f, 1.0f, 0.0f });
+    };
+
+    Scene scene;
+    for (int i = 0; i < 3000; i++)
+    {
+        scene.AddObject(triangleBuffer, randomModel());
+    }
+
+    const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 4.0f / 3.0f, 0.5f, 60.0f);
+    CommandBuffer commands;
+    bool passed = true;
+    uint64_t visibleObjects = 0;
+    for (int camera = 0; camera < 20; camera++)
+    {
+        if (camera == 10)
+        {
+            for (uint32_t id = 0; id < scene.GetObjectCount(); id += 2)
+            {
+                scene.SetModelMatrix(id, randomModel());
+            }
+        }
+
+        const glm::mat4 view = glm::lookAt(
+            glm::vec3 { position(random), 5.0f, position(random) },
+            glm::vec3 { position(random), 0.0f, position(random) },
+            glm::vec3 { 0.0f, 1.0f, 0.0f }
+        );
+        const Frustum frustum = ExtractFrustum(projection * view);
+        uint64_t expected = 0;
+        for (uint32_t id = 0; id < scene.GetObjectCount(); id++)
+        {
+            uint8_t planeMask = FRUSTUM_ALL_PLANES;
+            expected += ClassifyBounds(frustum, scene.GetWorldBounds(id), planeMask) != FrustumCoverage::Outside ? 1 : 0;
+        }
+
+        commands.Reset();
+        scene.Cull(projection, view, commands);
+        passed = passed && commands.GetDraws().size() == expected && scene.GetCullStats().visibleObjects == expected;
+        visibleObjects += expected;
+    }
+
+    printf("Scene culling: %llu objects visible from 20 cameras, the same as testing each one (%s)\n",
+        static_cast<unsigned long long>(visibleObjects), passed ? "ok" : "FAILED");
+    printf("\n");
+    return passed;
+}
+
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    BenchRasterKernels();
+    BenchTransformKernels();
+    BenchTextureSampling();
+    BenchTextureLayouts();
+    BenchTextureMipmaps();
+    BenchTextureSamplers();
+    BenchSkinnyTriangles();
+    BenchClears();
+    BenchOverdraw();
+    BenchRasterState();
+    BenchRenderTargetFormats();
+    BenchCommandBuffers();
+    BenchSceneCulling();
+    BenchInstancing();
+    BenchPresent();
+
+    bool passed = CheckFixedPointWatertight();
+    passed = CheckSteadyStateAllocations() && passed;
+    passed = CheckPresentedFrames() && passed;
+    passed = CheckPipelineStats() && passed;
+    passed = CheckCullModes() && passed;
+    passed = CheckRasterState() && passed;
+    passed = CheckVaryingCounts() && passed;
+    passed = CheckRenderTargetFormats() && passed;
+    passed = CheckSceneCulling() && passed;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+
+#include <algorithm>
+#include <chrono>
+
+#include "Presenter.hpp"
+
+
+Presenter::Presenter(const PresentFunction& func) :
+    m_PresentFunc { func },
+    m_Mutex {},
+    m_SubmitCondition {},
+    m_PresentedCondition {},
+    m_Queue {},
+    m_pPresenting { nullptr },
+    m_PresentedFrames { 0 },
+    m_PresentMilliseconds { 0.0 },
+    m_ShuttingDown { false },
+    m_Thread { &Presenter::PresenterMain, this }
+{
+}
+
+
+Presenter::~Presenter()
+{
+    {
+        std::lock_guard<std::mutex> lock { m_Mutex };
+        m_ShuttingDown = true;
+    }
+    m_SubmitCondition.notify_one();
+    m_Thread.join();
+}
+
+
+void Presenter::Submit(const uint8_t* pPixels)
+{
+    {
+        std::lock_guard<std::mutex> lock { m_Mutex };
+        m_Queue.push_back(pPixels);
+    }
+    m_SubmitCondition.notify_one();
+}
+
+
+void Presenter::Wait(const uint8_t* pPixels)
+{
+    std::unique_lock<std::mutex> lock { m_Mutex };
+    m_PresentedCondition.wait(lock, [this, pPixels]() { return ! IsBusyWith(pPixels); });
+}
+
+
+uint64_t Presenter::GetPresentedFrames() const
+{
+    std::lock_guard<std::mutex> lock { m_Mutex };
+    return m_PresentedFrames;
+}
+
+
+double Presenter::GetPresentMilliseconds() const
+{
+    std::lock_guard<std::mutex> lock { m_Mutex };
+    return m_PresentMilliseconds;
+}
+
+
+void Presenter::PresenterMain()
+{
+    std::unique_lock<std::mutex> lock { m_Mutex };
+    while (true)
+    {
+        m_SubmitCondition.wait(lock, [this]() { return m_ShuttingDown || ! m_Queue.empty(); });
+        if (m_Queue.empty())
+        {
+            return;
+        }
+
+        m_pPresenting = m_Queue.front();
+        m_Queue.erase(m_Queue.begin());
+        lock.unlock();
+
+        const auto start = std::chrono::steady_clock::now();
+        m_PresentFunc(m_pPresenting);
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+        lock.lock();
+        m_pPresenting = nullptr;
+        m_PresentedFrames++;
+        m_PresentMilliseconds += elapsed.count();
+        m_PresentedCondition.notify_all();
+    }
+}
+
+
+bool Presenter::IsBusyWith(const uint8_t* pPixels) const
+{
+    return m_pPresenting == pPixels || std::find(m_Queue.begin(), m_Queue.end(), pPixels) != m_Queue.end();
+}
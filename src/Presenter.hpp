@@ -0,0 +1,66 @@
+
+#ifndef PRESENTER_HPP
+#define PRESENTER_HPP
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// A thread which presents finished frames, one at a time and in the order
+// they were submitted, so that the next frame can be drawn in the meantime.
+class Presenter
+{
+public:
+
+    // Called on the presenter thread with a frame's BGRA pixels. The pixels
+    // aren't touched again until it returns.
+    using PresentFunction = std::function<void(const uint8_t* pPixels)>;
+
+    explicit Presenter(const PresentFunction& func);
+
+    // Presents whatever is still queued first.
+    ~Presenter();
+
+    Presenter(const Presenter&) = delete;
+    Presenter& operator=(const Presenter&) = delete;
+
+    // Queues a frame and returns straight away.
+    void Submit(const uint8_t* pPixels);
+
+    // Returns once pPixels is neither queued nor being presented.
+    void Wait(const uint8_t* pPixels);
+
+    uint64_t GetPresentedFrames() const;
+
+    // Total time spent in the present function.
+    double GetPresentMilliseconds() const;
+
+private:
+
+    void PresenterMain();
+    bool IsBusyWith(const uint8_t* pPixels) const;
+
+
+    const PresentFunction m_PresentFunc;
+
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_SubmitCondition;
+    std::condition_variable m_PresentedCondition;
+    std::vector<const uint8_t*> m_Queue;
+    const uint8_t* m_pPresenting;
+    uint64_t m_PresentedFrames;
+    double m_PresentMilliseconds;
+    bool m_ShuttingDown;
+
+    // Started last, once everything it uses is set up.
+    std::thread m_Thread;
+
+};
+
+
+#endif
@@ -0,0 +1,172 @@
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "RasterKernel.hpp"
+
+
+TriangleEdges SetupTriangleEdges(float x0, float y0, float x1, float y1, float x2, float y2, float oneOverW0, float oneOverW1, float oneOverW2)
+{
+    TriangleEdges edges;
+
+    // E(p) for the edge p1 -> p2 is (p2 - p1).x * (p - p1).y - (p2 - p1).y * (p - p1).x,
+    // which expands to a * p.x + b * p.y + c.
+    auto setupEdge = [&edges](int i, float px1, float py1, float px2, float py2) {
+        edges.a[i] = py1 - py2;
+        edges.b[i] = px2 - px1;
+        edges.c[i] = (py2 - py1) * px1 - (px2 - px1) * py1;
+    };
+    setupEdge(0, x0, y0, x1, y1);
+    setupEdge(1, x1, y1, x2, y2);
+    setupEdge(2, x2, y2, x0, y0);
+
+    const float totalArea = (x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0);
+    edges.invArea = 1.0f / totalArea;
+
+    edges.oneOverW0 = oneOverW0;
+    edges.oneOverWDelta1 = oneOverW1 - oneOverW0;
+    edges.oneOverWDelta2 = oneOverW2 - oneOverW0;
+
+    return edges;
+}
+
+
+RectCoverage ClassifyRect(const TriangleEdges& edges, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+{
+    bool inside = true;
+    for (int i = 0; i < 3; i++)
+    {
+        // Edge functions are linear, so their smallest and largest
+        // values over the rectangle are at its corners.
+        const float corner = edges.a[i] * static_cast<float>(x0) + edges.b[i] * static_cast<float>(y0) + edges.c[i];
+        const float dx = edges.a[i] * static_cast<float>(x1 - x0);
+        const float dy = edges.b[i] * static_cast<float>(y1 - y0);
+        const float minimum = corner + std::min(dx, 0.0f) + std::min(dy, 0.0f);
+        const float maximum = corner + std::max(dx, 0.0f) + std::max(dy, 0.0f);
+
+        if (maximum <= 0)
+        {
+            return RectCoverage::Outside;
+        }
+        if (minimum <= 0)
+        {
+            inside = false;
+        }
+    }
+    return inside ? RectCoverage::Inside : RectCoverage::Partial;
+}
+
+
+float GetNearestDepth(const TriangleEdges& edges, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+{
+    // 1/w is linear in screen space, so it is largest at one of the corners.
+    double oneOverW = -std::numeric_limits<double>::infinity();
+    for (const uint32_t x : { x0, x1 })
+    {
+        for (const uint32_t y : { y0, y1 })
+        {
+            const double w1 = (static_cast<double>(edges.a[2]) * x + static_cast<double>(edges.b[2]) * y + edges.c[2]) * edges.invArea;
+            const double w2 = (static_cast<double>(edges.a[0]) * x + static_cast<double>(edges.b[0]) * y + edges.c[0]) * edges.invArea;
+            oneOverW = std::max(oneOverW, edges.oneOverW0 + w1 * edges.oneOverWDelta1 + w2 * edges.oneOverWDelta2);
+        }
+    }
+
+    // The kernels step edge values from pixel to pixel in single precision,
+    // so their barycentrics are a little off. Allow for far more than that.
+    double edgeMagnitude = 0.0;
+    for (int i = 0; i < 3; i++)
+    {
+        edgeMagnitude = std::max(edgeMagnitude, std::abs(edges.a[i]) * static_cast<double>(x1) + std::abs(edges.b[i]) * static_cast<double>(y1) + std::abs(edges.c[i]));
+    }
+    const double barycentricError = std::ldexp(edgeMagnitude * std::abs(edges.invArea), -16) + std::ldexp(1.0, -20);
+    const double deltas = std::abs(edges.oneOverWDelta1) + std::abs(edges.oneOverWDelta2);
+    oneOverW += barycentricError * deltas + std::ldexp(std::abs(edges.oneOverW0) + deltas, -20);
+
+    if (oneOverW <= 0.0)
+    {
+        return 0.0f;
+    }
+    return 1.0f / static_cast<float>(oneOverW);
+}
+
+
+// The reference kernel. The SIMD kernels must do exactly the same
+// floating point operations, in the same order, for each pixel.
+void RasterRowScalar(const TriangleEdges& edges, const float rowEdges[3], uint64_t activeMask, RasterSpan& rSpan)
+{
+    float groupEdges[3] = { rowEdges[0], rowEdges[1], rowEdges[2] };
+    float groupStep[3];
+    for (int i = 0; i < 3; i++)
+    {
+        groupStep[i] = edges.a[i] * static_cast<float>(RASTER_GROUP_SIZE);
+    }
+
+    uint64_t coverage = 0;
+    for (uint32_t groupStart = 0; groupStart < RASTER_SPAN_MAX; groupStart += RASTER_GROUP_SIZE)
+    {
+        if (((activeMask >> groupStart) & 0xff) == 0)
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                groupEdges[i] += groupStep[i];
+            }
+            continue;
+        }
+
+        for (uint32_t lane = 0; lane < RASTER_GROUP_SIZE; lane++)
+        {
+            const float offset = static_cast<float>(lane);
+            const float e0 = groupEdges[0] + edges.a[0] * offset;
+            const float e1 = groupEdges[1] + edges.a[1] * offset;
+            const float e2 = groupEdges[2] + edges.a[2] * offset;
+
+            const float w1 = e2 * edges.invArea;
+            const float w2 = e0 * edges.invArea;
+            const float oneOverW = edges.oneOverW0 + w1 * edges.oneOverWDelta1 + w2 * edges.oneOverWDelta2;
+
+            const uint32_t i = groupStart + lane;
+            rSpan.depth[i] = 1.0f / oneOverW;
+
+            // Assumes clockwise winding for front faces
+            if (e0 > 0 && e1 > 0 && e2 > 0)
+            {
+                coverage |= uint64_t { 1 } << i;
+            }
+        }
+
+        for (int i = 0; i < 3; i++)
+        {
+            groupEdges[i] += groupStep[i];
+        }
+    }
+
+    rSpan.coverage = coverage & activeMask;
+}
+
+
+const std::vector<RasterKernel>& GetAvailableRasterKernels()
+{
+    static const std::vector<RasterKernel> kernels = []() {
+        std::vector<RasterKernel> available { { "scalar", RasterRowScalar } };
+#ifdef GPU_X86_KERNELS
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("sse4.1"))
+        {
+            available.push_back({ "sse4", RasterRowSSE4 });
+        }
+        if (__builtin_cpu_supports("avx2"))
+        {
+            available.push_back({ "avx2", RasterRowAVX2 });
+        }
+#endif
+        return available;
+    }();
+    return kernels;
+}
+
+
+const RasterKernel& GetRasterKernel()
+{
+    return GetAvailableRasterKernels().back();
+}
@@ -0,0 +1,98 @@
+
+#ifndef RASTER_KERNEL_HPP
+#define RASTER_KERNEL_HPP
+
+#include <stdint.h>
+
+#include <vector>
+
+
+// Pixels are always evaluated in groups of this many, whatever instruction
+// set the kernel uses, and the edge values are stepped from group to group
+// the same way. That keeps every kernel bit-for-bit identical to the scalar one.
+const uint32_t RASTER_GROUP_SIZE = 8;
+
+// The longest run of pixels a kernel can evaluate in one call.
+const uint32_t RASTER_SPAN_MAX = 64;
+
+
+// Per-triangle setup, done once before rasterizing.
+//
+// Each edge function is E(x, y) = a * x + b * y + c, which is positive on
+// the inside of the edge. Edge 0 runs v0 -> v1, edge 1 v1 -> v2 and edge 2
+// v2 -> v0, so E2 and E0 (over the total area) are the barycentric
+// weights of v1 and v2.
+struct TriangleEdges
+{
+    float a[3];
+    float b[3];
+    float c[3];
+
+    float invArea;
+
+    // 1/w at v0, and how much it changes towards v1 and v2.
+    float oneOverW0;
+    float oneOverWDelta1;
+    float oneOverWDelta2;
+};
+
+
+// Results for one run of pixels along a row.
+struct RasterSpan
+{
+    alignas(32) float depth[RASTER_SPAN_MAX];
+
+    // Bit i is set if pixel i is inside the triangle.
+    uint64_t coverage;
+};
+
+
+// Evaluates the pixels of a row set in activeMask, where rowEdges holds the
+// edge values at the first pixel. Writes coverage and perspective-correct
+// depth (w) into rSpan. Varyings come from the triangle's attribute planes.
+// Groups without any active pixels are skipped. Other pixels may be
+// written, but are never covered.
+typedef void (*RasterRowFunction)(const TriangleEdges& edges, const float rowEdges[3], uint64_t activeMask, RasterSpan& rSpan);
+
+
+enum class RectCoverage
+{
+    Outside,
+    Inside,
+    Partial,
+};
+
+
+struct RasterKernel
+{
+    const char* name;
+    RasterRowFunction function;
+};
+
+
+TriangleEdges SetupTriangleEdges(float x0, float y0, float x1, float y1, float x2, float y2, float oneOverW0, float oneOverW1, float oneOverW2);
+
+// Classifies the pixels in the inclusive rectangle [x0, x1] x [y0, y1]
+// against all three edges, using the edge values at its corners.
+RectCoverage ClassifyRect(const TriangleEdges& edges, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1);
+
+// A depth no farther than any the kernels would give a covered pixel in the
+// inclusive rectangle [x0, x1] x [y0, y1], allowing for their rounding.
+float GetNearestDepth(const TriangleEdges& edges, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1);
+
+// Every kernel this CPU can run, starting with the scalar fallback.
+const std::vector<RasterKernel>& GetAvailableRasterKernels();
+
+// The fastest kernel this CPU can run, picked the first time it is asked for.
+const RasterKernel& GetRasterKernel();
+
+
+void RasterRowScalar(const TriangleEdges& edges, const float rowEdges[3], uint64_t activeMask, RasterSpan& rSpan);
+
+#ifdef GPU_X86_KERNELS
+void RasterRowSSE4(const TriangleEdges& edges, const float rowEdges[3], uint64_t activeMask, RasterSpan& rSpan);
+void RasterRowAVX2(const TriangleEdges& edges, const float rowEdges[3], uint64_t activeMask, RasterSpan& rSpan);
+#endif
+
+
+#endif
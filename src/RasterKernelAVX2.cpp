@@ -0,0 +1,68 @@
+
+// Built with -mavx2, and only called if the CPU supports it.
+
+#include <immintrin.h>
+
+#include "RasterKernel.hpp"
+
+
+void RasterRowAVX2(const TriangleEdges& edges, const float rowEdges[3], uint64_t activeMask, RasterSpan& rSpan)
+{
+    const __m256 offset = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    const __m256 a0 = _mm256_set1_ps(edges.a[0]);
+    const __m256 a1 = _mm256_set1_ps(edges.a[1]);
+    const __m256 a2 = _mm256_set1_ps(edges.a[2]);
+    const __m256 invArea = _mm256_set1_ps(edges.invArea);
+    const __m256 oneOverW0 = _mm256_set1_ps(edges.oneOverW0);
+    const __m256 oneOverWDelta1 = _mm256_set1_ps(edges.oneOverWDelta1);
+    const __m256 oneOverWDelta2 = _mm256_set1_ps(edges.oneOverWDelta2);
+
+    float groupEdges[3] = { rowEdges[0], rowEdges[1], rowEdges[2] };
+    float groupStep[3];
+    for (int i = 0; i < 3; i++)
+    {
+        groupStep[i] = edges.a[i] * static_cast<float>(RASTER_GROUP_SIZE);
+    }
+
+    uint64_t coverage = 0;
+    for (uint32_t groupStart = 0; groupStart < RASTER_SPAN_MAX; groupStart += RASTER_GROUP_SIZE)
+    {
+        if (((activeMask >> groupStart) & 0xff) == 0)
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                groupEdges[i] += groupStep[i];
+            }
+            continue;
+        }
+
+        const __m256 e0 = _mm256_add_ps(_mm256_set1_ps(groupEdges[0]), _mm256_mul_ps(a0, offset));
+        const __m256 e1 = _mm256_add_ps(_mm256_set1_ps(groupEdges[1]), _mm256_mul_ps(a1, offset));
+        const __m256 e2 = _mm256_add_ps(_mm256_set1_ps(groupEdges[2]), _mm256_mul_ps(a2, offset));
+
+        const __m256 w1 = _mm256_mul_ps(e2, invArea);
+        const __m256 w2 = _mm256_mul_ps(e0, invArea);
+        const __m256 oneOverW = _mm256_add_ps(
+            _mm256_add_ps(oneOverW0, _mm256_mul_ps(w1, oneOverWDelta1)),
+            _mm256_mul_ps(w2, oneOverWDelta2)
+        );
+
+        _mm256_store_ps(&rSpan.depth[groupStart], _mm256_div_ps(one, oneOverW));
+
+        const __m256 inside = _mm256_and_ps(
+            _mm256_and_ps(_mm256_cmp_ps(e0, zero, _CMP_GT_OQ), _mm256_cmp_ps(e1, zero, _CMP_GT_OQ)),
+            _mm256_cmp_ps(e2, zero, _CMP_GT_OQ)
+        );
+        coverage |= static_cast<uint64_t>(_mm256_movemask_ps(inside)) << groupStart;
+
+        for (int i = 0; i < 3; i++)
+        {
+            groupEdges[i] += groupStep[i];
+        }
+    }
+
+    rSpan.coverage = coverage & activeMask;
+}
@@ -0,0 +1,75 @@
+
+// Built with -msse4.1, and only called if the CPU supports it.
+
+#include <smmintrin.h>
+
+#include "RasterKernel.hpp"
+
+
+void RasterRowSSE4(const TriangleEdges& edges, const float rowEdges[3], uint64_t activeMask, RasterSpan& rSpan)
+{
+    // A group of 8 pixels is done as two halves of 4.
+    const __m128 offsetLow = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    const __m128 offsetHigh = _mm_setr_ps(4.0f, 5.0f, 6.0f, 7.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    const __m128 a0 = _mm_set1_ps(edges.a[0]);
+    const __m128 a1 = _mm_set1_ps(edges.a[1]);
+    const __m128 a2 = _mm_set1_ps(edges.a[2]);
+    const __m128 invArea = _mm_set1_ps(edges.invArea);
+    const __m128 oneOverW0 = _mm_set1_ps(edges.oneOverW0);
+    const __m128 oneOverWDelta1 = _mm_set1_ps(edges.oneOverWDelta1);
+    const __m128 oneOverWDelta2 = _mm_set1_ps(edges.oneOverWDelta2);
+
+    float groupEdges[3] = { rowEdges[0], rowEdges[1], rowEdges[2] };
+    float groupStep[3];
+    for (int i = 0; i < 3; i++)
+    {
+        groupStep[i] = edges.a[i] * static_cast<float>(RASTER_GROUP_SIZE);
+    }
+
+    auto evaluateHalf = [&](uint32_t i, __m128 offset) -> uint64_t {
+        const __m128 e0 = _mm_add_ps(_mm_set1_ps(groupEdges[0]), _mm_mul_ps(a0, offset));
+        const __m128 e1 = _mm_add_ps(_mm_set1_ps(groupEdges[1]), _mm_mul_ps(a1, offset));
+        const __m128 e2 = _mm_add_ps(_mm_set1_ps(groupEdges[2]), _mm_mul_ps(a2, offset));
+
+        const __m128 w1 = _mm_mul_ps(e2, invArea);
+        const __m128 w2 = _mm_mul_ps(e0, invArea);
+        const __m128 oneOverW = _mm_add_ps(
+            _mm_add_ps(oneOverW0, _mm_mul_ps(w1, oneOverWDelta1)),
+            _mm_mul_ps(w2, oneOverWDelta2)
+        );
+
+        _mm_store_ps(&rSpan.depth[i], _mm_div_ps(one, oneOverW));
+
+        const __m128 inside = _mm_and_ps(
+            _mm_and_ps(_mm_cmpgt_ps(e0, zero), _mm_cmpgt_ps(e1, zero)),
+            _mm_cmpgt_ps(e2, zero)
+        );
+        return static_cast<uint64_t>(_mm_movemask_ps(inside)) << i;
+    };
+
+    uint64_t coverage = 0;
+    for (uint32_t groupStart = 0; groupStart < RASTER_SPAN_MAX; groupStart += RASTER_GROUP_SIZE)
+    {
+        if (((activeMask >> groupStart) & 0xff) == 0)
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                groupEdges[i] += groupStep[i];
+            }
+            continue;
+        }
+
+        coverage |= evaluateHalf(groupStart, offsetLow);
+        coverage |= evaluateHalf(groupStart + 4, offsetHigh);
+
+        for (int i = 0; i < 3; i++)
+        {
+            groupEdges[i] += groupStep[i];
+        }
+    }
+
+    rSpan.coverage = coverage & activeMask;
+}
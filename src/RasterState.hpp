@@ -0,0 +1,42 @@
+
+#ifndef RASTER_STATE_HPP
+#define RASTER_STATE_HPP
+
+// Which way round the vertices of a triangle facing the camera go once it
+// is on screen, with y pointing down.
+enum class FrontFace
+{
+    Clockwise,
+    CounterClockwise,
+};
+
+
+// Which triangles are thrown out for the way they face.
+enum class CullMode
+{
+    None,
+    Back,
+    Front,
+};
+
+
+// Where the color of a pixel comes from, before any texture. DebugColor gives
+// each triangle one of a few flat colors, in the order they were drawn.
+enum class ColorSource
+{
+    DebugColor,
+    VertexColor,
+};
+
+
+// How a texture's color is combined with the ColorSource's.
+enum class BlendMode
+{
+    // Half of each.
+    Mix,
+    Modulate,
+    Replace,
+};
+
+
+#endif
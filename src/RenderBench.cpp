@@ -0,0 +1,750 @@
+
+// Renders a suite of standard scenes without a window, times them, and
+// checks what they look like against golden images. Doesn't need SDL.
+//
+//   renderbench [--frames N] [--threads N] [--size WIDTHxHEIGHT] [--scene NAME]
+//               [--json PATH] [--golden-dir DIR] [--update-golden]
+//               [--tolerance N] [--max-bad-pixels FRACTION]
+//
+// Exits with 1 if any scene doesn't match its golden image.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Scene.hpp"
+#include "SoftwareRenderer.hpp"
+#include "VertexBuffer.hpp"
+
+
+#ifndef RENDERBENCH_GOLDEN_DIR
+#define RENDERBENCH_GOLDEN_DIR "golden"
+#endif
+
+// Golden images are small, and rendered separately from the timed frames,
+// so that they don't depend on the size being benchmarked.
+const uint32_t GOLDEN_WIDTH = 256;
+const uint32_t GOLDEN_HEIGHT = 192;
+const uint32_t GOLDEN_FRAME = 10;
+
+// Scenes are animated by frame number, not by time, so that every run
+// draws exactly the same frames.
+const float FRAME_TIME = 1.0f / 60.0f;
+
+
+struct BenchOptions
+{
+    uint32_t frameCount = 30;
+    uint32_t threadCount = 0;
+    uint32_t width = 640;
+    uint32_t height = 480;
+    std::string sceneFilter {};
+    std::string jsonPath = "renderbench.json";
+    std::string goldenDir = RENDERBENCH_GOLDEN_DIR;
+    bool updateGolden = false;
+
+    // A pixel is bad if any channel is further than this from the
+    // golden image, and a scene fails if too many pixels are bad.
+    int tolerance = 2;
+    double maxBadPixels = 0.001;
+};
+
+
+// A scene sets up its textures and geometry once, in the renderer it's
+// given, and then draws any frame of itself.
+struct BenchScene
+{
+    uint64_t trianglesPerFrame;
+    std::function<void(SoftwareRenderer& rRenderer, uint32_t frame)> draw;
+};
+
+using SceneFactory = BenchScene (*)(SoftwareRenderer& rRenderer, uint32_t width, uint32_t height);
+
+
+static uint32_t MakeCheckerboardTexture(SoftwareRenderer& rRenderer, uint32_t size, uint32_t squareSize)
+{
+    std::vector<uint8_t> texels;
+    for (uint32_t y = 0; y < size; y++)
+    {
+        for (uint32_t x = 0; x < size; x++)
+        {
+            const uint8_t value = (x / squareSize) % 2 == (y / squareSize) % 2 ? 0x00 : 0xff;
+            texels.insert(texels.end(), { value, value, value, 0xff });
+        }
+    }
+    const uint32_t texture = rRenderer.CreateTexture();
+    rRenderer.UpdateTexture(texture, size, size, texels.data(), TextureFormat::RGBA8, TextureLayout::Tiled, true);
+    return texture;
+}
+
+
+// Smooth noise, so that every mip level has something in it.
+static uint32_t MakeNoiseTexture(SoftwareRenderer& rRenderer, uint32_t size, uint32_t seed)
+{
+    std::mt19937 random { seed };
+    std::vector<uint8_t> texels(size * size * 4);
+    for (uint32_t y = 0; y < size; y++)
+    {
+        for (uint32_t x = 0; x < size; x++)
+        {
+            const float u = static_cast<float>(x) / size * 6.2831853f;
+            const float v = static_cast<float>(y) / size * 6.2831853f;
+            const float wave = 0.5f + 0.25f * std::sin(u * 3.0f) * std::cos(v * 5.0f) + 0.25f * std::sin((u + v) * 17.0f);
+            const uint8_t grain = random() & 0x1f;
+            uint8_t* pTexel = &texels[(y * size + x) * 4];
+            pTexel[0] = static_cast<uint8_t>(wave * 0xc0) + grain;
+            pTexel[1] = static_cast<uint8_t>(wave * 0xa0) + grain;
+            pTexel[2] = static_cast<uint8_t>(wave * 0x80) + grain;
+            pTexel[3] = 0xff;
+        }
+    }
+    const uint32_t texture = rRenderer.CreateTexture();
+    rRenderer.UpdateTexture(texture, size, size, texels.data(), TextureFormat::RGBA8, TextureLayout::Tiled, true);
+    return texture;
+}
+
+
+// A cube from -1 to 1, with its own texture coordinates on each side.
+static void MakeCube(std::vector<Vertex>& rVertices, std::vector<uint16_t>& rIndices)
+{
+    const glm::vec3 colors[] = {
+        { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 1.0f },
+        { 0.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 0.0f },
+    };
+    const glm::mat4 sides[] = {
+        glm::mat4 { 1.0f },
+        glm::rotate(glm::mat4 { 1.0f }, glm::radians(90.0f), { 0.0f, 0.0f, 1.0f }),
+        glm::rotate(glm::mat4 { 1.0f }, glm::radians(180.0f), { 0.0f, 0.0f, 1.0f }),
+        glm::rotate(glm::mat4 { 1.0f }, glm::radians(270.0f), { 0.0f, 0.0f, 1.0f }),
+        glm::rotate(glm::mat4 { 1.0f }, glm::radians(90.0f), { -1.0f, 0.0f, 0.0f }),
+        glm::rotate(glm::mat4 { 1.0f }, glm::radians(270.0f), { -1.0f, 0.0f, 0.0f }),
+    };
+    for (uint32_t side = 0; side < 6; side++)
+    {
+        const uint16_t base = rVertices.size();
+        rVertices.push_back({ sides[side] * glm::vec4 { -1.0f, 1.0f, -1.0f, 1.0f }, colors[side], { 0.0f, 0.0f } });
+        rVertices.push_back({ sides[side] * glm::vec4 { 1.0f, 1.0f, -1.0f, 1.0f }, colors[side], { 1.0f, 0.0f } });
+        rVertices.push_back({ sides[side] * glm::vec4 { -1.0f, 1.0f, 1.0f, 1.0f }, colors[side], { 0.0f, 1.0f } });
+        rVertices.push_back({ sides[side] * glm::vec4 { 1.0f, 1.0f, 1.0f, 1.0f }, colors[side], { 1.0f, 1.0f } });
+        rIndices.insert(rIndices.end(), { base, static_cast<uint16_t>(base + 1), static_cast<uint16_t>(base + 2) });
+        rIndices.insert(rIndices.end(), { static_cast<uint16_t>(base + 1), static_cast<uint16_t>(base + 3), static_cast<uint16_t>(base + 2) });
+    }
+}
+
+
+static glm::mat4 MakeProjection(uint32_t width, uint32_t height, float nearPlane, float farPlane)
+{
+    return glm::perspective(glm::radians(45.0f), static_cast<float>(width) / static_cast<float>(height), nearPlane, farPlane);
+}
+
+
+// The simulator's scene: one cube spinning in place and another orbiting it.
+static BenchScene MakeCubesScene(SoftwareRenderer& rRenderer, uint32_t width, uint32_t height)
+{
+    std::vector<Vertex> vertices;
+    std::vector<uint16_t> indices;
+    MakeCube(vertices, indices);
+    auto pVertices = std::make_shared<VertexBuffer>(vertices);
+    auto pIndices = std::make_shared<std::vector<uint16_t>>(indices);
+
+    const uint32_t checkerboard = MakeCheckerboardTexture(rRenderer, 128, 16);
+    const uint32_t noise = MakeNoiseTexture(rRenderer, 512, 1);
+    const uint32_t bilinear = rRenderer.CreateSampler({ TextureWrap::Repeat, TextureWrap::Repeat, TextureFilter::Bilinear, MipFilter::Linear });
+    rRenderer.SetProjectionMatrix(MakeProjection(width, height, 5.0f, 100.0f));
+
+    auto draw = [=](SoftwareRenderer& rContext, uint32_t frame) {
+        const float t = static_cast<float>(frame) * FRAME_TIME;
+        const glm::mat4 view = glm::translate(glm::mat4 { 1.0f }, { 0.0f, 0.0f, -10.0f });
+
+        glm::mat4 model1 { 1.0f };
+        model1 = glm::scale(model1, glm::vec3 { 1.5f });
+        model1 = glm::rotate(model1, glm::radians(45.0f * t), { 0.0f, 1.0f, 0.0f });
+
+        glm::mat4 model2 { 1.0f };
+        model2 = glm::rotate(model2, glm::radians(90.0f * t), { 0.0f, 1.0f, 0.0f });
+        model2 = glm::translate(model2, { 4.0f, 0.0f, 0.0f });
+
+        rContext.Clear(0x64, 0x95, 0xed);
+        rContext.UseTexture(checkerboard);
+        rContext.UseSampler(0);
+        rContext.SetViewModelMatrix(view * model1);
+        rContext.DrawIndexedTriangles(*pVertices, *pIndices);
+
+        rContext.UseTexture(noise);
+        rContext.UseSampler(bilinear);
+        rContext.SetViewModelMatrix(view * model2);
+        rContext.DrawIndexedTriangles(*pVertices, *pIndices);
+    };
+    return { 2 * indices.size() / 3, draw };
+}
+
+
+// A finely tessellated, spinning sphere: lots of triangles, each only a few pixels.
+static BenchScene MakeDenseMeshScene(SoftwareRenderer& rRenderer, uint32_t width, uint32_t height)
+{
+    const uint32_t rings = 256;
+    const uint32_t segments = 512;
+
+    std::vector<Vertex> vertices;
+    for (uint32_t ring = 0; ring <= rings; ring++)
+    {
+        const float theta = static_cast<float>(ring) / rings * 3.1415927f;
+        for (uint32_t segment = 0; segment <= segments; segment++)
+        {
+            const float phi = static_cast<float>(segment) / segments * 6.2831853f;
+            const glm::vec3 normal { std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) };
+            vertices.push_back({ glm::vec4 { normal, 1.0f }, normal * 0.5f + 0.5f, { static_cast<float>(segment) / segments * 4.0f, static_cast<float>(ring) / rings * 2.0f } });
+        }
+    }
+    std::vector<uint32_t> indices;
+    for (uint32_t ring = 0; ring < rings; ring++)
+    {
+        for (uint32_t segment = 0; segment < segments; segment++)
+        {
+            const uint32_t i = ring * (segments + 1) + segment;
+            indices.insert(indices.end(), { i, i + segments + 1, i + 1 });
+            indices.insert(indices.end(), { i + 1, i + segments + 1, i + segments + 2 });
+        }
+    }
+    auto pVertices = std::make_shared<VertexBuffer>(vertices);
+    auto pIndices = std::make_shared<std::vector<uint32_t>>(indices);
+
+    const uint32_t noise = MakeNoiseTexture(rRenderer, 256, 2);
+    rRenderer.SetProjectionMatrix(MakeProjection(width, height, 1.0f, 20.0f));
+
+    auto draw = [=](SoftwareRenderer& rContext, uint32_t frame) {
+        const float t = static_cast<float>(frame) * FRAME_TIME;
+        glm::mat4 model = glm::translate(glm::mat4 { 1.0f }, { 0.0f, 0.0f, -3.2f });
+        model = glm::rotate(model, glm::radians(30.0f * t), { 0.0f, 1.0f, 0.0f });
+        model = glm::rotate(model, glm::radians(20.0f), { 1.0f, 0.0f, 0.0f });
+
+        rContext.Clear(0, 0, 0);
+        rContext.UseTexture(noise);
+        rContext.SetViewModelMatrix(model);
+        rContext.DrawIndexedTriangles(*pVertices, *pIndices);
+    };
+    return { indices.size() / 3, draw };
+}
+
+
+// Eight textured layers which each cover the screen, drawn back to front.
+static BenchScene MakeOverdrawScene(SoftwareRenderer& rRenderer, uint32_t width, uint32_t height)
+{
+    const uint32_t layerCount = 8;
+    const float aspect = static_cast<float>(width) / static_cast<float>(height);
+    const std::vector<Vertex> quad = {
+        { glm::vec4 { -aspect, 1.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 4.0f } },
+        { glm::vec4 { aspect, 1.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f }, { 4.0f, 4.0f } },
+        { glm::vec4 { -aspect, -1.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } },
+        { glm::vec4 { aspect, 1.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f }, { 4.0f, 4.0f } },
+        { glm::vec4 { aspect, -1.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f }, { 4.0f, 0.0f } },
+        { glm::vec4 { -aspect, -1.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } },
+    };
+    auto pQuad = std::make_shared<VertexBuffer>(quad);
+
+    const uint32_t noise = MakeNoiseTexture(rRenderer, 256, 3);
+    const uint32_t bilinear = rRenderer.CreateSampler({ TextureWrap::Repeat, TextureWrap::Repeat, TextureFilter::Bilinear, MipFilter::Linear });
+    const float fieldOfView = glm::radians(60.0f);
+    rRenderer.SetProjectionMatrix(glm::perspective(fieldOfView, aspect, 0.5f, 50.0f));
+
+    auto draw = [=](SoftwareRenderer& rContext, uint32_t frame) {
+        const float t = static_cast<float>(frame) * FRAME_TIME;
+        rContext.Clear(0, 0, 0);
+        rContext.UseTexture(noise);
+        rContext.UseSampler(bilinear);
+        for (uint32_t i = 0; i < layerCount; i++)
+        {
+            const uint32_t layer = layerCount - 1 - i;
+            const float distance = 2.0f + static_cast<float>(layer);
+            const float scale = distance * std::tan(fieldOfView / 2.0f);
+            glm::mat4 model = glm::translate(glm::mat4 { 1.0f }, { 0.0f, 0.0f, -distance });
+            model = glm::rotate(model, 0.1f * t * static_cast<float>(layer + 1), { 0.0f, 0.0f, 1.0f });
+            model = glm::scale(model, { scale * 1.5f, scale * 1.5f, 1.0f });
+            rContext.SetViewModelMatrix(model);
+            rContext.DrawTriangleList(*pQuad);
+        }
+    };
+    return { 2 * layerCount, draw };
+}
+
+
+// A floor with a 4096x4096 texture, seen at a grazing angle, so that every
+// level of the mip chain gets sampled.
+static BenchScene MakeLargeTextureScene(SoftwareRenderer& rRenderer, uint32_t width, uint32_t height)
+{
+    const std::vector<Vertex> floor = {
+        { glm::vec4 { -1.0f, 0.0f, -1.0f, 1.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } },
+        { glm::vec4 { 1.0f, 0.0f, -1.0f, 1.0f }, { 1.0f, 1.0f, 1.0f }, { 1.0f, 0.0f } },
+        { glm::vec4 { -1.0f, 0.0f, 1.0f, 1.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 1.0f } },
+        { glm::vec4 { 1.0f, 0.0f, -1.0f, 1.0f }, { 1.0f, 1.0f, 1.0f }, { 1.0f, 0.0f } },
+        { glm::vec4 { 1.0f, 0.0f, 1.0f, 1.0f }, { 1.0f, 1.0f, 1.0f }, { 1.0f, 1.0f } },
+        { glm::vec4 { -1.0f, 0.0f, 1.0f, 1.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 1.0f } },
+    };
+    auto pFloor = std::make_shared<VertexBuffer>(floor);
+
+    const uint32_t noise = MakeNoiseTexture(rRenderer, 4096, 4);
+    const uint32_t trilinear = rRenderer.CreateSampler({ TextureWrap::Repeat, TextureWrap::Repeat, TextureFilter::Bilinear, MipFilter::Linear });
+    rRenderer.SetProjectionMatrix(MakeProjection(width, height, 0.1f, 100.0f));
+
+    auto draw = [=](SoftwareRenderer& rContext, uint32_t frame) {
+        const float t = static_cast<float>(frame) * FRAME_TIME;
+        const glm::mat4 view = glm::lookAt(glm::vec3 { 0.0f, 0.6f, 0.0f }, glm::vec3 { 0.0f, 0.2f, -4.0f }, glm::vec3 { 0.0f, 1.0f, 0.0f });
+        glm::mat4 model = glm::rotate(glm::mat4 { 1.0f }, glm::radians(10.0f * t), { 0.0f, 1.0f, 0.0f });
+        model = glm::scale(model, { 40.0f, 1.0f, 40.0f });
+
+        rContext.Clear(0x64, 0x95, 0xed);
+        rContext.UseTexture(noise);
+        rContext.UseSampler(trilinear);
+        rContext.SetViewModelMatrix(view * model);
+        rContext.DrawTriangleList(*pFloor);
+    };
+    return { 2, draw };
+}
+
+
+// Lots of separate triangles, a pixel or two across, scattered over the screen.
+static BenchScene MakeSmallTrianglesScene(SoftwareRenderer& rRenderer, uint32_t width, uint32_t height)
+{
+    const uint32_t triangleCount = 100000;
+    const float pixelSize = 2.0f / static_cast<float>(height);
+
+    std::mt19937 random { 5 };
+    std::uniform_real_distribution<float> across { -1.0f, 1.0f };
+    std::uniform_real_distribution<float> offset { 0.5f, 3.0f };
+    std::vector<Vertex> vertices;
+    for (uint32_t i = 0; i < triangleCount; i++)
+    {
+        const glm::vec3 color { across(random) * 0.5f + 0.5f, across(random) * 0.5f + 0.5f, 1.0f };
+        const float x = across(random);
+        const float y = across(random);
+        const float z = across(random) * 0.5f;
+        vertices.push_back({ glm::vec4 { x, y, z, 1.0f }, color, { 0.0f, 0.0f } });
+        vertices.push_back({ glm::vec4 { x + offset(random) * pixelSize, y, z, 1.0f }, color, { 1.0f, 0.0f } });
+        vertices.push_back({ glm::vec4 { x, y - offset(random) * pixelSize, z, 1.0f }, color, { 0.0f, 1.0f } });
+    }
+    auto pVertices = std::make_shared<VertexBuffer>(vertices);
+
+    // Straight onto the screen, and squashed to fit it.
+    rRenderer.SetProjectionMatrix(glm::scale(glm::mat4 { 1.0f }, { static_cast<float>(height) / static_cast<float>(width), 1.0f, 1.0f }));
+
+    auto draw = [=](SoftwareRenderer& rContext, uint32_t frame) {
+        const float t = static_cast<float>(frame) * FRAME_TIME;
+        rContext.Clear(0, 0, 0);
+        rContext.UseTexture(0);
+        rContext.SetViewModelMatrix(glm::rotate(glm::mat4 { 1.0f }, 0.2f * t, { 0.0f, 0.0f, 1.0f }));
+        rContext.DrawTriangleList(*pVertices);
+    };
+    return { triangleCount, draw };
+}
+
+
+// A city of 40,000 boxes, flown over low down, so that only a few percent of
+// them are in view. The scene's hierarchy picks out the ones to draw.
+static BenchScene MakeLargeWorldScene(SoftwareRenderer& rRenderer, uint32_t width, uint32_t height)
+{
+    const uint32_t gridSize = 200;
+    const float spacing = 3.0f;
+
+    std::vector<Vertex> vertices;
+    std::vector<uint16_t> indices;
+    MakeCube(vertices, indices);
+    auto pVertices = std::make_shared<VertexBuffer>(vertices);
+    auto pIndices = std::make_shared<std::vector<uint16_t>>(indices);
+
+    std::mt19937 random { 6 };
+    std::uniform_real_distribution<float> storeys { 0.5f, 4.0f };
+    auto pScene = std::make_shared<Scene>();
+    const uint32_t textures[] = { MakeCheckerboardTexture(rRenderer, 64, 8), MakeNoiseTexture(rRenderer, 128, 7) };
+    for (uint32_t z = 0; z < gridSize; z++)
+    {
+        for (uint32_t x = 0; x < gridSize; x++)
+        {
+            const float boxHeight = storeys(random);
+            const glm::vec3 position { (x - gridSize / 2.0f) * spacing, boxHeight, (z - gridSize / 2.0f) * spacing };
+            const glm::mat4 model = glm::scale(glm::translate(glm::mat4 { 1.0f }, position), { 1.0f, boxHeight, 1.0f });
+            pScene->AddObject(*pVertices, *pIndices, model, textures[(x + z) % 2]);
+        }
+    }
+    auto pCommands = std::make_shared<CommandBuffer>();
+    const glm::mat4 projection = MakeProjection(width, height, 0.5f, 120.0f);
+
+    // The scene only refers to the cube, so the cube goes along with it.
+    auto draw = [pScene, pCommands, pVertices, pIndices, projection](SoftwareRenderer& rContext, uint32_t frame) {
+        const float t = static_cast<float>(frame) * FRAME_TIME;
+        const glm::vec3 eye { 1.5f, 12.0f, 150.0f - 20.0f * t };
+        const glm::vec3 direction { std::sin(0.3f * t), -0.25f, -std::cos(0.3f * t) };
+        const glm::mat4 view = glm::lookAt(eye, eye + direction, glm::vec3 { 0.0f, 1.0f, 0.0f });
+
+        rContext.Clear(0x64, 0x95, 0xed);
+        pCommands->Reset();
+        pScene->Cull(projection, view, *pCommands);
+        rContext.Submit(*pCommands);
+    };
+
+    // Triangles in the whole world, which is what culling saves going through.
+    return { static_cast<uint64_t>(gridSize) * gridSize * indices.size() / 3, draw };
+}
+
+
+static const std::pair<const char*, SceneFactory> SCENES[] = {
+    { "cubes", MakeCubesScene },
+    { "dense_mesh", MakeDenseMeshScene },
+    { "overdraw", MakeOverdrawScene },
+    { "large_texture", MakeLargeTextureScene },
+    { "small_triangles", MakeSmallTrianglesScene },
+    { "large_world", MakeLargeWorldScene },
+};
+
+
+// Binary PPM, which is simple enough to read and write here. The
+// framebuffer is BGRA, and the file is RGB.
+static bool WritePPM(const std::string& path, const uint8_t* pPixels, uint32_t width, uint32_t height)
+{
+    FILE* pFile = fopen(path.c_str(), "wb");
+    if (pFile == nullptr)
+    {
+        return false;
+    }
+    fprintf(pFile, "P6\n%u %u\n255\n", width, height);
+    std::vector<uint8_t> row(width * 3);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            const uint8_t* pPixel = &pPixels[(y * width + x) * 4];
+            row[x * 3 + 0] = pPixel[2];
+            row[x * 3 + 1] = pPixel[1];
+            row[x * 3 + 2] = pPixel[0];
+        }
+        fwrite(row.data(), 1, row.size(), pFile);
+    }
+    return fclose(pFile) == 0;
+}
+
+
+// Returns RGB pixels, or nothing if the file is missing or isn't the right size.
+static std::vector<uint8_t> ReadPPM(const std::string& path, uint32_t width, uint32_t height)
+{
+    FILE* pFile = fopen(path.c_str(), "rb");
+    if (pFile == nullptr)
+    {
+        return {};
+    }
+    unsigned fileWidth = 0;
+    unsigned fileHeight = 0;
+    unsigned maxValue = 0;
+    std::vector<uint8_t> pixels(width * height * 3);
+    const bool valid =
+        fscanf(pFile, "P6 %u %u %u", &fileWidth, &fileHeight, &maxValue) == 3 &&
+        fgetc(pFile) != EOF &&
+        fileWidth == width && fileHeight == height && maxValue == 255 &&
+        fread(pixels.data(), 1, pixels.size(), pFile) == pixels.size();
+    fclose(pFile);
+    return valid ? pixels : std::vector<uint8_t> {};
+}
+
+
+struct GoldenResult
+{
+    // "match", "mismatch", "missing", "updated" or "unwritable".
+    const char* status;
+    uint64_t badPixels;
+    int maxDifference;
+};
+
+
+static GoldenResult CheckGolden(const BenchOptions& options, const char* sceneName, const uint8_t* pPixels)
+{
+    const std::string path = options.goldenDir + "/" + sceneName + ".ppm";
+    if (options.updateGolden)
+    {
+        const bool written = WritePPM(path, pPixels, GOLDEN_WIDTH, GOLDEN_HEIGHT);
+        return { written ? "updated" : "unwritable", 0, 0 };
+    }
+
+    const std::vector<uint8_t> golden = ReadPPM(path, GOLDEN_WIDTH, GOLDEN_HEIGHT);
+    if (golden.empty())
+    {
+        return { "missing", 0, 0 };
+    }
+
+    GoldenResult result { "match", 0, 0 };
+    for (uint32_t i = 0; i < GOLDEN_WIDTH * GOLDEN_HEIGHT; i++)
+    {
+        // BGRA against RGB.
+        int difference = 0;
+        for (uint32_t channel = 0; channel < 3; channel++)
+        {
+            difference = std::max(difference, std::abs(pPixels[i * 4 + 2 - channel] - golden[i * 3 + channel]));
+        }
+        result.maxDifference = std::max(result.maxDifference, difference);
+        result.badPixels += difference > options.tolerance ? 1 : 0;
+    }
+    if (result.badPixels > options.maxBadPixels * GOLDEN_WIDTH * GOLDEN_HEIGHT)
+    {
+        // Left where it can be looked at next to the golden image.
+        result.status = "mismatch";
+        WritePPM(std::string { sceneName } + ".actual.ppm", pPixels, GOLDEN_WIDTH, GOLDEN_HEIGHT);
+    }
+    return result;
+}
+
+
+struct SceneResult
+{
+    const char* name;
+    uint32_t frameCount;
+    uint64_t trianglesPerFrame;
+    uint64_t fragments;
+    double totalMilliseconds;
+    double minMilliseconds;
+    double p50Milliseconds;
+    double p90Milliseconds;
+    double p99Milliseconds;
+    double maxMilliseconds;
+
+    // Summed over the timed frames.
+    PipelineStats pipelineStats;
+
+    GoldenResult golden;
+};
+
+
+static double Percentile(const std::vector<double>& sorted, double fraction)
+{
+    const size_t rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+    return sorted[std::min(sorted.size() - 1, rank == 0 ? 0 : rank - 1)];
+}
+
+
+static SceneResult RunScene(const BenchOptions& options, const char* name, SceneFactory factory)
+{
+    RendererOptions rendererOptions;
+    rendererOptions.threadCount = options.threadCount;
+
+    SceneResult result {};
+    result.name = name;
+    result.frameCount = options.frameCount;
+
+    {
+        SoftwareRenderer renderer { options.width, options.height, rendererOptions };
+        const BenchScene scene = factory(renderer, options.width, options.height);
+        result.trianglesPerFrame = scene.trianglesPerFrame;
+
+        // One frame first, so that caches and scratch arenas are warmed up.
+        scene.draw(renderer, 0);
+        renderer.GetFramebufferPointer();
+
+        std::vector<double> frameMilliseconds;
+        for (uint32_t frame = 0; frame < options.frameCount; frame++)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            scene.draw(renderer, frame);
+            renderer.GetFramebufferPointer();
+            frameMilliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+            const RasterStats stats = renderer.GetRasterStats();
+            result.fragments += stats.shadedPixels + stats.depthRejectedPixels;
+            result.pipelineStats += renderer.GetPipelineStats();
+        }
+
+        std::sort(frameMilliseconds.begin(), frameMilliseconds.end());
+        for (const double milliseconds : frameMilliseconds)
+        {
+            result.totalMilliseconds += milliseconds;
+        }
+        result.minMilliseconds = frameMilliseconds.front();
+        result.p50Milliseconds = Percentile(frameMilliseconds, 0.50);
+        result.p90Milliseconds = Percentile(frameMilliseconds, 0.90);
+        result.p99Milliseconds = Percentile(frameMilliseconds, 0.99);
+        result.maxMilliseconds = frameMilliseconds.back();
+    }
+
+    // The output doesn't depend on the thread count, so neither does this.
+    SoftwareRenderer renderer { GOLDEN_WIDTH, GOLDEN_HEIGHT, rendererOptions };
+    const BenchScene scene = factory(renderer, GOLDEN_WIDTH, GOLDEN_HEIGHT);
+    scene.draw(renderer, GOLDEN_FRAME);
+    result.golden = CheckGolden(options, name, renderer.GetFramebufferPointer());
+
+    return result;
+}
+
+
+static bool WriteJSON(const BenchOptions& options, const std::vector<SceneResult>& results)
+{
+    FILE* pFile = fopen(options.jsonPath.c_str(), "w");
+    if (pFile == nullptr)
+    {
+        return false;
+    }
+
+    fprintf(pFile, "{\n");
+    fprintf(pFile, "  \"width\": %u,\n", options.width);
+    fprintf(pFile, "  \"height\": %u,\n", options.height);
+    fprintf(pFile, "  \"frames\": %u,\n", options.frameCount);
+    fprintf(pFile, "  \"threads\": %u,\n", options.threadCount);
+    fprintf(pFile, "  \"scenes\": [\n");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const SceneResult& r = results[i];
+        const double seconds = r.totalMilliseconds / 1000.0;
+        fprintf(pFile, "    {\n");
+        fprintf(pFile, "      \"name\": \"%s\",\n", r.name);
+        fprintf(pFile, "      \"frame_ms\": { \"min\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f, \"mean\": %.3f },\n",
+            r.minMilliseconds, r.p50Milliseconds, r.p90Milliseconds, r.p99Milliseconds, r.maxMilliseconds, r.totalMilliseconds / r.frameCount);
+        fprintf(pFile, "      \"triangles_per_frame\": %llu,\n", static_cast<unsigned long long>(r.trianglesPerFrame));
+        fprintf(pFile, "      \"triangles_per_second\": %.0f,\n", r.trianglesPerFrame * r.frameCount / seconds);
+        fprintf(pFile, "      \"fragments_per_second\": %.0f,\n", r.fragments / seconds);
+        if (PIPELINE_STATS_ENABLED)
+        {
+            // Per frame.
+            const PipelineStats& rStats = r.pipelineStats;
+            auto perFrame = [&r](uint64_t value) { return static_cast<double>(value) / r.frameCount; };
+            fprintf(pFile, "      \"pipeline\": {\n");
+            fprintf(pFile, "        \"vertices_transformed\": %.1f,\n", perFrame(rStats.verticesTransformed));
+            fprintf(pFile, "        \"triangles\": { \"submitted\": %.1f, \"frustum_culled\": %.1f, \"clipped\": %.1f, \"backface_culled\": %.1f, \"zero_area\": %.1f, \"too_small\": %.1f, \"rasterized\": %.1f },\n",
+                perFrame(rStats.trianglesSubmitted), perFrame(rStats.trianglesFrustumCulled), perFrame(rStats.trianglesClipped),
+                perFrame(rStats.trianglesBackfaceCulled), perFrame(rStats.trianglesZeroArea), perFrame(rStats.trianglesTooSmall),
+                perFrame(rStats.trianglesRasterized));
+            fprintf(pFile, "        \"fragments\": { \"depth_tested\": %.1f, \"passed_depth\": %.1f, \"alpha_tested\": %.1f, \"passed_alpha\": %.1f, \"pixels_written\": %.1f },\n",
+                perFrame(rStats.fragmentsDepthTested), perFrame(rStats.fragmentsPassedDepth), perFrame(rStats.fragmentsAlphaTested),
+                perFrame(rStats.fragmentsPassedAlpha), perFrame(rStats.pixelsWritten));
+            fprintf(pFile, "        \"ms\": { \"clear\": %.3f, \"geometry\": %.3f, \"raster\": %.3f, \"resolve\": %.3f, \"flush\": %.3f }\n",
+                perFrame(rStats.clearNanoseconds) / 1e6, perFrame(rStats.geometryNanoseconds) / 1e6, perFrame(rStats.rasterNanoseconds) / 1e6,
+                perFrame(rStats.resolveNanoseconds) / 1e6, perFrame(rStats.flushNanoseconds) / 1e6);
+            fprintf(pFile, "      },\n");
+        }
+        fprintf(pFile, "      \"golden\": { \"status\": \"%s\", \"bad_pixels\": %llu, \"max_difference\": %d }\n",
+            r.golden.status, static_cast<unsigned long long>(r.golden.badPixels), r.golden.maxDifference);
+        fprintf(pFile, "    }%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(pFile, "  ]\n");
+    fprintf(pFile, "}\n");
+    return fclose(pFile) == 0;
+}
+
+
+static bool ParseArguments(int argc, char** argv, BenchOptions& rOptions)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char* pArgument = argv[i];
+        const char* pValue = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto takeValue = [&i, pValue]() {
+            i++;
+            return pValue;
+        };
+
+        if (strcmp(pArgument, "--update-golden") == 0)
+        {
+            rOptions.updateGolden = true;
+        }
+        else if (pValue == nullptr)
+        {
+            return false;
+        }
+        else if (strcmp(pArgument, "--frames") == 0)
+        {
+            rOptions.frameCount = std::max(1, atoi(takeValue()));
+        }
+        else if (strcmp(pArgument, "--threads") == 0)
+        {
+            rOptions.threadCount = std::max(0, atoi(takeValue()));
+        }
+        else if (strcmp(pArgument, "--size") == 0)
+        {
+            if (sscanf(takeValue(), "%ux%u", &rOptions.width, &rOptions.height) != 2 || rOptions.width == 0 || rOptions.height == 0)
+            {
+                return false;
+            }
+        }
+        else if (strcmp(pArgument, "--scene") == 0)
+        {
+            rOptions.sceneFilter = takeValue();
+        }
+        else if (strcmp(pArgument, "--json") == 0)
+        {
+            rOptions.jsonPath = takeValue();
+        }
+        else if (strcmp(pArgument, "--golden-dir") == 0)
+        {
+            rOptions.goldenDir = takeValue();
+        }
+        else if (strcmp(pArgument, "--tolerance") == 0)
+        {
+            rOptions.tolerance = atoi(takeValue());
+        }
+        else if (strcmp(pArgument, "--max-bad-pixels") == 0)
+        {
+            rOptions.maxBadPixels = atof(takeValue());
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    if ( ! ParseArguments(argc, argv, options))
+    {
+        fprintf(stderr,
+            "usage: renderbench [--frames N] [--threads N] [--size WIDTHxHEIGHT] [--scene NAME]\n"
+            "                   [--json PATH] [--golden-dir DIR] [--update-golden]\n"
+            "                   [--tolerance N] [--max-bad-pixels FRACTION]\n");
+        return 2;
+    }
+
+    std::vector<SceneResult> results;
+    for (const auto& rScene : SCENES)
+    {
+        if (options.sceneFilter.empty() || options.sceneFilter == rScene.first)
+        {
+            results.push_back(RunScene(options, rScene.first, rScene.second));
+        }
+    }
+    if (results.empty())
+    {
+        fprintf(stderr, "No scene called %s\n", options.sceneFilter.c_str());
+        return 2;
+    }
+
+    bool passed = true;
+    printf("%-16s %9s %9s %9s %12s %12s  %s\n", "scene", "p50 ms", "p90 ms", "p99 ms", "Mtris/s", "Mfrags/s", "golden");
+    for (const SceneResult& r : results)
+    {
+        const double seconds = r.totalMilliseconds / 1000.0;
+        printf("%-16s %9.2f %9.2f %9.2f %12.2f %12.2f  %s",
+            r.name, r.p50Milliseconds, r.p90Milliseconds, r.p99Milliseconds,
+            r.trianglesPerFrame * r.frameCount / seconds / 1e6, r.fragments / seconds / 1e6, r.golden.status);
+        if (strcmp(r.golden.status, "mismatch") == 0)
+        {
+            printf(" (%llu pixels off, by up to %d)", static_cast<unsigned long long>(r.golden.badPixels), r.golden.maxDifference);
+        }
+        printf("\n");
+        passed = passed && (strcmp(r.golden.status, "match") == 0 || strcmp(r.golden.status, "updated") == 0);
+    }
+
+    if ( ! WriteJSON(options, results))
+    {
+        fprintf(stderr, "Failed to write %s\n", options.jsonPath.c_str());
+        return 2;
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,236 @@
+
+#include <algorithm>
+#include <cassert>
+
+#include "Scene.hpp"
+
+
+Scene::Scene() :
+    m_Objects {},
+    m_ObjectOrder {},
+    m_Nodes {},
+    m_NeedsRebuild { false },
+    m_NeedsRefit { false },
+    m_CullStack {},
+    m_CullStats {}
+{
+}
+
+
+uint32_t Scene::AddObject(const VertexBuffer& vertices, const glm::mat4& modelMatrix, uint32_t textureID, uint32_t samplerID)
+{
+    return Add(DrawType::TriangleList, vertices, nullptr, nullptr, modelMatrix, textureID, samplerID);
+}
+
+uint32_t Scene::AddObject(const VertexBuffer& vertices, const std::vector<uint16_t>& indices, const glm::mat4& modelMatrix, uint32_t textureID, uint32_t samplerID)
+{
+    assert(indices.size() % 3 == 0);
+    return Add(DrawType::Indexed16, vertices, &indices, nullptr, modelMatrix, textureID, samplerID);
+}
+
+uint32_t Scene::AddObject(const VertexBuffer& vertices, const std::vector<uint32_t>& indices, const glm::mat4& modelMatrix, uint32_t textureID, uint32_t samplerID)
+{
+    assert(indices.size() % 3 == 0);
+    return Add(DrawType::Indexed32, vertices, nullptr, &indices, modelMatrix, textureID, samplerID);
+}
+
+
+uint32_t Scene::Add(
+    DrawType type, const VertexBuffer& vertices, const std::vector<uint16_t>* pIndices16, const std::vector<uint32_t>* pIndices32,
+    const glm::mat4& modelMatrix, uint32_t textureID, uint32_t samplerID
+)
+{
+    // Objects without any vertices are a point, so that they can still be sorted into the hierarchy.
+    const BoundingBox modelBounds = vertices.GetVertexCount() == 0 ? BoundingBox { glm::vec3 { 0.0f }, glm::vec3 { 0.0f } } : ComputeBounds(vertices);
+    const BoundingBox worldBounds = TransformBounds(modelBounds, modelMatrix);
+    m_Objects.push_back({ type, &vertices, pIndices16, pIndices32, modelMatrix, textureID, samplerID, modelBounds, worldBounds });
+    m_NeedsRebuild = true;
+    return m_Objects.size() - 1;
+}
+
+
+void Scene::SetModelMatrix(uint32_t id, const glm::mat4& modelMatrix)
+{
+    Object& rObject = m_Objects[id];
+    rObject.modelMatrix = modelMatrix;
+    rObject.worldBounds = TransformBounds(rObject.modelBounds, modelMatrix);
+    m_NeedsRefit = true;
+}
+
+
+uint32_t Scene::GetObjectCount() const
+{
+    return m_Objects.size();
+}
+
+
+BoundingBox Scene::GetWorldBounds(uint32_t id) const
+{
+    return m_Objects[id].worldBounds;
+}
+
+
+// Splits objects in half by their centers along the longest axis, top down.
+void Scene::Rebuild()
+{
+    m_ObjectOrder.resize(m_Objects.size());
+    for (uint32_t i = 0; i < m_Objects.size(); i++)
+    {
+        m_ObjectOrder[i] = i;
+    }
+
+    m_Nodes.clear();
+    if ( ! m_Objects.empty())
+    {
+        m_Nodes.push_back({});
+        BuildNode(0, 0, m_Objects.size());
+    }
+    m_NeedsRebuild = false;
+    m_NeedsRefit = false;
+}
+
+
+void Scene::BuildNode(uint32_t nodeIndex, uint32_t first, uint32_t count)
+{
+    BoundingBox bounds = m_Objects[m_ObjectOrder[first]].worldBounds;
+    BoundingBox centers { bounds.GetCenter(), bounds.GetCenter() };
+    for (uint32_t i = first + 1; i < first + count; i++)
+    {
+        const BoundingBox& rObjectBounds = m_Objects[m_ObjectOrder[i]].worldBounds;
+        bounds = CombineBounds(bounds, rObjectBounds);
+        centers = CombineBounds(centers, { rObjectBounds.GetCenter(), rObjectBounds.GetCenter() });
+    }
+
+    if (count <= MAX_LEAF_OBJECTS)
+    {
+        m_Nodes[nodeIndex] = { bounds, first, count };
+        return;
+    }
+
+    const glm::vec3 size = centers.maximum - centers.minimum;
+    const int axis = size.x > size.y && size.x > size.z ? 0 : (size.y > size.z ? 1 : 2);
+    const auto begin = m_ObjectOrder.begin() + first;
+    std::nth_element(begin, begin + count / 2, begin + count, [this, axis](uint32_t a, uint32_t b) {
+        return m_Objects[a].worldBounds.GetCenter()[axis] < m_Objects[b].worldBounds.GetCenter()[axis];
+    });
+
+    // Nodes can move as children are added, so this one is set by index.
+    const uint32_t childIndex = m_Nodes.size();
+    m_Nodes.push_back({});
+    m_Nodes.push_back({});
+    m_Nodes[nodeIndex] = { bounds, childIndex, 0 };
+    BuildNode(childIndex, first, count / 2);
+    BuildNode(childIndex + 1, first + count / 2, count - count / 2);
+}
+
+
+// Children always come after their parents, so going backwards
+// brings every node up to date after everything under it.
+void Scene::Refit()
+{
+    for (uint32_t i = m_Nodes.size(); i-- > 0; )
+    {
+        Node& rNode = m_Nodes[i];
+        if (rNode.count == 0)
+        {
+            rNode.bounds = CombineBounds(m_Nodes[rNode.first].bounds, m_Nodes[rNode.first + 1].bounds);
+            continue;
+        }
+        rNode.bounds = m_Objects[m_ObjectOrder[rNode.first]].worldBounds;
+        for (uint32_t j = 1; j < rNode.count; j++)
+        {
+            rNode.bounds = CombineBounds(rNode.bounds, m_Objects[m_ObjectOrder[rNode.first + j]].worldBounds);
+        }
+    }
+    m_NeedsRefit = false;
+}
+
+
+void Scene::Cull(const glm::mat4& projectionMatrix, const glm::mat4& viewMatrix, CommandBuffer& rCommands)
+{
+    if (m_NeedsRebuild)
+    {
+        Rebuild();
+    }
+    else if (m_NeedsRefit)
+    {
+        Refit();
+    }
+
+    m_CullStats = {};
+    if (m_Nodes.empty())
+    {
+        return;
+    }
+
+    rCommands.SetProjectionMatrix(projectionMatrix);
+    const Frustum frustum = ExtractFrustum(projectionMatrix * viewMatrix);
+
+    // Once a node is inside a plane, so is everything under it.
+    m_CullStack.clear();
+    m_CullStack.push_back({ 0, FRUSTUM_ALL_PLANES });
+    while ( ! m_CullStack.empty())
+    {
+        const CullEntry entry = m_CullStack.back();
+        m_CullStack.pop_back();
+        m_CullStats.visitedNodes++;
+
+        const Node& rNode = m_Nodes[entry.nodeIndex];
+        uint8_t planeMask = entry.planeMask;
+        if (ClassifyBounds(frustum, rNode.bounds, planeMask) == FrustumCoverage::Outside)
+        {
+            continue;
+        }
+
+        if (rNode.count == 0)
+        {
+            // Pushed second, so visited first.
+            m_CullStack.push_back({ rNode.first + 1, planeMask });
+            m_CullStack.push_back({ rNode.first, planeMask });
+            continue;
+        }
+
+        // Objects in a leaf are tested on their own, as they are
+        // usually much smaller than the leaf's bounds.
+        for (uint32_t i = rNode.first; i < rNode.first + rNode.count; i++)
+        {
+            const Object& rObject = m_Objects[m_ObjectOrder[i]];
+            uint8_t objectPlaneMask = planeMask;
+            const FrustumCoverage coverage = ClassifyBounds(frustum, rObject.worldBounds, objectPlaneMask);
+            if (coverage != FrustumCoverage::Outside)
+            {
+                RecordObject(rObject, viewMatrix, coverage == FrustumCoverage::Inside, rCommands);
+            }
+        }
+    }
+}
+
+
+void Scene::RecordObject(const Object& object, const glm::mat4& viewMatrix, bool insideFrustum, CommandBuffer& rCommands)
+{
+    m_CullStats.visibleObjects++;
+    m_CullStats.insideObjects += insideFrustum ? 1 : 0;
+
+    rCommands.SetViewModelMatrix(viewMatrix * object.modelMatrix);
+    rCommands.UseTexture(object.textureID);
+    rCommands.UseSampler(object.samplerID);
+    rCommands.SetInsideFrustum(insideFrustum);
+    switch (object.type)
+    {
+        case DrawType::TriangleList:
+            rCommands.DrawTriangleList(*object.pVertices, object.modelBounds);
+            break;
+        case DrawType::Indexed16:
+            rCommands.DrawIndexedTriangles(*object.pVertices, *object.pIndices16, object.modelBounds);
+            break;
+        case DrawType::Indexed32:
+            rCommands.DrawIndexedTriangles(*object.pVertices, *object.pIndices32, object.modelBounds);
+            break;
+    }
+}
+
+
+SceneCullStats Scene::GetCullStats() const
+{
+    return m_CullStats;
+}
@@ -0,0 +1,111 @@
+
+#ifndef SCENE_HPP
+#define SCENE_HPP
+
+#include <stdint.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "Bounds.hpp"
+#include "CommandBuffer.hpp"
+#include "VertexBuffer.hpp"
+
+
+// What the last Cull did.
+struct SceneCullStats
+{
+    uint64_t visitedNodes = 0;
+    uint64_t visibleObjects = 0;
+
+    // Visible objects entirely inside the view volume, which skip clipping.
+    uint64_t insideObjects = 0;
+};
+
+
+// Objects placed in the world, kept in a bounding volume hierarchy so that
+// only the ones which might be seen need to be drawn. Like a command buffer,
+// it only refers to vertex buffers and indices, so they have to outlive it.
+class Scene
+{
+public:
+
+    Scene();
+
+    // Returns an ID for the object, counting up from 0.
+    uint32_t AddObject(const VertexBuffer& vertices, const glm::mat4& modelMatrix, uint32_t textureID = 0, uint32_t samplerID = 0);
+    uint32_t AddObject(const VertexBuffer& vertices, const std::vector<uint16_t>& indices, const glm::mat4& modelMatrix, uint32_t textureID = 0, uint32_t samplerID = 0);
+    uint32_t AddObject(const VertexBuffer& vertices, const std::vector<uint32_t>& indices, const glm::mat4& modelMatrix, uint32_t textureID = 0, uint32_t samplerID = 0);
+
+    // Moving objects only refits the hierarchy's bounds, which is cheap, but
+    // it gets worse at culling as objects move far from where they were when
+    // it was built. Adding an object rebuilds it.
+    void SetModelMatrix(uint32_t id, const glm::mat4& modelMatrix);
+    void Rebuild();
+
+    uint32_t GetObjectCount() const;
+    BoundingBox GetWorldBounds(uint32_t id) const;
+
+    // Records a draw into rCommands for every object which might be inside
+    // the view volume, and marks the ones entirely inside it so that they
+    // skip clipping. Draws are recorded in no particular order, after
+    // whatever rCommands already holds, and leave its state as they like.
+    void Cull(const glm::mat4& projectionMatrix, const glm::mat4& viewMatrix, CommandBuffer& rCommands);
+    SceneCullStats GetCullStats() const;
+
+private:
+
+    static constexpr uint32_t MAX_LEAF_OBJECTS = 4;
+
+    struct Object
+    {
+        DrawType type;
+        const VertexBuffer* pVertices;
+        const std::vector<uint16_t>* pIndices16;
+        const std::vector<uint32_t>* pIndices32;
+
+        glm::mat4 modelMatrix;
+        uint32_t textureID;
+        uint32_t samplerID;
+
+        BoundingBox modelBounds;
+        BoundingBox worldBounds;
+    };
+
+    // Leaves hold count objects, from first in m_ObjectOrder. Other nodes have
+    // a count of 0, and their two children are at first and first + 1, which
+    // is always after the node itself.
+    struct Node
+    {
+        BoundingBox bounds;
+        uint32_t first;
+        uint32_t count;
+    };
+
+    // A node still to visit, and the frustum planes it still has to be tested against.
+    struct CullEntry
+    {
+        uint32_t nodeIndex;
+        uint8_t planeMask;
+    };
+
+    uint32_t Add(DrawType type, const VertexBuffer& vertices, const std::vector<uint16_t>* pIndices16, const std::vector<uint32_t>* pIndices32, const glm::mat4& modelMatrix, uint32_t textureID, uint32_t samplerID);
+    void BuildNode(uint32_t nodeIndex, uint32_t first, uint32_t count);
+    void Refit();
+    void RecordObject(const Object& object, const glm::mat4& viewMatrix, bool insideFrustum, CommandBuffer& rCommands);
+
+
+    std::vector<Object> m_Objects;
+    std::vector<uint32_t> m_ObjectOrder;
+    std::vector<Node> m_Nodes;
+    bool m_NeedsRebuild;
+    bool m_NeedsRefit;
+
+    // Kept between culls, so that they don't allocate every time.
+    std::vector<CullEntry> m_CullStack;
+    SceneCullStats m_CullStats;
+
+};
+
+
+#endif
@@ -0,0 +1,89 @@
+
+#include <algorithm>
+#include <cassert>
+#include <new>
+
+#include "ScratchArena.hpp"
+
+
+ScratchArena::ScratchArena() :
+    m_Blocks {},
+    m_Offset {0},
+    m_FilledBytes {0},
+    m_Stats {}
+{
+}
+
+
+ScratchArena::~ScratchArena()
+{
+    FreeBlocks();
+}
+
+
+void* ScratchArena::Allocate(size_t size, size_t alignment)
+{
+    assert(alignment <= BLOCK_ALIGNMENT && (alignment & (alignment - 1)) == 0);
+
+    size_t offset = (m_Offset + alignment - 1) & ~(alignment - 1);
+    if (m_Blocks.empty() || offset + size > m_Blocks.back().size)
+    {
+        m_FilledBytes += m_Offset;
+        AddBlock(size);
+        offset = 0;
+    }
+
+    m_Offset = offset + size;
+    m_Stats.highWaterMark = std::max(m_Stats.highWaterMark, m_FilledBytes + m_Offset);
+    return m_Blocks.back().pData + offset;
+}
+
+
+void ScratchArena::Reset()
+{
+    if (m_Blocks.size() > 1)
+    {
+        // Had to grow, so replace the chain with one block
+        // which would have held everything.
+        const size_t capacity = m_Stats.capacity;
+        FreeBlocks();
+        AddBlock(capacity);
+    }
+    m_Offset = 0;
+    m_FilledBytes = 0;
+}
+
+
+ScratchArenaStats ScratchArena::GetStats() const
+{
+    return m_Stats;
+}
+
+
+void ScratchArena::AddBlock(size_t minimumSize)
+{
+    // Grow geometrically, so a big workload only takes a few blocks to warm up to.
+    size_t size = std::max(minimumSize, MIN_BLOCK_SIZE);
+    if ( ! m_Blocks.empty())
+    {
+        size = std::max(size, m_Blocks.back().size * 2);
+    }
+
+    m_Blocks.push_back({
+        static_cast<uint8_t*>(::operator new(size, std::align_val_t { BLOCK_ALIGNMENT })),
+        size
+    });
+    m_Stats.capacity += size;
+    m_Stats.blockAllocations++;
+}
+
+
+void ScratchArena::FreeBlocks()
+{
+    for (const auto& rBlock : m_Blocks)
+    {
+        ::operator delete(rBlock.pData, std::align_val_t { BLOCK_ALIGNMENT });
+    }
+    m_Blocks.clear();
+    m_Stats.capacity = 0;
+}
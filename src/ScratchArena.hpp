@@ -0,0 +1,161 @@
+
+#ifndef SCRATCH_ARENA_HPP
+#define SCRATCH_ARENA_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <type_traits>
+#include <vector>
+
+
+struct ScratchArenaStats
+{
+    // Most bytes in use at once, since the arena was created.
+    size_t highWaterMark = 0;
+    size_t capacity = 0;
+
+    // Heap allocations made for blocks. Stops going up
+    // once the arena has seen its biggest workload.
+    uint64_t blockAllocations = 0;
+};
+
+
+// Linear allocator for storage which only has to last until the next Reset.
+// Allocating just bumps an offset, and nothing is freed on its own.
+//
+// When a block runs out, another is chained on. The next Reset swaps them
+// all for a single block big enough for everything, so that once it has
+// warmed up, an arena doesn't touch the heap at all.
+class ScratchArena
+{
+public:
+
+    ScratchArena();
+    ~ScratchArena();
+
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    // Alignment is at most BLOCK_ALIGNMENT.
+    void* Allocate(size_t size, size_t alignment);
+
+    // Uninitialized storage for count objects, which are never destroyed.
+    template <typename T>
+    T* Allocate(size_t count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "Scratch storage is never destroyed");
+        return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    // Throws away everything allocated so far.
+    void Reset();
+
+    ScratchArenaStats GetStats() const;
+
+    static constexpr size_t BLOCK_ALIGNMENT = 64;
+
+private:
+
+    static constexpr size_t MIN_BLOCK_SIZE = 64 * 1024;
+
+    struct Block
+    {
+        uint8_t* pData;
+        size_t size;
+    };
+
+    void AddBlock(size_t minimumSize);
+    void FreeBlocks();
+
+
+    std::vector<Block> m_Blocks;
+
+    // Offset into the last block, and bytes used in the ones before it.
+    size_t m_Offset;
+    size_t m_FilledBytes;
+
+    ScratchArenaStats m_Stats;
+
+};
+
+
+// Append-only list for scratch storage, in chunks allocated from an arena.
+// Clearing it just forgets the chunks, so it has to be cleared whenever
+// the arena is reset.
+template <typename T, uint32_t ChunkSize = 32>
+class ScratchList
+{
+public:
+
+    ScratchList() :
+        m_pFirst { nullptr },
+        m_pLast { nullptr },
+        m_Size { 0 }
+    {
+    }
+
+    void PushBack(ScratchArena& rArena, const T& value)
+    {
+        if (m_Size % ChunkSize == 0)
+        {
+            Chunk* pChunk = rArena.Allocate<Chunk>(1);
+            pChunk->pNext = nullptr;
+            if (m_pLast == nullptr)
+            {
+                m_pFirst = pChunk;
+            }
+            else
+            {
+                m_pLast->pNext = pChunk;
+            }
+            m_pLast = pChunk;
+        }
+        m_pLast->items[m_Size % ChunkSize] = value;
+        m_Size++;
+    }
+
+    void Clear()
+    {
+        m_pFirst = nullptr;
+        m_pLast = nullptr;
+        m_Size = 0;
+    }
+
+    uint32_t GetSize() const
+    {
+        return m_Size;
+    }
+
+    // Calls func on every item, in the order they were added.
+    template <typename Func>
+    void ForEach(Func func) const
+    {
+        uint32_t remaining = m_Size;
+        for (const Chunk* pChunk = m_pFirst; pChunk != nullptr; pChunk = pChunk->pNext)
+        {
+            const uint32_t count = remaining < ChunkSize ? remaining : ChunkSize;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                func(pChunk->items[i]);
+            }
+            remaining -= count;
+        }
+    }
+
+private:
+
+    struct Chunk
+    {
+        Chunk* pNext;
+        T items[ChunkSize];
+    };
+
+    Chunk* m_pFirst;
+    Chunk* m_pLast;
+    uint32_t m_Size;
+
+};
+
+
+#endif
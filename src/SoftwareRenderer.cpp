@@ -1,588 +1,2452 @@
-
-#include <algorithm>
-#include <cmath>
-#include <stdio.h>
-
-#include <glm/gtc/matrix_transform.hpp>
-
-#include "SoftwareRenderer.hpp"
-
-
-static int frameTriangleCounter = 0;
-
-
-SoftwareRenderer::SoftwareRenderer(uint32_t frameWidth, uint32_t frameHeight) :
-    m_FrameWidth { frameWidth },
-    m_FrameHeight { frameHeight },
-    m_Framebuffer {},
-    m_DepthBuffer {},
-    m_Textures {},
-    m_ActiveTextureID {0},
-    m_ProjectionMatrix { 1.0 },
-    m_ViewModelMatrix { 1.0 }
-{
-    m_Framebuffer.resize(m_FrameWidth * m_FrameHeight * 4);
-    m_DepthBuffer.resize(m_FrameWidth * m_FrameHeight);
-}
-
-
-void SoftwareRenderer::Clear(uint8_t r, uint8_t g, uint8_t b)
-{
-    // TODO: Use flags to clear color buffer, depth buffer, etc. separately
-    for (uint32_t i = 0; i < m_Framebuffer.size(); i += 4)
-    {
-        m_Framebuffer[i + 0] = b;
-        m_Framebuffer[i + 1] = g;
-        m_Framebuffer[i + 2] = r;
-        m_Framebuffer[i + 3] = 0xff;
-    }
-
-    for (uint32_t i = 0; i < m_DepthBuffer.size(); i++)
-    {
-        m_DepthBuffer[i] = std::numeric_limits<float>::infinity();
-    }
-
-    printf("Drew %d triangles last frame! \n", frameTriangleCounter);
-    frameTriangleCounter = 0;
-}
-
-
-void SoftwareRenderer::SetProjectionMatrix(const glm::mat4& value)
-{
-    m_ProjectionMatrix = value;
-}
-
-void SoftwareRenderer::SetViewModelMatrix(const glm::mat4& value)
-{
-    m_ViewModelMatrix = value;
-}
-
-
-uint32_t SoftwareRenderer::CreateTexture()
-{
-    m_Textures.push_back({0, 0, {}});
-    return m_Textures.size();
-}
-
-void SoftwareRenderer::UpdateTexture(uint32_t id, uint32_t width, uint32_t height, const uint8_t* pData)
-{
-    // TODO: Optimize this? Why bother inserting elements when all I want
-    // is an empty buffer? A simple C implementation would just use malloc
-    // and store the list of pointers.
-    //
-    auto& rTexture = m_Textures[id - 1];
-    rTexture.width = width;
-    rTexture.height = height;
-    rTexture.data.resize(0);
-    for (uint32_t i = 0; i < rTexture.width * rTexture.height * 4; i++)
-    {
-        rTexture.data.push_back(static_cast<float>(pData[i]) / static_cast<float>(0xff));
-    }
-}
-
-void SoftwareRenderer::DestroyTexture(uint32_t id)
-{
-    auto& rTexture = m_Textures[id - 1];
-    rTexture.width = 0;
-    rTexture.height = 0;
-    rTexture.data.resize(0);
-}
-
-void SoftwareRenderer::UseTexture(uint32_t id)
-{
-    m_ActiveTextureID = id;
-}
-
-SoftwareRenderer::Texture& SoftwareRenderer::GetActiveTexture()
-{
-    return m_Textures[m_ActiveTextureID - 1];
-}
-
-
-void SoftwareRenderer::DrawTriangleList(const std::vector<Vertex>& vertices)
-{
-    // Model Space -> World Space -> Camera Space -> [Clip Space] -> NDC Space -> Raster Space
-    glm::mat4 transformMatrix = m_ProjectionMatrix * m_ViewModelMatrix;
-    auto moveToClipSpace = [transformMatrix](Vertex& v) {
-        v.position = transformMatrix * v.position;
-    };
-
-    enum class Direction { X, Y, Z };
-
-    // For now, only clipping against the "right" (+X) plane.
-    auto clipLineSegment = [](const Vertex& a, const Vertex& b, Direction direction, bool positive) -> Vertex {
-        // a inside, b outside
-
-        // TODO: Extract math functions for later (when giving up GLM)
-        auto interpolate = [](float a, float b, float weight) {
-            return a * weight + b * (1.0f - weight);
-        };
-
-        float coordinateA;
-        float coordinateB;
-        switch (direction)
-        {
-        case Direction::X:
-            coordinateA = a.position.x;
-            coordinateB = b.position.x;
-            break;
-        case Direction::Y:
-            coordinateA = a.position.y;
-            coordinateB = b.position.y;
-            break;
-        case Direction::Z:
-            coordinateA = a.position.z;
-            coordinateB = b.position.z;
-            break;
-        }
-
-        // TODO: Invariant: 0 <= *.W
-        // If it's not, what do we do?
-        if (a.position.w < 0 || b.position.w < 0)
-        {
-            printf("WARNING: a.position.w == %02f, b.position.w == %02f \n", a.position.w, b.position.w);
-        }
-
-        // TODO: Different for Z near/far clipping?
-        const float wClipA = positive ? a.position.w : -a.position.w;
-        const float wClipB = positive ? b.position.w : -b.position.w;
-        const float n = (wClipB - coordinateB);
-        const float t = n / (n + coordinateA - wClipA);
-
-        const float newX = interpolate(a.position.x, b.position.x, t);
-        const float newY = interpolate(a.position.y, b.position.y, t);
-        const float newZ = interpolate(a.position.z, b.position.z, t);
-        float newW;
-        switch (direction)
-        {
-        case Direction::X: newW = positive ? newX : -newX; break;
-        case Direction::Y: newW = positive ? newY : -newY; break;
-        case Direction::Z: newW = positive ? newZ : -newZ; break;
-        }
-
-        const float newR = interpolate(a.color.r, b.color.r, t);
-        const float newG = interpolate(a.color.g, b.color.g, t);
-        const float newB = interpolate(a.color.b, b.color.b, t);
-
-        const float newU = interpolate(a.texcoords.x, b.texcoords.x, t);
-        const float newV = interpolate(a.texcoords.y, b.texcoords.y, t);
-
-        return {
-            { newX, newY, newZ, newW },
-            { newR, newG, newB },
-            { newU, newV }
-        };
-    };
-
-    // TODO: Avoid copying vertices? Make local VBOs to use instead?
-    // This algorithm modifies the vertices, so it might be unavoidable to
-    // make a copy to clip in.
-    std::vector<Vertex> clipVertices;
-    for (auto v : vertices)
-    {
-        moveToClipSpace(v);
-        clipVertices.push_back(v);
-    }
-
-    std::vector<Vertex> newClipVertices;
-
-    // TODO: Clean this up
-    for (int planeNumber = 0; planeNumber < 6; planeNumber++)
-    {
-        // if (planeNumber > 1) break;
-        for (size_t i = 0; i < clipVertices.size(); i += 3)
-        {
-            Vertex v0 = clipVertices[i + 0];
-            Vertex v1 = clipVertices[i + 1];
-            Vertex v2 = clipVertices[i + 2];
-
-            // TODO: Move this out. This doesn't need to be a lambda.
-            auto clipTriangle = [&newClipVertices, clipLineSegment, v0, v1, v2](Direction direction, bool positive) {
-
-                bool v0_out;
-                bool v1_out;
-                bool v2_out;
-                switch (direction)
-                {
-                case Direction::X:
-                    v0_out = positive ? v0.position.x > v0.position.w : v0.position.x < -v0.position.w;
-                    v1_out = positive ? v1.position.x > v1.position.w : v1.position.x < -v1.position.w;
-                    v2_out = positive ? v2.position.x > v2.position.w : v2.position.x < -v2.position.w;
-                    break;
-
-                case Direction::Y:
-                    v0_out = positive ? v0.position.y > v0.position.w : v0.position.y < -v0.position.w;
-                    v1_out = positive ? v1.position.y > v1.position.w : v1.position.y < -v1.position.w;
-                    v2_out = positive ? v2.position.y > v2.position.w : v2.position.y < -v2.position.w;
-                    break;
-
-                case Direction::Z:
-                    v0_out = positive ? v0.position.z > v0.position.w : v0.position.z < -v0.position.w;
-                    v1_out = positive ? v1.position.z > v1.position.w : v1.position.z < -v1.position.w;
-                    v2_out = positive ? v2.position.z > v2.position.w : v2.position.z < -v2.position.w;
-                    break;
-                }
-
-                // TODO: How to optimize this?
-                // (?) https://en.wikipedia.org/wiki/Sutherland%E2%80%93Hodgman_algorithm
-
-                // If the bit is set, then the vertex is inside the clipping plane.
-                // const uint8_t pattern =
-                uint8_t pattern =
-                    (v0_out ? 0 : 0b100) |
-                    (v1_out ? 0 : 0b010) |
-                    (v2_out ? 0 : 0b001);
-
-                switch (pattern)
-                {
-                    case 0b000:
-                        // All outside, so skip the triangle.
-                        break;
-
-                    case 0b011:
-                    {
-                        // Just v0 out
-                        const auto v1_prime = clipLineSegment(v1, v0, direction, positive);
-                        const auto v2_prime = clipLineSegment(v2, v0, direction, positive);
-                        newClipVertices.push_back(v2_prime);
-                        newClipVertices.push_back(v1_prime);
-                        newClipVertices.push_back(v1);
-                        newClipVertices.push_back(v1);
-                        newClipVertices.push_back(v2);
-                        newClipVertices.push_back(v2_prime);
-                        break;
-                    }
-
-                    case 0b101:
-                    {
-                        // Just v1 out
-                        const auto v0_prime = clipLineSegment(v0, v1, direction, positive);
-                        const auto v2_prime = clipLineSegment(v2, v1, direction, positive);
-                        newClipVertices.push_back(v0_prime);
-                        newClipVertices.push_back(v2_prime);
-                        newClipVertices.push_back(v2);
-                        newClipVertices.push_back(v2);
-                        newClipVertices.push_back(v0);
-                        newClipVertices.push_back(v0_prime);
-                        break;
-                    }
-
-                    case 0b110:
-                    {
-                        // Just v2 out
-                        const auto v0_prime = clipLineSegment(v0, v2, direction, positive);
-                        const auto v1_prime = clipLineSegment(v1, v2, direction, positive);
-                        newClipVertices.push_back(v1_prime);
-                        newClipVertices.push_back(v0_prime);
-                        newClipVertices.push_back(v0);
-                        newClipVertices.push_back(v0);
-                        newClipVertices.push_back(v1);
-                        newClipVertices.push_back(v1_prime);
-                        break;
-                    }
-
-                    case 0b001:
-                    {
-                        // v0 and v1 out
-                        const auto v0_prime = clipLineSegment(v2, v0, direction, positive);
-                        const auto v1_prime = clipLineSegment(v2, v1, direction, positive);
-                        newClipVertices.push_back(v0_prime);
-                        newClipVertices.push_back(v1_prime);
-                        newClipVertices.push_back(v2);
-                        break;
-                    }
-
-                    case 0b010:
-                    {
-                        // v0 and v2 out
-                        const auto v0_prime = clipLineSegment(v1, v0, direction, positive);
-                        const auto v2_prime = clipLineSegment(v1, v2, direction, positive);
-                        newClipVertices.push_back(v2_prime);
-                        newClipVertices.push_back(v0_prime);
-                        newClipVertices.push_back(v1);
-                        break;
-                    }
-
-                    case 0b100:
-                    {
-                        // v1 and v2 out
-                        const auto v1_prime = clipLineSegment(v0, v1, direction, positive);
-                        const auto v2_prime = clipLineSegment(v0, v2, direction, positive);
-                        newClipVertices.push_back(v1_prime);
-                        newClipVertices.push_back(v2_prime);
-                        newClipVertices.push_back(v0);
-                        break;
-                    }
-
-                    case 0b111:
-                        // All inside, so just draw as-is.
-                        newClipVertices.push_back(v0);
-                        newClipVertices.push_back(v1);
-                        newClipVertices.push_back(v2);
-                        break;
-
-                    default:
-                        assert(false);
-                        break;
-                }
-            };  // clipTriangle
-
-            switch (planeNumber)
-            {
-            case 0:
-                clipTriangle(Direction::X, true);
-                break;
-            case 1:
-                clipTriangle(Direction::X, false);
-                break;
-            case 2:
-                clipTriangle(Direction::Y, true);
-                break;
-            case 3:
-                clipTriangle(Direction::Y, false);
-                break;
-            case 4:
-                clipTriangle(Direction::Z, true);
-                break;
-            case 5:
-                clipTriangle(Direction::Z, false);
-                break;
-            default:
-                assert(false);
-                break;
-            }
-
-        }
-
-        // After clipping each triangle against a plane,
-        // move the new vertices back into the original
-        // list to be processed again against a different plane.
-        newClipVertices.swap(clipVertices);
-        newClipVertices.clear();
-
-    }
-
-    printf("Ready to draw %d triangles! \n", clipVertices.size() / 3);
-    for (size_t i = 0; i < clipVertices.size(); i += 3)
-    {
-        Vertex v0 = clipVertices[i + 0];
-        Vertex v1 = clipVertices[i + 1];
-        Vertex v2 = clipVertices[i + 2];
-
-        RenderTriangle(v0, v1, v2);
-    }
-
-}
-
-
-// Renders a triangle, assuming that it has already been transformed
-// and clipped into the view port.
-// void SoftwareRenderer::RenderTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2)
-void SoftwareRenderer::RenderTriangle(Vertex& v0, Vertex& v1, Vertex& v2)
-{
-
-    // Model Space -> World Space -> Camera Space -> Clip Space -> [NDC Space] -> Raster Space
-    auto perspectiveDivide = [](Vertex& v) {
-        v.position.x /= v.position.w;
-        v.position.y /= v.position.w;
-        v.position.z /= v.position.w;
-
-        v.color.r /= v.position.w;
-        v.color.g /= v.position.w;
-        v.color.b /= v.position.w;
-
-        v.texcoords.x /= v.position.w;
-        v.texcoords.y /= v.position.w;
-
-        // (???) For perspective correction (1/w is linear in screen space)
-        // v.oneOverW = 1.0f / v.position.w;
-
-    };
-
-    // Model Space -> World Space -> Camera Space -> Clip Space -> NDC Space -> [Raster Space]
-    auto viewportTransform = [this](Vertex& v) {
-        v.position.x = (1.0f + v.position.x) * (m_FrameWidth / 2);
-        v.position.y = (1.0f - v.position.y) * (m_FrameHeight / 2);
-    };
-
-    Vertex v0_copy = v0;
-    Vertex v1_copy = v1;
-    Vertex v2_copy = v2;
-
-    perspectiveDivide(v0);
-    perspectiveDivide(v1);
-    perspectiveDivide(v2);
-
-    viewportTransform(v0);
-    viewportTransform(v1);
-    viewportTransform(v2);
-
-    auto edgeFunction = [](const glm::vec2& p, const glm::vec2& p1, const glm::vec2& p2)
-    {
-        const glm::vec2 a { p2 - p1 };
-        const glm::vec2 b { p - p1 };
-        return a.x * b.y - a.y * b.x;
-    };
-
-    const float totalArea = edgeFunction({v0.position.x, v0.position.y}, {v1.position.x, v1.position.y}, {v2.position.x, v2.position.y});
-    if (totalArea <= 0)
-    {
-        // Cull back facing triangles
-	return;
-    }
-
-    // TODO: Use a smarter algorithm than a bounding box.
-    uint32_t xmin = static_cast<uint32_t>(std::round(std::min({v0.position.x, v1.position.x, v2.position.x})));
-    uint32_t xmax = static_cast<uint32_t>(std::round(std::max({v0.position.x, v1.position.x, v2.position.x})));
-    uint32_t ymin = static_cast<uint32_t>(std::round(std::min({v0.position.y, v1.position.y, v2.position.y})));
-    uint32_t ymax = static_cast<uint32_t>(std::round(std::max({v0.position.y, v1.position.y, v2.position.y})));
-
-    glm::vec3 debugColor;
-    switch (frameTriangleCounter % 12) {
-        case 0: debugColor = {1.0, 0.0, 0.0}; break;
-        case 1: debugColor = {0.0, 1.0, 0.0}; break;
-        case 2: debugColor = {0.0, 0.0, 1.0}; break;
-        case 3: debugColor = {1.0, 1.0, 0.0}; break;
-        case 4: debugColor = {1.0, 0.0, 1.0}; break;
-        case 5: debugColor = {0.0, 1.0, 1.0}; break;
-        case 6: debugColor = {0.5, 0.0, 0.0}; break;
-        case 7: debugColor = {0.0, 0.5, 0.0}; break;
-        case 8: debugColor = {0.0, 0.0, 0.5}; break;
-        case 9: debugColor = {0.5, 0.5, 0.0}; break;
-        case 10: debugColor = {0.5, 0.0, 0.5}; break;
-        case 11: debugColor = {0.0, 0.5, 0.5}; break;
-    }
-    frameTriangleCounter += 1;
-
-    for (uint32_t y = ymin; y <= ymax; y++)
-    {
-        for (uint32_t x = xmin; x <= xmax; x++)
-        {
-
-            const float area_v0_v1_p = edgeFunction({x, y}, {v0.position.x, v0.position.y}, {v1.position.x, v1.position.y});
-            const float area_v1_v2_p = edgeFunction({x, y}, {v1.position.x, v1.position.y}, {v2.position.x, v2.position.y});
-            const float area_v2_v0_p = edgeFunction({x, y}, {v2.position.x, v2.position.y}, {v0.position.x, v0.position.y});
-
-            // TODO: Test for top and left edges to prevent drawing over the same edge of adjacent triangles
-            // Assumes clockwise winding for front faces:
-            if (area_v0_v1_p > 0 && area_v1_v2_p > 0 && area_v2_v0_p > 0)
-            {
-                // w0 not needed due to optimization (see below)
-                const float w1 = area_v2_v0_p / totalArea;
-                const float w2 = area_v0_v1_p / totalArea;
-
-                auto mixBarycentric = [w1, w2](float z0, float z1, float z2)
-                {
-                    // Barycentric coordinates optimization:
-                    // removes a multiply
-                    //
-                    // w0 + w1 + w2 = 1
-                    // w0 = 1 - w1 - w2
-                    // Z = (w0 * Z0) + (w1 * Z1) + (w2 * Z2)
-                    // Z = ((1 - w1 - w2) * Z0) + (w1 * Z1) + (w2 * Z2)
-                    // Z = Z0 + w1(Z1 - Z0) + w2(Z2 - Z0)
-                    return z0 + w1 * (z1 - z0) + w2 * (z2 - z0);
-                };
-
-                uint32_t pixelIndex = (y * m_FrameWidth + x);
-
-                // Depth Test
-                // TODO: Use 1/z instead, will need to init depth buffer
-                // to 0 instead of infinity
-                float lastDepth = m_DepthBuffer[pixelIndex];
-
-                // Take the reciprocal for perspective correction
-                float depth = 1.0 / mixBarycentric(v0.oneOverW(), v1.oneOverW(), v2.oneOverW());
-                // float depth = 1.0 / mixBarycentric(v0.position.w, v1.position.w, v2.position.w);
-                // printf("depth = %.4f  \n", depth);
-
-                // Even though it's not clipped yet, z is less than 0.
-                // That's messing everything up here.
-                // std::cout << "depth = " << depth << std::endl;
-
-                // Sample texture, if in use
-                float textureColorR = 1.0;
-                float textureColorG = 1.0;
-                float textureColorB = 1.0;
-                float textureColorA = 1.0;
-                if (m_ActiveTextureID != 0)
-                {
-                    auto& rTexture = GetActiveTexture();
-
-                    // TODO: Support negative tex coords better?
-                    float mixedTexCoordU = std::fmod(mixBarycentric(v0.texcoords.x, v1.texcoords.x, v2.texcoords.x) * depth, 1.0f);
-                    float mixedTexCoordV = std::fmod(mixBarycentric(v0.texcoords.y, v1.texcoords.y, v2.texcoords.y) * depth, 1.0f);
-                    if (mixedTexCoordU < 0)
-                    {
-                        mixedTexCoordU += 1.0f;
-                    }
-                    if (mixedTexCoordV < 0)
-                    {
-                        mixedTexCoordV += 1.0f;
-                    }
-                    // printf("mixedTexCoord(U,V) = (%.4f, %.4f) \n", mixedTexCoordU, mixedTexCoordV);
-
-                    // TODO: Better filtering, mipmaps, texture repeating, clamping, etc.
-                    uint32_t sampleXCoord = static_cast<uint32_t>(rTexture.width * mixedTexCoordU);
-                    uint32_t sampleYCoord = static_cast<uint32_t>(rTexture.height * (1.0 - mixedTexCoordV));
-
-                    // NOTE: When using the real 18-bit color, the texture
-                    // data will (ideally) be stored
-                    uint32_t sampleIndex = (sampleYCoord * rTexture.width + sampleXCoord) * 4;
-                    textureColorB = rTexture.data[sampleIndex + 0];
-                    textureColorG = rTexture.data[sampleIndex + 1];
-                    textureColorR = rTexture.data[sampleIndex + 2];
-                    textureColorA = rTexture.data[sampleIndex + 3];
-                }
-
-                // Alpha Test
-                if (textureColorA < 0.5)
-                {
-                    continue;
-                }
-
-                if (depth < lastDepth)
-                {
-                    // Update depth buffer
-                    // TODO: Make optional
-                    m_DepthBuffer[pixelIndex] = depth;
-                }
-                else
-                {
-                    // Discard fragment
-                    continue;
-                }
-
-                float vertexColorR = mixBarycentric(v0.color.r, v1.color.r, v2.color.r) * depth;
-                float vertexColorG = mixBarycentric(v0.color.g, v1.color.g, v2.color.g) * depth;
-                float vertexColorB = mixBarycentric(v0.color.b, v1.color.b, v2.color.b) * depth;
-
-                vertexColorR = debugColor.r;
-                vertexColorG = debugColor.g;
-                vertexColorB = debugColor.b;
-
-                float pixelColorR = vertexColorR;
-                float pixelColorG = vertexColorG;
-                float pixelColorB = vertexColorB;
-                if (m_ActiveTextureID != 0)
-                {
-                    float percentTexture = 0.5;
-                    pixelColorR = (1.0 - percentTexture) * pixelColorR + percentTexture * textureColorR;
-                    pixelColorG = (1.0 - percentTexture) * pixelColorG + percentTexture * textureColorG;
-                    pixelColorB = (1.0 - percentTexture) * pixelColorB + percentTexture * textureColorB;
-                }
-
-                m_Framebuffer[pixelIndex * 4 + 0] = static_cast<uint8_t>(0xff * pixelColorB);
-                m_Framebuffer[pixelIndex * 4 + 1] = static_cast<uint8_t>(0xff * pixelColorG);
-                m_Framebuffer[pixelIndex * 4 + 2] = static_cast<uint8_t>(0xff * pixelColorR);
-                m_Framebuffer[pixelIndex * 4 + 3] = 0xff;  // TODO: Alpha Blending
-            }
-        }
-    }
-}
-
-
-const uint8_t* SoftwareRenderer::GetFramebufferPointer() const
-{
-    return &m_Framebuffer[0];
-}
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "SoftwareRenderer.hpp"
+
+
+static float EdgeFunction(const glm::vec2& p, const glm::vec2& p1, const glm::vec2& p2)
+{
+    const glm::vec2 a { p2 - p1 };
+    const glm::vec2 b { p - p1 };
+    return a.x * b.y - a.y * b.x;
+}
+
+
+RasterStats& RasterStats::operator+=(const RasterStats& other)
+{
+    rejectedBlocks += other.rejectedBlocks;
+    acceptedBlocks += other.acceptedBlocks;
+    partialBlocks += other.partialBlocks;
+    rejectedQuads += other.rejectedQuads;
+    acceptedQuads += other.acceptedQuads;
+    partialQuads += other.partialQuads;
+    testedPixels += other.testedPixels;
+    boundingBoxPixels += other.boundingBoxPixels;
+    hiZRejectedTriangles += other.hiZRejectedTriangles;
+    hiZRejectedBlocks += other.hiZRejectedBlocks;
+    depthRejectedPixels += other.depthRejectedPixels;
+    shadedPixels += other.shadedPixels;
+    return *this;
+}
+
+
+PipelineStats& PipelineStats::operator+=(const PipelineStats& other)
+{
+    verticesTransformed += other.verticesTransformed;
+    trianglesSubmitted += other.trianglesSubmitted;
+    trianglesFrustumCulled += other.trianglesFrustumCulled;
+    trianglesClipped += other.trianglesClipped;
+    trianglesBackfaceCulled += other.trianglesBackfaceCulled;
+    trianglesZeroArea += other.trianglesZeroArea;
+    trianglesTooSmall += other.trianglesTooSmall;
+    trianglesRasterized += other.trianglesRasterized;
+    fragmentsDepthTested += other.fragmentsDepthTested;
+    fragmentsPassedDepth += other.fragmentsPassedDepth;
+    fragmentsAlphaTested += other.fragmentsAlphaTested;
+    fragmentsPassedAlpha += other.fragmentsPassedAlpha;
+    pixelsWritten += other.pixelsWritten;
+    clearNanoseconds += other.clearNanoseconds;
+    geometryNanoseconds += other.geometryNanoseconds;
+    rasterNanoseconds += other.rasterNanoseconds;
+    resolveNanoseconds += other.resolveNanoseconds;
+    flushNanoseconds += other.flushNanoseconds;
+    return *this;
+}
+
+
+// Adds the time from its construction until it goes
+// out of scope to a stage's total, if stats are enabled.
+class StageTimer
+{
+public:
+
+    explicit StageTimer(uint64_t& rNanoseconds) :
+        m_rNanoseconds { rNanoseconds },
+        m_Start { PIPELINE_STATS_ENABLED ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point {} }
+    {
+    }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+    ~StageTimer()
+    {
+        if (PIPELINE_STATS_ENABLED)
+        {
+            m_rNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_Start).count();
+        }
+    }
+
+private:
+
+    uint64_t& m_rNanoseconds;
+    const std::chrono::steady_clock::time_point m_Start;
+
+};
+
+
+// Planes clip space triangles are actually clipped against.
+enum class ClipPlane
+{
+    Near,
+    Far,
+    GuardBandPositiveX,
+    GuardBandNegativeX,
+    GuardBandPositiveY,
+    GuardBandNegativeY,
+};
+
+static const uint32_t CLIP_PLANE_COUNT = 6;
+
+
+// Signed distance from a clip plane, which is positive on the inside.
+static float ClipDistance(ClipPlane plane, const glm::vec4& p)
+{
+    switch (plane)
+    {
+    case ClipPlane::Near: return p.w + p.z;
+    case ClipPlane::Far: return p.w - p.z;
+    case ClipPlane::GuardBandPositiveX: return CLIP_GUARD_BAND * p.w - p.x;
+    case ClipPlane::GuardBandNegativeX: return CLIP_GUARD_BAND * p.w + p.x;
+    case ClipPlane::GuardBandPositiveY: return CLIP_GUARD_BAND * p.w - p.y;
+    case ClipPlane::GuardBandNegativeY: return CLIP_GUARD_BAND * p.w + p.y;
+    }
+    assert(false);
+    return 0.0f;
+}
+
+
+// Sutherland-Hodgman against a single plane. The polygon keeps its winding.
+// Returns the number of vertices written to pOutput, at most one more than count.
+template <uint32_t N>
+static uint32_t ClipPolygon(ClipPlane plane, const ClipVertex<N>* pInput, uint32_t count, ClipVertex<N>* pOutput)
+{
+    uint32_t outputCount = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const ClipVertex<N>& rCurrent = pInput[i];
+        const ClipVertex<N>& rNext = pInput[(i + 1) % count];
+        const float currentDistance = ClipDistance(plane, rCurrent.position);
+        const float nextDistance = ClipDistance(plane, rNext.position);
+
+        if (currentDistance >= 0)
+        {
+            pOutput[outputCount++] = rCurrent;
+        }
+        if ((currentDistance >= 0) != (nextDistance >= 0))
+        {
+            // Always interpolate from the inside vertex, so that a triangle
+            // on the other side of this edge gets exactly the same vertex.
+            const bool currentInside = currentDistance >= 0;
+            const ClipVertex<N>& rInside = currentInside ? rCurrent : rNext;
+            const ClipVertex<N>& rOutside = currentInside ? rNext : rCurrent;
+            const float insideDistance = currentInside ? currentDistance : nextDistance;
+            const float outsideDistance = currentInside ? nextDistance : currentDistance;
+            const float t = insideDistance / (insideDistance - outsideDistance);
+
+            ClipVertex<N>& rOutput = pOutput[outputCount++];
+            rOutput.position = glm::mix(rInside.position, rOutside.position, t);
+            for (uint32_t j = 0; j < N; j++)
+            {
+                rOutput.varyings[j] = glm::mix(rInside.varyings[j], rOutside.varyings[j], t);
+            }
+        }
+    }
+    return outputCount;
+}
+
+
+// Fragments with less alpha than this are discarded.
+static const float ALPHA_TEST_REFERENCE = 0.5f;
+
+
+// Raster state, as the template argument of the per-pixel loops.
+static const uint32_t PIXEL_DEPTH_TEST = 1 << 0;
+static const uint32_t PIXEL_DEPTH_WRITE = 1 << 1;
+static const uint32_t PIXEL_COLOR_WRITE = 1 << 2;
+static const uint32_t PIXEL_TEXTURED = 1 << 3;
+static const uint32_t PIXEL_ALPHA_TEST = 1 << 4;
+static const uint32_t PIXEL_VERTEX_COLOR = 1 << 5;
+static const uint32_t PIXEL_MODULATE = 1 << 6;
+static const uint32_t PIXEL_REPLACE = 1 << 7;
+static const uint32_t PIXEL_DEFERRED = 1 << 8;   // ShadingMode::VisibilityBuffer
+static const uint32_t PIXEL_STATE_COUNT = 1 << 9;
+
+// Not a state: there is nothing for that loop to do.
+static const uint32_t PIXEL_NO_LOOP = PIXEL_STATE_COUNT;
+
+
+// Clears the bits which make no difference, given the others.
+static constexpr uint32_t CanonicalPixelState(uint32_t state)
+{
+    if (state & PIXEL_DEFERRED)
+    {
+        state |= PIXEL_DEPTH_TEST | PIXEL_DEPTH_WRITE | PIXEL_COLOR_WRITE;
+    }
+    if ((state & PIXEL_TEXTURED) == 0)
+    {
+        state &= ~(PIXEL_ALPHA_TEST | PIXEL_MODULATE | PIXEL_REPLACE);
+    }
+    if (state & PIXEL_REPLACE)
+    {
+        state &= ~(PIXEL_MODULATE | PIXEL_VERTEX_COLOR);
+    }
+    if ((state & PIXEL_COLOR_WRITE) == 0)
+    {
+        state &= ~(PIXEL_VERTEX_COLOR | PIXEL_MODULATE | PIXEL_REPLACE);
+        if ((state & PIXEL_ALPHA_TEST) == 0)
+        {
+            state &= ~PIXEL_TEXTURED;
+        }
+    }
+    return state;
+}
+
+// What RasterizeTriangle is built for: the depth test and
+// write, and whether the alpha test decides the write.
+static constexpr uint32_t RasterPixelState(uint32_t state)
+{
+    return CanonicalPixelState(state) & (PIXEL_DEPTH_TEST | PIXEL_DEPTH_WRITE | PIXEL_ALPHA_TEST | PIXEL_DEFERRED);
+}
+
+// What ShadeQuads is built for while rasterizing. Deferred or depth-only
+// pixels are only shaded this early for the alpha test.
+static constexpr uint32_t ShadePixelState(uint32_t state)
+{
+    state = CanonicalPixelState(state);
+    const uint32_t alphaTest = state & PIXEL_ALPHA_TEST ? state & (PIXEL_TEXTURED | PIXEL_ALPHA_TEST | PIXEL_DEPTH_WRITE | PIXEL_DEFERRED) : 0;
+    if ((state & PIXEL_DEFERRED) || (state & PIXEL_COLOR_WRITE) == 0)
+    {
+        return alphaTest != 0 ? alphaTest : PIXEL_NO_LOOP;
+    }
+    return alphaTest | (state & (PIXEL_COLOR_WRITE | PIXEL_TEXTURED | PIXEL_VERTEX_COLOR | PIXEL_MODULATE | PIXEL_REPLACE));
+}
+
+// What ShadeQuads is built for when resolving the visibility buffer.
+static constexpr uint32_t ResolvePixelState(uint32_t state)
+{
+    state = CanonicalPixelState(state);
+    if ((state & PIXEL_DEFERRED) == 0)
+    {
+        return PIXEL_NO_LOOP;
+    }
+    return state & (PIXEL_COLOR_WRITE | PIXEL_TEXTURED | PIXEL_VERTEX_COLOR | PIXEL_MODULATE | PIXEL_REPLACE);
+}
+
+// How many versions of a loop all the states need between them.
+static constexpr uint32_t CountPixelLoops(uint32_t (*pLoopState)(uint32_t))
+{
+    bool built[PIXEL_STATE_COUNT] = {};
+    uint32_t count = 0;
+    for (uint32_t state = 0; state < PIXEL_STATE_COUNT; state++)
+    {
+        const uint32_t loopState = pLoopState(state);
+        if (loopState != PIXEL_NO_LOOP && ! built[loopState])
+        {
+            built[loopState] = true;
+            count++;
+        }
+    }
+    return count;
+}
+
+// RasterizeTriangle: each depth test and write, with and without the
+// alpha test, plus the two ways of filling the visibility buffer. For
+// both kinds of edges.
+static_assert(CountPixelLoops(RasterPixelState) == 10, "Unexpected number of raster loops");
+
+// ShadeQuads: untextured (2 color sources), textured (mix, modulate or
+// replace, and the color sources of the first two), those 5 again with
+// the alpha test, with and without a depth write, the alpha test alone
+// for depth-only draws (2) and for the visibility buffer (1), and the 7
+// without the alpha test once more to resolve it.
+static_assert(CountPixelLoops(ShadePixelState) == 20, "Unexpected number of shading loops");
+static_assert(CountPixelLoops(ResolvePixelState) == 7, "Unexpected number of resolve loops");
+
+
+// Sets count 32 bit values, four at a time where possible.
+static void Fill32(void* pDestination, uint32_t count, uint32_t value)
+{
+    uint8_t* pBytes = static_cast<uint8_t*>(pDestination);
+    uint32_t i = 0;
+#if defined(__SSE2__)
+    const __m128i values = _mm_set1_epi32(static_cast<int32_t>(value));
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pBytes + i * 4), values);
+    }
+#endif
+    for (; i < count; i++)
+    {
+        memcpy(pBytes + i * 4, &value, 4);
+    }
+}
+
+
+// Sets count values of size bytes each, doubling what is already set
+// every time, so that any size of value is copied in large runs.
+static void FillValues(void* pDestination, uint32_t count, const uint8_t* pValue, uint32_t size)
+{
+    if (size == 4)
+    {
+        uint32_t value;
+        memcpy(&value, pValue, sizeof(value));
+        Fill32(pDestination, count, value);
+        return;
+    }
+
+    uint8_t* pBytes = static_cast<uint8_t*>(pDestination);
+    const size_t total = static_cast<size_t>(count) * size;
+    size_t filled = std::min<size_t>(size, total);
+    memcpy(pBytes, pValue, filled);
+    while (filled < total)
+    {
+        const size_t length = std::min(filled, total - filled);
+        memcpy(pBytes + filled, pBytes, length);
+        filled += length;
+    }
+}
+
+
+// How each DepthFormat stores a depth, which is given as w. A depth which is
+// nearer is never stored as one which is farther. Decode gives back the w of
+// a stored depth, which is stored the same way again, so that the
+// hierarchical depth buffer can stay in w for every format.
+template <DepthFormat Format>
+struct DepthCodec;
+
+template <>
+struct DepthCodec<DepthFormat::Float32>
+{
+    typedef float Value;
+    static constexpr uint32_t SIZE = 4;
+
+    static float GetScale(float)
+    {
+        return 1.0f;
+    }
+
+    static Value Encode(float w, float)
+    {
+        return w;
+    }
+
+    static float Decode(Value depth, float)
+    {
+        return depth;
+    }
+
+    static bool IsNearer(Value a, Value b)
+    {
+        return a < b;
+    }
+
+    static Value Load(const uint8_t* pDepth)
+    {
+        Value depth;
+        memcpy(&depth, pDepth, sizeof(depth));
+        return depth;
+    }
+
+    static void Store(uint8_t* pDepth, Value depth)
+    {
+        memcpy(pDepth, &depth, sizeof(depth));
+    }
+};
+
+// Reversed 1/w, as scale / w rounded to the nearest integer up to Maximum,
+// where scale is depthNear * Maximum. Past 16 bits, a float can't divide
+// exactly enough for Decode to give back the same depth.
+template <uint32_t Maximum>
+struct ReversedDepthCodec
+{
+    typedef uint32_t Value;
+    typedef typename std::conditional<(Maximum > 0xffff), double, float>::type Real;
+
+    static float GetScale(float depthNear)
+    {
+        return depthNear * static_cast<float>(Maximum);
+    }
+
+    static Value Encode(float w, float scale)
+    {
+        const Real depth = static_cast<Real>(scale) / static_cast<Real>(w);
+        return depth < static_cast<Real>(Maximum) ? static_cast<Value>(depth + static_cast<Real>(0.5)) : Maximum;
+    }
+
+    static float Decode(Value depth, float scale)
+    {
+        if (depth == 0)
+        {
+            return std::numeric_limits<float>::infinity();
+        }
+        return static_cast<float>(static_cast<Real>(scale) / static_cast<Real>(depth));
+    }
+
+    static bool IsNearer(Value a, Value b)
+    {
+        return a > b;
+    }
+};
+
+template <>
+struct DepthCodec<DepthFormat::Unorm16> : ReversedDepthCodec<0xffff>
+{
+    static constexpr uint32_t SIZE = 2;
+
+    static Value Load(const uint8_t* pDepth)
+    {
+        uint16_t depth;
+        memcpy(&depth, pDepth, sizeof(depth));
+        return depth;
+    }
+
+    static void Store(uint8_t* pDepth, Value depth)
+    {
+        const uint16_t value = static_cast<uint16_t>(depth);
+        memcpy(pDepth, &value, sizeof(value));
+    }
+};
+
+template <>
+struct DepthCodec<DepthFormat::Unorm24> : ReversedDepthCodec<0xffffff>
+{
+    static constexpr uint32_t SIZE = 3;
+
+    static Value Load(const uint8_t* pDepth)
+    {
+        return pDepth[0] | (pDepth[1] << 8) | (pDepth[2] << 16);
+    }
+
+    static void Store(uint8_t* pDepth, Value depth)
+    {
+        pDepth[0] = depth & 0xff;
+        pDepth[1] = (depth >> 8) & 0xff;
+        pDepth[2] = (depth >> 16) & 0xff;
+    }
+};
+
+
+// Calls function with the DepthCodec for the format, so that
+// the format is picked once, outside of any loop in function.
+template <typename Function>
+static decltype(auto) WithDepthCodec(DepthFormat format, Function&& function)
+{
+    switch (format)
+    {
+    case DepthFormat::Unorm16:
+        return function(DepthCodec<DepthFormat::Unorm16> {});
+    case DepthFormat::Unorm24:
+        return function(DepthCodec<DepthFormat::Unorm24> {});
+    case DepthFormat::Float32:
+    default:
+        return function(DepthCodec<DepthFormat::Float32> {});
+    }
+}
+
+
+static uint32_t ResolveThreadCount(uint32_t requested)
+{
+    if (requested != 0)
+    {
+        return requested;
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+
+SoftwareRenderer::SoftwareRenderer(uint32_t frameWidth, uint32_t frameHeight, const RendererOptions& options) :
+    m_FrameWidth { frameWidth },
+    m_FrameHeight { frameHeight },
+    m_RasterMode { options.rasterMode },
+    m_SubpixelBits { static_cast<int>(options.subpixelBits) },
+    m_ShadingMode { options.shadingMode },
+    m_ColorFormat { options.colorFormat },
+    m_ColorSize { GetTexelSize(options.colorFormat) },
+    m_SwapChain {},
+    m_BackBufferIndex { 0 },
+    m_pFramebuffer { nullptr },
+    m_DisplayBuffers {},
+    m_pPresenter {},
+    m_PresentWaitMilliseconds { 0.0 },
+    m_DepthFormat { options.depthFormat },
+    m_DepthSize { WithDepthCodec(options.depthFormat, [](auto codec) { return codec.SIZE; }) },
+    m_DepthScale { WithDepthCodec(options.depthFormat, [&options](auto codec) { return codec.GetScale(options.depthNear); }) },
+    m_DepthBuffer {},
+    m_BlocksWide { (frameWidth + BLOCK_SIZE - 1) / BLOCK_SIZE },
+    m_BlocksHigh { (frameHeight + BLOCK_SIZE - 1) / BLOCK_SIZE },
+    m_HiZBuffer {},
+    m_VisibilityBuffer {},
+    m_TilesWide { (frameWidth + TILE_SIZE - 1) / TILE_SIZE },
+    m_TilesHigh { (frameHeight + TILE_SIZE - 1) / TILE_SIZE },
+    m_FrameArena {},
+    m_BinnedTriangles {},
+    m_TileBins {},
+    m_LazyClears { options.lazyClears },
+    m_PendingClears {},
+    m_ClearColor { 0, 0, 0, 0xff },
+    m_ClearDepth { std::numeric_limits<float>::infinity() },
+    m_ThreadPool { ResolveThreadCount(options.threadCount) },
+    m_RasterRow { GetRasterKernel().function },
+    m_ThreadRasterStats {},
+    m_ThreadPipelineStats {},
+    m_PipelineStats {},
+    m_FrameTriangleCount { 0 },
+    m_TransformPositions { GetTransformKernel().function },
+    m_DrawArena {},
+    m_pClipPositions {},
+    m_pClipOutcodes { nullptr },
+    m_pTransformedBatches { nullptr },
+    m_DrawInsideFrustum { false },
+    m_VertexCacheStats {},
+    m_Textures {},
+    m_ActiveTextureID {0},
+    m_Samplers {},
+    m_ActiveSampler {},
+    m_ProjectionMatrix { 1.0 },
+    m_ViewModelMatrix { 1.0 },
+    m_FrontFace { FrontFace::Clockwise },
+    m_CullMode { CullMode::Back },
+    m_DepthTest { true },
+    m_DepthWrite { true },
+    m_ColorWrite { true },
+    m_ColorSource { ColorSource::DebugColor },
+    m_BlendMode { BlendMode::Mix },
+    m_pDrawPipeline { nullptr },
+    m_DrawSampleQuad { nullptr },
+    m_SubmitKeys {}
+{
+    assert(options.subpixelBits <= 8);
+    assert(options.swapChainLength >= 1);
+    assert(options.depthNear > 0.0f);
+
+    m_SwapChain.resize(options.swapChainLength);
+    for (auto& rBuffer : m_SwapChain)
+    {
+        rBuffer.resize(m_FrameWidth * m_FrameHeight * m_ColorSize);
+    }
+    m_pFramebuffer = &m_SwapChain[0][0];
+    if (m_ColorFormat != TextureFormat::RGBA8)
+    {
+        m_DisplayBuffers.resize(options.swapChainLength);
+        for (auto& rBuffer : m_DisplayBuffers)
+        {
+            rBuffer.resize(m_FrameWidth * m_FrameHeight * 4);
+        }
+    }
+    m_DepthBuffer.resize(m_FrameWidth * m_FrameHeight * m_DepthSize);
+    m_HiZBuffer.resize(m_BlocksWide * m_BlocksHigh);
+    if (m_ShadingMode == ShadingMode::VisibilityBuffer)
+    {
+        m_VisibilityBuffer.resize(m_FrameWidth * m_FrameHeight, 0);
+    }
+    m_TileBins.resize(m_TilesWide * m_TilesHigh);
+    m_PendingClears.resize(m_TilesWide * m_TilesHigh, ClearFlags::None);
+    m_ThreadRasterStats.resize(m_ThreadPool.GetThreadCount());
+    m_ThreadPipelineStats.resize(m_ThreadPool.GetThreadCount());
+}
+
+
+void SoftwareRenderer::Clear(uint8_t r, uint8_t g, uint8_t b)
+{
+    Clear(ClearFlags::All, r, g, b);
+}
+
+
+void SoftwareRenderer::Clear(ClearFlags flags, uint8_t r, uint8_t g, uint8_t b, float depth)
+{
+    // Anything still binned would be cleared over anyway,
+    // unless some of what it drew is being kept.
+    if (flags == ClearFlags::All)
+    {
+        DiscardBins();
+    }
+    else
+    {
+        Flush();
+    }
+    for (auto& rStats : m_ThreadRasterStats)
+    {
+        rStats = {};
+    }
+    for (auto& rStats : m_ThreadPipelineStats)
+    {
+        rStats = {};
+    }
+    m_PipelineStats = {};
+    m_VertexCacheStats = {};
+    m_FrameTriangleCount = 0;
+    StageTimer timer { m_PipelineStats.clearNanoseconds };
+
+    if ((flags & ClearFlags::Color) != ClearFlags::None)
+    {
+        m_ClearColor[0] = b;
+        m_ClearColor[1] = g;
+        m_ClearColor[2] = r;
+        m_ClearColor[3] = 0xff;
+    }
+    if ((flags & ClearFlags::Depth) != ClearFlags::None)
+    {
+        m_ClearDepth = depth;
+    }
+    if (m_LazyClears)
+    {
+        for (auto& rPending : m_PendingClears)
+        {
+            rPending = rPending | flags;
+        }
+    }
+    else
+    {
+        // A row of tiles at a time, which is one run of memory.
+        m_ThreadPool.ParallelFor(m_TilesHigh, [this, flags](uint32_t tileY, uint32_t) {
+            const uint32_t y = tileY * TILE_SIZE;
+            ClearRect(flags, 0, y, m_FrameWidth, std::min(TILE_SIZE, m_FrameHeight - y));
+        });
+    }
+}
+
+
+void SoftwareRenderer::SetProjectionMatrix(const glm::mat4& value)
+{
+    m_ProjectionMatrix = value;
+}
+
+void SoftwareRenderer::SetViewModelMatrix(const glm::mat4& value)
+{
+    m_ViewModelMatrix = value;
+}
+
+void SoftwareRenderer::SetFrontFace(FrontFace value)
+{
+    m_FrontFace = value;
+}
+
+void SoftwareRenderer::SetCullMode(CullMode value)
+{
+    m_CullMode = value;
+}
+
+// The visibility buffer keeps the nearest triangle at every pixel and
+// shades it, so it can't do without any of these.
+bool SoftwareRenderer::SetDepthTest(bool value)
+{
+    if ( ! value && m_ShadingMode != ShadingMode::Forward)
+    {
+        return false;
+    }
+    m_DepthTest = value;
+    return true;
+}
+
+bool SoftwareRenderer::SetDepthWrite(bool value)
+{
+    if ( ! value && m_ShadingMode != ShadingMode::Forward)
+    {
+        return false;
+    }
+    m_DepthWrite = value;
+    return true;
+}
+
+bool SoftwareRenderer::SetColorWrite(bool value)
+{
+    if ( ! value && m_ShadingMode != ShadingMode::Forward)
+    {
+        return false;
+    }
+    m_ColorWrite = value;
+    return true;
+}
+
+void SoftwareRenderer::SetColorSource(ColorSource value)
+{
+    m_ColorSource = value;
+}
+
+void SoftwareRenderer::SetBlendMode(BlendMode value)
+{
+    m_BlendMode = value;
+}
+
+
+uint32_t SoftwareRenderer::CreateTexture()
+{
+    // Binned triangles look up their texture when they are rasterized,
+    // so let them finish before touching any texture storage.
+    Flush();
+    m_Textures.push_back({0, 0, TextureFormat::RGBA8, TextureLayout::Linear, 0, {}, 1.0f, {}});
+    return m_Textures.size();
+}
+
+void SoftwareRenderer::UpdateTexture(
+    uint32_t id, uint32_t width, uint32_t height, const uint8_t* pData,
+    TextureFormat format, TextureLayout layout, bool buildMipChain
+)
+{
+    Flush();
+    auto& rTexture = m_Textures[id - 1];
+    rTexture.format = format;
+    rTexture.layout = layout;
+    StoreTexels(rTexture, width, height, pData, buildMipChain);
+}
+
+void SoftwareRenderer::DestroyTexture(uint32_t id)
+{
+    Flush();
+    auto& rTexture = m_Textures[id - 1];
+    rTexture.width = 0;
+    rTexture.height = 0;
+    rTexture.levelCount = 0;
+    rTexture.data.resize(0);
+}
+
+void SoftwareRenderer::UseTexture(uint32_t id)
+{
+    m_ActiveTextureID = id;
+}
+
+uint32_t SoftwareRenderer::CreateSampler(const SamplerState& state)
+{
+    m_Samplers.push_back(state);
+    return m_Samplers.size();
+}
+
+void SoftwareRenderer::UseSampler(uint32_t id)
+{
+    // Triangles take a copy when they are drawn, and
+    // samplers can't change, so there's no need to Flush.
+    m_ActiveSampler = id == 0 ? SamplerState {} : m_Samplers[id - 1];
+}
+
+Texture& SoftwareRenderer::GetTexture(uint32_t id)
+{
+    return m_Textures[id - 1];
+}
+
+
+void SoftwareRenderer::DrawTriangleList(const std::vector<Vertex>& vertices)
+{
+    DrawTriangles(ConvertVertices(vertices));
+}
+
+
+void SoftwareRenderer::DrawTriangleList(const VertexBuffer& vertices)
+{
+    DrawTriangles(vertices.GetStreams());
+}
+
+
+void SoftwareRenderer::DrawTriangles(const VertexStreams& vertices)
+{
+    StageTimer timer { m_PipelineStats.geometryNanoseconds };
+    SelectPixelPipeline();
+
+    // Model Space -> World Space -> Camera Space -> [Clip Space] -> NDC Space -> Raster Space
+    const glm::mat4 transformMatrix = m_ProjectionMatrix * m_ViewModelMatrix;
+    PrepareVertexCache(vertices);
+    TransformBatches(vertices, transformMatrix, 0, vertices.GetBatchCount());
+
+    for (uint32_t i = 0; i + 2 < vertices.vertexCount; i += 3)
+    {
+        AssembleTriangle(vertices, i + 0, i + 1, i + 2);
+    }
+
+    m_DrawArena.Reset();
+}
+
+
+// Copies an array of Vertex structures into streams in the draw arena.
+VertexStreams SoftwareRenderer::ConvertVertices(const std::vector<Vertex>& vertices)
+{
+    VertexStreams streams {};
+    streams.varyingCount = VERTEX_VARYING_COUNT;
+    streams.vertexCount = vertices.size();
+
+    const uint32_t paddedCount = streams.GetBatchCount() * VERTEX_BATCH_SIZE;
+    auto allocateStream = [this, paddedCount]() {
+        return static_cast<float*>(m_DrawArena.Allocate(paddedCount * sizeof(float), VERTEX_STREAM_ALIGNMENT));
+    };
+    float* pPositions[VERTEX_POSITION_STREAMS];
+    for (uint32_t i = 0; i < VERTEX_POSITION_STREAMS; i++)
+    {
+        pPositions[i] = allocateStream();
+        streams.pPositions[i] = pPositions[i];
+    }
+    float* pVaryings[VERTEX_VARYING_COUNT];
+    for (uint32_t i = 0; i < VERTEX_VARYING_COUNT; i++)
+    {
+        pVaryings[i] = allocateStream();
+        streams.pVaryings[i] = pVaryings[i];
+    }
+
+    for (uint32_t i = 0; i < paddedCount; i++)
+    {
+        // Padding is a valid point, just in case.
+        const Vertex vertex = i < vertices.size() ? vertices[i] : Vertex { glm::vec4 { 0.0f, 0.0f, 0.0f, 1.0f }, {}, {} };
+        pPositions[static_cast<uint32_t>(VertexStream::PositionX)][i] = vertex.position.x;
+        pPositions[static_cast<uint32_t>(VertexStream::PositionY)][i] = vertex.position.y;
+        pPositions[static_cast<uint32_t>(VertexStream::PositionZ)][i] = vertex.position.z;
+        pPositions[static_cast<uint32_t>(VertexStream::PositionW)][i] = vertex.position.w;
+        pVaryings[static_cast<uint32_t>(VertexVarying::ColorR)][i] = vertex.color.r;
+        pVaryings[static_cast<uint32_t>(VertexVarying::ColorG)][i] = vertex.color.g;
+        pVaryings[static_cast<uint32_t>(VertexVarying::ColorB)][i] = vertex.color.b;
+        pVaryings[static_cast<uint32_t>(VertexVarying::TexcoordU)][i] = vertex.texcoords.x;
+        pVaryings[static_cast<uint32_t>(VertexVarying::TexcoordV)][i] = vertex.texcoords.y;
+    }
+
+    return streams;
+}
+
+
+// Draws a triangle which crosses the near or far plane, or the edge
+// of the guard band, as the fan of triangles left after clipping it.
+// Returns how many triangles that was.
+template <uint32_t N>
+uint32_t SoftwareRenderer::ClipTriangle(const ClipVertex<N>& v0, const ClipVertex<N>& v1, const ClipVertex<N>& v2, uint8_t outcodes)
+{
+    // Each plane can add at most one vertex to the polygon.
+    ClipVertex<N> polygons[2][3 + CLIP_PLANE_COUNT];
+    polygons[0][0] = v0;
+    polygons[0][1] = v1;
+    polygons[0][2] = v2;
+    uint32_t vertexCount = 3;
+    uint32_t current = 0;
+
+    auto clipTo = [&](ClipPlane plane) {
+        vertexCount = ClipPolygon(plane, polygons[current], vertexCount, polygons[1 - current]);
+        current = 1 - current;
+    };
+
+    // Near first, so that every other plane sees positive w.
+    if (outcodes & OUTCODE_NEAR)
+    {
+        clipTo(ClipPlane::Near);
+    }
+    if (outcodes & OUTCODE_FAR)
+    {
+        clipTo(ClipPlane::Far);
+    }
+    if (outcodes & OUTCODE_GUARD_BAND_X)
+    {
+        clipTo(ClipPlane::GuardBandPositiveX);
+        clipTo(ClipPlane::GuardBandNegativeX);
+    }
+    if (outcodes & OUTCODE_GUARD_BAND_Y)
+    {
+        clipTo(ClipPlane::GuardBandPositiveY);
+        clipTo(ClipPlane::GuardBandNegativeY);
+    }
+
+    const ClipVertex<N>* pPolygon = polygons[current];
+    for (uint32_t i = 1; i + 1 < vertexCount; i++)
+    {
+        ClipVertex<N> fan0 = pPolygon[0];
+        ClipVertex<N> fan1 = pPolygon[i];
+        ClipVertex<N> fan2 = pPolygon[i + 1];
+        RenderTriangle(fan0, fan1, fan2);
+    }
+    return vertexCount < 3 ? 0 : vertexCount - 2;
+}
+
+
+void SoftwareRenderer::DrawIndexedTriangles(const std::vector<Vertex>& vertices, const std::vector<uint16_t>& indices)
+{
+    DrawIndexed(ConvertVertices(vertices), indices);
+}
+
+void SoftwareRenderer::DrawIndexedTriangles(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+    DrawIndexed(ConvertVertices(vertices), indices);
+}
+
+void SoftwareRenderer::DrawIndexedTriangles(const VertexBuffer& vertices, const std::vector<uint16_t>& indices)
+{
+    DrawIndexed(vertices.GetStreams(), indices);
+}
+
+void SoftwareRenderer::DrawIndexedTriangles(const VertexBuffer& vertices, const std::vector<uint32_t>& indices)
+{
+    DrawIndexed(vertices.GetStreams(), indices);
+}
+
+
+void SoftwareRenderer::Submit(const CommandBuffer& commands, const SubmitOptions& options)
+{
+    const std::vector<DrawCommand>& draws = commands.GetDraws();
+
+    m_SubmitKeys.clear();
+    for (uint32_t i = 0; i < draws.size(); i++)
+    {
+        const DrawCommand& draw = draws[i];
+        SubmitKey key { false, 0, 0, 0.0f, i };
+        if (options.sortFrontToBack)
+        {
+            // Textures can change between submits, so this can't be recorded.
+            key.alphaTest = draw.textureID != 0 && GetTexture(draw.textureID).minAlpha < ALPHA_TEST_REFERENCE;
+            key.depth = -(options.viewMatrix * draw.viewModelMatrix * glm::vec4 { draw.center, 1.0f }).z;
+        }
+        if (options.groupByTexture)
+        {
+            key.textureID = draw.textureID;
+            key.samplerID = draw.samplerID;
+        }
+        m_SubmitKeys.push_back(key);
+    }
+
+    // Ties keep the order they were recorded in.
+    if (options.sortFrontToBack || options.groupByTexture)
+    {
+        std::sort(m_SubmitKeys.begin(), m_SubmitKeys.end(), [](const SubmitKey& a, const SubmitKey& b) {
+            if (a.alphaTest != b.alphaTest)
+            {
+                return b.alphaTest;
+            }
+            if (a.textureID != b.textureID)
+            {
+                return a.textureID < b.textureID;
+            }
+            if (a.samplerID != b.samplerID)
+            {
+                return a.samplerID < b.samplerID;
+            }
+            if (a.depth < b.depth || b.depth < a.depth)
+            {
+                return a.depth < b.depth;
+            }
+            return a.drawIndex < b.drawIndex;
+        });
+    }
+
+    const glm::mat4 projectionMatrix = m_ProjectionMatrix;
+    const glm::mat4 viewModelMatrix = m_ViewModelMatrix;
+    const uint32_t textureID = m_ActiveTextureID;
+    const SamplerState sampler = m_ActiveSampler;
+    const FrontFace frontFace = m_FrontFace;
+    const CullMode cullMode = m_CullMode;
+    const bool depthTest = m_DepthTest;
+    const bool depthWrite = m_DepthWrite;
+    const bool colorWrite = m_ColorWrite;
+    const ColorSource colorSource = m_ColorSource;
+    const BlendMode blendMode = m_BlendMode;
+
+    for (const SubmitKey& key : m_SubmitKeys)
+    {
+        const DrawCommand& draw = draws[key.drawIndex];
+        m_ProjectionMatrix = draw.projectionMatrix;
+        m_ViewModelMatrix = options.viewMatrix * draw.viewModelMatrix;
+        UseTexture(draw.textureID);
+        UseSampler(draw.samplerID);
+        m_FrontFace = draw.frontFace;
+        m_CullMode = draw.cullMode;
+        SetDepthTest(draw.depthTest);
+        SetDepthWrite(draw.depthWrite);
+        SetColorWrite(draw.colorWrite);
+        m_ColorSource = draw.colorSource;
+        m_BlendMode = draw.blendMode;
+        m_DrawInsideFrustum = draw.insideFrustum;
+
+        switch (draw.type)
+        {
+            case DrawType::TriangleList:
+                DrawTriangles(draw.pVertices->GetStreams());
+                break;
+            case DrawType::Indexed16:
+                DrawIndexed(draw.pVertices->GetStreams(), *draw.pIndices16);
+                break;
+            case DrawType::Indexed32:
+                DrawIndexed(draw.pVertices->GetStreams(), *draw.pIndices32);
+                break;
+        }
+    }
+
+    m_ProjectionMatrix = projectionMatrix;
+    m_ViewModelMatrix = viewModelMatrix;
+    m_ActiveTextureID = textureID;
+    m_ActiveSampler = sampler;
+    m_FrontFace = frontFace;
+    m_CullMode = cullMode;
+    m_DepthTest = depthTest;
+    m_DepthWrite = depthWrite;
+    m_ColorWrite = colorWrite;
+    m_ColorSource = colorSource;
+    m_BlendMode = blendMode;
+    m_DrawInsideFrustum = false;
+}
+
+
+template <typename Index>
+void SoftwareRenderer::DrawIndexed(const VertexStreams& vertices, const std::vector<Index>& indices)
+{
+    assert(indices.size() % 3 == 0);
+    StageTimer timer { m_PipelineStats.geometryNanoseconds };
+    SelectPixelPipeline();
+
+    const glm::mat4 transformMatrix = m_ProjectionMatrix * m_ViewModelMatrix;
+    PrepareVertexCache(vertices);
+
+    // The first reference to a vertex transforms its whole batch.
+    auto fetchVertex = [&](Index index) {
+        assert(index < vertices.vertexCount);
+        const uint32_t batch = index / VERTEX_BATCH_SIZE;
+        if (m_pTransformedBatches[batch])
+        {
+            m_VertexCacheStats.hits++;
+        }
+        else
+        {
+            m_VertexCacheStats.misses++;
+            TransformBatches(vertices, transformMatrix, batch, 1);
+        }
+    };
+
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        fetchVertex(indices[i + 0]);
+        fetchVertex(indices[i + 1]);
+        fetchVertex(indices[i + 2]);
+        AssembleTriangle(vertices, indices[i + 0], indices[i + 1], indices[i + 2]);
+    }
+
+    m_DrawArena.Reset();
+}
+
+
+void SoftwareRenderer::DrawTriangleListInstanced(const VertexBuffer& vertices, const std::vector<glm::mat4>& instanceMatrices)
+{
+    const VertexStreams streams = vertices.GetStreams();
+    DrawInstances(streams, instanceMatrices, [this, &streams]() {
+        for (uint32_t i = 0; i + 2 < streams.vertexCount; i += 3)
+        {
+            AssembleTriangle(streams, i + 0, i + 1, i + 2);
+        }
+    });
+}
+
+void SoftwareRenderer::DrawIndexedTrianglesInstanced(const VertexBuffer& vertices, const std::vector<uint16_t>& indices, const std::vector<glm::mat4>& instanceMatrices)
+{
+    assert(indices.size() % 3 == 0);
+    const VertexStreams streams = vertices.GetStreams();
+    DrawInstances(streams, instanceMatrices, [this, &streams, &indices]() {
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            AssembleTriangle(streams, indices[i + 0], indices[i + 1], indices[i + 2]);
+        }
+    });
+}
+
+void SoftwareRenderer::DrawIndexedTrianglesInstanced(const VertexBuffer& vertices, const std::vector<uint32_t>& indices, const std::vector<glm::mat4>& instanceMatrices)
+{
+    assert(indices.size() % 3 == 0);
+    const VertexStreams streams = vertices.GetStreams();
+    DrawInstances(streams, instanceMatrices, [this, &streams, &indices]() {
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            AssembleTriangle(streams, indices[i + 0], indices[i + 1], indices[i + 2]);
+        }
+    });
+}
+
+
+// Transforms a group of instances at once, spread over the thread pool, and
+// then puts each one's triangles together in order, with the vertex cache
+// pointed at that instance's clip space vertices.
+template <typename AssembleFunction>
+void SoftwareRenderer::DrawInstances(const VertexStreams& vertices, const std::vector<glm::mat4>& instanceMatrices, const AssembleFunction& assemble)
+{
+    StageTimer timer { m_PipelineStats.geometryNanoseconds };
+    SelectPixelPipeline();
+
+    const uint32_t paddedCount = vertices.GetBatchCount() * VERTEX_BATCH_SIZE;
+    const uint32_t instanceCount = instanceMatrices.size();
+    if (paddedCount == 0 || instanceCount == 0)
+    {
+        return;
+    }
+
+    // What the transform tasks need, behind one pointer, so
+    // that they fit in a TaskFunction without allocating.
+    struct InstanceGroup
+    {
+        const VertexStreams* pVertices;
+        const glm::mat4* pInstanceMatrices;
+        uint32_t paddedCount;
+        float* pPositions[4];
+        uint8_t* pOutcodes;
+    };
+    const uint32_t groupSize = std::min(instanceCount, std::max(1u, INSTANCE_GROUP_VERTICES / paddedCount));
+    InstanceGroup group { &vertices, nullptr, paddedCount, {}, m_DrawArena.Allocate<uint8_t>(groupSize * paddedCount) };
+    for (auto& rpStream : group.pPositions)
+    {
+        rpStream = static_cast<float*>(m_DrawArena.Allocate(groupSize * paddedCount * sizeof(float), VERTEX_STREAM_ALIGNMENT));
+    }
+
+    for (uint32_t groupStart = 0; groupStart < instanceCount; groupStart += groupSize)
+    {
+        // Multiplied the same way as a separate draw's matrices would be.
+        const uint32_t groupCount = std::min(groupSize, instanceCount - groupStart);
+        group.pInstanceMatrices = &instanceMatrices[groupStart];
+        m_ThreadPool.ParallelFor(groupCount, [this, &group](uint32_t i, uint32_t) {
+            const glm::mat4 transformMatrix = m_ProjectionMatrix * (m_ViewModelMatrix * group.pInstanceMatrices[i]);
+            const uint32_t offset = i * group.paddedCount;
+            float* const pClipPositions[4] = {
+                group.pPositions[0] + offset,
+                group.pPositions[1] + offset,
+                group.pPositions[2] + offset,
+                group.pPositions[3] + offset,
+            };
+            TransformVertices(*group.pVertices, transformMatrix, 0, group.paddedCount, pClipPositions, group.pOutcodes + offset);
+        });
+        if (PIPELINE_STATS_ENABLED)
+        {
+            m_PipelineStats.verticesTransformed += groupCount * paddedCount;
+        }
+
+        for (uint32_t i = 0; i < groupCount; i++)
+        {
+            for (uint32_t j = 0; j < 4; j++)
+            {
+                m_pClipPositions[j] = group.pPositions[j] + i * paddedCount;
+            }
+            m_pClipOutcodes = group.pOutcodes + i * paddedCount;
+            assemble();
+        }
+    }
+
+    m_DrawArena.Reset();
+}
+
+
+// Sets up an empty post-transform cache for a draw, in the draw arena.
+void SoftwareRenderer::PrepareVertexCache(const VertexStreams& vertices)
+{
+    const uint32_t batchCount = vertices.GetBatchCount();
+    const uint32_t paddedCount = batchCount * VERTEX_BATCH_SIZE;
+    for (auto& rpStream : m_pClipPositions)
+    {
+        rpStream = static_cast<float*>(m_DrawArena.Allocate(paddedCount * sizeof(float), VERTEX_STREAM_ALIGNMENT));
+    }
+    m_pClipOutcodes = m_DrawArena.Allocate<uint8_t>(paddedCount);
+    m_pTransformedBatches = m_DrawArena.Allocate<bool>(batchCount);
+    std::fill(m_pTransformedBatches, m_pTransformedBatches + batchCount, false);
+}
+
+
+void SoftwareRenderer::TransformBatches(const VertexStreams& vertices, const glm::mat4& transformMatrix, uint32_t firstBatch, uint32_t batchCount)
+{
+    const uint32_t first = firstBatch * VERTEX_BATCH_SIZE;
+    const uint32_t count = batchCount * VERTEX_BATCH_SIZE;
+    float* const pClipPositions[4] = {
+        m_pClipPositions[0] + first,
+        m_pClipPositions[1] + first,
+        m_pClipPositions[2] + first,
+        m_pClipPositions[3] + first,
+    };
+    TransformVertices(vertices, transformMatrix, first, count, pClipPositions, m_pClipOutcodes + first);
+    if (PIPELINE_STATS_ENABLED)
+    {
+        m_PipelineStats.verticesTransformed += count;
+    }
+
+    std::fill(m_pTransformedBatches + firstBatch, m_pTransformedBatches + firstBatch + batchCount, true);
+}
+
+
+// Transforms count vertices, starting at first, into the given clip space
+// streams, and works out their outcodes. Touches nothing else, so that
+// several can run at once.
+void SoftwareRenderer::TransformVertices(
+    const VertexStreams& vertices, const glm::mat4& transformMatrix, uint32_t first, uint32_t count,
+    float* const pClipPositions[4], uint8_t* pClipOutcodes
+) const
+{
+    const float* const pPositions[4] = {
+        vertices.Get(VertexStream::PositionX) + first,
+        vertices.Get(VertexStream::PositionY) + first,
+        vertices.Get(VertexStream::PositionZ) + first,
+        vertices.Get(VertexStream::PositionW) + first,
+    };
+    m_TransformPositions(transformMatrix, pPositions, pClipPositions, count);
+    if ( ! m_DrawInsideFrustum)
+    {
+        ComputeOutcodes(pClipPositions, pClipOutcodes, count);
+    }
+}
+
+
+// Rejects, renders or clips a triangle of already transformed vertices,
+// and returns how many triangles it was rendered as.
+uint32_t SoftwareRenderer::AssembleTriangle(const VertexStreams& vertices, uint32_t i0, uint32_t i1, uint32_t i2)
+{
+    static const auto functions = MakeAssembleFunctions(std::make_index_sequence<VERTEX_MAX_VARYINGS + 1> {});
+    assert(vertices.varyingCount <= VERTEX_MAX_VARYINGS);
+    return (this->*functions[vertices.varyingCount])(vertices, i0, i1, i2);
+}
+
+
+template <size_t... Counts>
+std::array<SoftwareRenderer::AssembleTriangleFunction, sizeof...(Counts)> SoftwareRenderer::MakeAssembleFunctions(std::index_sequence<Counts...>)
+{
+    return { &SoftwareRenderer::AssembleTriangle<Counts>... };
+}
+
+
+// As above, for vertices with N varyings.
+template <uint32_t N>
+uint32_t SoftwareRenderer::AssembleTriangle(const VertexStreams& vertices, uint32_t i0, uint32_t i1, uint32_t i2)
+{
+    // Draws inside the view volume don't have any outcodes worked out.
+    const uint8_t outcode0 = m_DrawInsideFrustum ? 0 : m_pClipOutcodes[i0];
+    const uint8_t outcode1 = m_DrawInsideFrustum ? 0 : m_pClipOutcodes[i1];
+    const uint8_t outcode2 = m_DrawInsideFrustum ? 0 : m_pClipOutcodes[i2];
+    if (PIPELINE_STATS_ENABLED)
+    {
+        m_PipelineStats.trianglesSubmitted++;
+    }
+
+    // All outside the same plane, so it can't be seen.
+    if ((outcode0 & outcode1 & outcode2 & OUTCODE_REJECT) != 0)
+    {
+        if (PIPELINE_STATS_ENABLED)
+        {
+            m_PipelineStats.trianglesFrustumCulled++;
+        }
+        return 0;
+    }
+
+    if (CullTriangle(i0, i1, i2))
+    {
+        return 0;
+    }
+
+    auto makeClipVertex = [this, &vertices](uint32_t index) {
+        ClipVertex<N> vertex;
+        vertex.position = {
+            m_pClipPositions[0][index],
+            m_pClipPositions[1][index],
+            m_pClipPositions[2][index],
+            m_pClipPositions[3][index],
+        };
+        for (uint32_t i = 0; i < N; i++)
+        {
+            vertex.varyings[i] = vertices.GetVarying(i)[index];
+        }
+        return vertex;
+    };
+
+    ClipVertex<N> v0 = makeClipVertex(i0);
+    ClipVertex<N> v1 = makeClipVertex(i1);
+    ClipVertex<N> v2 = makeClipVertex(i2);
+
+    // Most triangles only cross the sides of the viewport, if anything,
+    // and the rasterizer takes care of those.
+    const uint8_t outcodes = outcode0 | outcode1 | outcode2;
+    if ((outcodes & OUTCODE_CLIP) == 0)
+    {
+        RenderTriangle(v0, v1, v2);
+        return 1;
+    }
+    if (PIPELINE_STATS_ENABLED)
+    {
+        m_PipelineStats.trianglesClipped++;
+    }
+    return ClipTriangle(v0, v1, v2, outcodes);
+}
+
+
+// Throws out triangles that RenderTriangle would, as soon as their
+// vertices are transformed, so that they are never put together or
+// clipped. Only triangles in front of the camera can be projected
+// yet, and the rest are left to RenderTriangle.
+bool SoftwareRenderer::CullTriangle(uint32_t i0, uint32_t i1, uint32_t i2)
+{
+    if (i0 == i1 || i1 == i2 || i2 == i0)
+    {
+        if (PIPELINE_STATS_ENABLED)
+        {
+            m_PipelineStats.trianglesZeroArea++;
+        }
+        return true;
+    }
+
+    // Projected just the way RenderTriangle does it, so that the two agree.
+    const uint32_t indices[3] = { i0, i1, i2 };
+    glm::vec2 positions[3];
+    for (int i = 0; i < 3; i++)
+    {
+        const float w = m_pClipPositions[3][indices[i]];
+        if ( ! (w > 0.0f))
+        {
+            return false;
+        }
+        positions[i] = ViewportTransform(m_pClipPositions[0][indices[i]] / w, m_pClipPositions[1][indices[i]] / w);
+    }
+
+    const float area = EdgeFunction(positions[0], positions[1], positions[2]);
+    if ( ! (std::abs(area) > 0.0f))
+    {
+        if (PIPELINE_STATS_ENABLED)
+        {
+            m_PipelineStats.trianglesZeroArea++;
+        }
+        return true;
+    }
+    if (IsFaceCulled(area))
+    {
+        if (PIPELINE_STATS_ENABLED)
+        {
+            m_PipelineStats.trianglesBackfaceCulled++;
+        }
+        return true;
+    }
+
+    // Pixel centers are at whole coordinates. Snapping can move
+    // each vertex up to half a subpixel either way.
+    const float snap = m_RasterMode == RasterMode::FixedPoint ? 0.5f / static_cast<float>(1 << m_SubpixelBits) : 0.0f;
+    const float xmin = std::min({ positions[0].x, positions[1].x, positions[2].x }) - snap;
+    const float xmax = std::max({ positions[0].x, positions[1].x, positions[2].x }) + snap;
+    const float ymin = std::min({ positions[0].y, positions[1].y, positions[2].y }) - snap;
+    const float ymax = std::max({ positions[0].y, positions[1].y, positions[2].y }) + snap;
+    if (std::ceil(xmin) > std::floor(xmax) || std::ceil(ymin) > std::floor(ymax))
+    {
+        if (PIPELINE_STATS_ENABLED)
+        {
+            m_PipelineStats.trianglesTooSmall++;
+        }
+        return true;
+    }
+    return false;
+}
+
+
+// Takes the raster space area of a triangle, which is positive
+// for clockwise ones, and isn't zero.
+bool SoftwareRenderer::IsFaceCulled(float area) const
+{
+    const bool isFrontFace = (area > 0) == (m_FrontFace == FrontFace::Clockwise);
+    return m_CullMode == (isFrontFace ? CullMode::Front : CullMode::Back);
+}
+
+
+// NDC Space -> Raster Space
+glm::vec2 SoftwareRenderer::ViewportTransform(float x, float y) const
+{
+    return {
+        (1.0f + x) * (m_FrameWidth / 2),
+        (1.0f - y) * (m_FrameHeight / 2),
+    };
+}
+
+
+// Sets up a triangle, assuming that it has already been transformed
+// and clipped into the view port, and bins it into every screen tile
+// that its bounding box touches. It gets drawn on the next Flush.
+template <uint32_t N>
+void SoftwareRenderer::RenderTriangle(ClipVertex<N>& v0, ClipVertex<N>& v1, ClipVertex<N>& v2)
+{
+
+    // Model Space -> World Space -> Camera Space -> Clip Space -> [NDC Space] -> Raster Space
+    auto perspectiveDivide = [](ClipVertex<N>& v) {
+        v.position.x /= v.position.w;
+        v.position.y /= v.position.w;
+        v.position.z /= v.position.w;
+
+        // For perspective correction, since these and 1/w
+        // (but not w itself) are linear in screen space.
+        for (float& rVarying : v.varyings)
+        {
+            rVarying /= v.position.w;
+        }
+    };
+
+    // Model Space -> World Space -> Camera Space -> Clip Space -> NDC Space -> [Raster Space]
+    auto viewportTransform = [this](ClipVertex<N>& v) {
+        const glm::vec2 position = ViewportTransform(v.position.x, v.position.y);
+        v.position.x = position.x;
+        v.position.y = position.y;
+    };
+
+    perspectiveDivide(v0);
+    perspectiveDivide(v1);
+    perspectiveDivide(v2);
+
+    viewportTransform(v0);
+    viewportTransform(v1);
+    viewportTransform(v2);
+
+    const float totalArea = EdgeFunction({v0.position.x, v0.position.y}, {v1.position.x, v1.position.y}, {v2.position.x, v2.position.y});
+    if ( ! (std::abs(totalArea) > 0.0f))
+    {
+        if (PIPELINE_STATS_ENABLED)
+        {
+            m_PipelineStats.trianglesZeroArea++;
+        }
+        return;
+    }
+    if (IsFaceCulled(totalArea))
+    {
+        if (PIPELINE_STATS_ENABLED)
+        {
+            m_PipelineStats.trianglesBackfaceCulled++;
+        }
+        return;
+    }
+    if (totalArea < 0)
+    {
+        // The rasterizer only draws clockwise triangles.
+        std::swap(v1, v2);
+    }
+
+    RasterTriangle triangle { {}, {}, {}, 0, 0, 0, 0, 0, m_ActiveTextureID, m_ActiveSampler, m_DrawSampleQuad, {}, m_pDrawPipeline };
+
+    if (m_RasterMode == RasterMode::FixedPoint)
+    {
+        auto& rEdges = triangle.fixedEdges;
+        if ( ! SetupFixedTriangleEdges(
+            m_SubpixelBits,
+            v0.position.x, v0.position.y,
+            v1.position.x, v1.position.y,
+            v2.position.x, v2.position.y,
+            1.0f / v0.position.w, 1.0f / v1.position.w, 1.0f / v2.position.w,
+            rEdges
+        ))
+        {
+            // Snapped to nothing
+            if (PIPELINE_STATS_ENABLED)
+            {
+                m_PipelineStats.trianglesZeroArea++;
+            }
+            return;
+        }
+
+        const int32_t xmin = std::max(rEdges.xmin, 0);
+        const int32_t xmax = std::min(rEdges.xmax, static_cast<int32_t>(m_FrameWidth) - 1);
+        const int32_t ymin = std::max(rEdges.ymin, 0);
+        const int32_t ymax = std::min(rEdges.ymax, static_cast<int32_t>(m_FrameHeight) - 1);
+        if (xmin > xmax || ymin > ymax)
+        {
+            // Falls between pixels, or off the edge of the frame
+            if (PIPELINE_STATS_ENABLED)
+            {
+                (rEdges.xmin > rEdges.xmax || rEdges.ymin > rEdges.ymax ? m_PipelineStats.trianglesTooSmall : m_PipelineStats.trianglesFrustumCulled)++;
+            }
+            return;
+        }
+        triangle.xmin = xmin;
+        triangle.xmax = xmax;
+        triangle.ymin = ymin;
+        triangle.ymax = ymax;
+    }
+    else
+    {
+        triangle.edges = SetupTriangleEdges(
+            v0.position.x, v0.position.y,
+            v1.position.x, v1.position.y,
+            v2.position.x, v2.position.y,
+            1.0f / v0.position.w, 1.0f / v1.position.w, 1.0f / v2.position.w
+        );
+
+        // Vertices can be anywhere in the guard band,
+        // so the bounds are clamped to the frame.
+        const float xmin = std::round(std::min({v0.position.x, v1.position.x, v2.position.x}));
+        const float xmax = std::round(std::max({v0.position.x, v1.position.x, v2.position.x}));
+        const float ymin = std::round(std::min({v0.position.y, v1.position.y, v2.position.y}));
+        const float ymax = std::round(std::max({v0.position.y, v1.position.y, v2.position.y}));
+        const float lastX = static_cast<float>(m_FrameWidth - 1);
+        const float lastY = static_cast<float>(m_FrameHeight - 1);
+        if (xmax < 0 || ymax < 0 || xmin > lastX || ymin > lastY)
+        {
+            // Off the edge of the frame
+            if (PIPELINE_STATS_ENABLED)
+            {
+                m_PipelineStats.trianglesFrustumCulled++;
+            }
+            return;
+        }
+        triangle.xmin = static_cast<uint32_t>(std::max(xmin, 0.0f));
+        triangle.xmax = static_cast<uint32_t>(std::min(xmax, lastX));
+        triangle.ymin = static_cast<uint32_t>(std::max(ymin, 0.0f));
+        triangle.ymax = static_cast<uint32_t>(std::min(ymax, lastY));
+    }
+
+    // The varyings are planes through the positions the triangle is
+    // rasterized at, which for fixed point are the snapped ones.
+    glm::vec2 positions[3] = {
+        { v0.position.x, v0.position.y },
+        { v1.position.x, v1.position.y },
+        { v2.position.x, v2.position.y },
+    };
+    if (m_RasterMode == RasterMode::FixedPoint)
+    {
+        const float subpixelSize = 1.0f / static_cast<float>(1 << m_SubpixelBits);
+        for (auto& rPosition : positions)
+        {
+            rPosition.x = static_cast<float>(SnapToSubpixel(rPosition.x, m_SubpixelBits)) * subpixelSize;
+            rPosition.y = static_cast<float>(SnapToSubpixel(rPosition.y, m_SubpixelBits)) * subpixelSize;
+        }
+    }
+    const float* const varyings[3] = { v0.varyings.data(), v1.varyings.data(), v2.varyings.data() };
+    SetupAttributePlanes(positions, varyings, N, triangle.varyings);
+
+    // The debug color is picked here, in draw order, rather than when
+    // rasterizing so that it doesn't depend on how tiles get scheduled.
+    switch (m_FrameTriangleCount % 12) {
+        case 0: triangle.debugColor = {1.0, 0.0, 0.0}; break;
+        case 1: triangle.debugColor = {0.0, 1.0, 0.0}; break;
+        case 2: triangle.debugColor = {0.0, 0.0, 1.0}; break;
+        case 3: triangle.debugColor = {1.0, 1.0, 0.0}; break;
+        case 4: triangle.debugColor = {1.0, 0.0, 1.0}; break;
+        case 5: triangle.debugColor = {0.0, 1.0, 1.0}; break;
+        case 6: triangle.debugColor = {0.5, 0.0, 0.0}; break;
+        case 7: triangle.debugColor = {0.0, 0.5, 0.0}; break;
+        case 8: triangle.debugColor = {0.0, 0.0, 0.5}; break;
+        case 9: triangle.debugColor = {0.5, 0.5, 0.0}; break;
+        case 10: triangle.debugColor = {0.5, 0.0, 0.5}; break;
+        case 11: triangle.debugColor = {0.0, 0.5, 0.5}; break;
+    }
+    m_FrameTriangleCount += 1;
+    if (PIPELINE_STATS_ENABLED)
+    {
+        m_PipelineStats.trianglesRasterized++;
+    }
+
+    // Bins keep triangles in draw order, so every pixel sees the
+    // same sequence of writes as it would drawing one at a time.
+    triangle.id = static_cast<uint32_t>(m_BinnedTriangles.size()) + 1;
+    const RasterTriangle* pTriangle = new (m_FrameArena.Allocate<RasterTriangle>(1)) RasterTriangle { triangle };
+    m_BinnedTriangles.push_back(pTriangle);
+    for (uint32_t tileY = triangle.ymin / TILE_SIZE; tileY <= triangle.ymax / TILE_SIZE; tileY++)
+    {
+        for (uint32_t tileX = triangle.xmin / TILE_SIZE; tileX <= triangle.xmax / TILE_SIZE; tileX++)
+        {
+            m_TileBins[tileY * m_TilesWide + tileX].PushBack(m_FrameArena, pTriangle);
+        }
+    }
+}
+
+
+void SoftwareRenderer::Flush()
+{
+    if (m_BinnedTriangles.empty())
+    {
+        return;
+    }
+
+    // Tiles don't share any pixels, so they can be drawn in any order,
+    // on any thread. A tile's visibility buffer is resolved as soon as
+    // it is rasterized, while it is still in the cache.
+    StageTimer timer { m_PipelineStats.flushNanoseconds };
+    m_ThreadPool.ParallelFor(m_TilesWide * m_TilesHigh, [this](uint32_t tileIndex, uint32_t threadIndex) {
+        RasterStats tileStats;
+        PipelineStats tilePipelineStats;
+        {
+            StageTimer rasterTimer { tilePipelineStats.rasterNanoseconds };
+            RasterizeTile(tileIndex, tileStats, tilePipelineStats);
+        }
+        if (m_ShadingMode == ShadingMode::VisibilityBuffer)
+        {
+            StageTimer resolveTimer { tilePipelineStats.resolveNanoseconds };
+            ResolveTile(tileIndex, tileStats, tilePipelineStats);
+        }
+        m_ThreadRasterStats[threadIndex] += tileStats;
+        if (PIPELINE_STATS_ENABLED)
+        {
+            m_ThreadPipelineStats[threadIndex] += tilePipelineStats;
+        }
+    });
+
+    DiscardBins();
+}
+
+
+// Empties the tile bins, and frees the triangles in them.
+void SoftwareRenderer::DiscardBins()
+{
+    for (auto& rBin : m_TileBins)
+    {
+        rBin.Clear();
+    }
+    m_BinnedTriangles.clear();
+    m_FrameArena.Reset();
+}
+
+
+// Does whichever of the given clears the tile is still waiting for.
+void SoftwareRenderer::ClearTile(uint32_t tileIndex, ClearFlags flags)
+{
+    flags = flags & m_PendingClears[tileIndex];
+    if (flags == ClearFlags::None)
+    {
+        return;
+    }
+
+    const uint32_t tileX = (tileIndex % m_TilesWide) * TILE_SIZE;
+    const uint32_t tileY = (tileIndex / m_TilesWide) * TILE_SIZE;
+    ClearRect(flags, tileX, tileY, std::min(TILE_SIZE, m_FrameWidth - tileX), std::min(TILE_SIZE, m_FrameHeight - tileY));
+    m_PendingClears[tileIndex] = m_PendingClears[tileIndex] & static_cast<ClearFlags>(~static_cast<uint32_t>(flags));
+}
+
+
+// Fills a rectangle of whole blocks (other than at the edges of the frame)
+// with the clear color or depth.
+void SoftwareRenderer::ClearRect(ClearFlags flags, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+    // Rows the full width of the frame are one run of memory.
+    const uint32_t runLength = width == m_FrameWidth ? width * height : width;
+    const uint32_t runCount = width == m_FrameWidth ? 1 : height;
+
+    if ((flags & ClearFlags::Color) != ClearFlags::None)
+    {
+        uint8_t color[4];
+        ConvertTexels(m_ClearColor, 1, m_ColorFormat, color);
+        for (uint32_t run = 0; run < runCount; run++)
+        {
+            FillValues(&m_pFramebuffer[((y + run) * m_FrameWidth + x) * m_ColorSize], runLength, color, m_ColorSize);
+        }
+    }
+
+    if ((flags & ClearFlags::Depth) != ClearFlags::None)
+    {
+        // The hierarchical depth is whatever the stored depth comes back as.
+        uint8_t depth[4];
+        const float hiZDepth = WithDepthCodec(m_DepthFormat, [this, &depth](auto codec) {
+            const auto value = codec.Encode(m_ClearDepth, m_DepthScale);
+            codec.Store(depth, value);
+            return codec.Decode(value, m_DepthScale);
+        });
+        for (uint32_t run = 0; run < runCount; run++)
+        {
+            FillValues(&m_DepthBuffer[((y + run) * m_FrameWidth + x) * m_DepthSize], runLength, depth, m_DepthSize);
+        }
+
+        for (uint32_t blockY = y / BLOCK_SIZE; blockY < (y + height + BLOCK_SIZE - 1) / BLOCK_SIZE; blockY++)
+        {
+            for (uint32_t blockX = x / BLOCK_SIZE; blockX < (x + width + BLOCK_SIZE - 1) / BLOCK_SIZE; blockX++)
+            {
+                m_HiZBuffer[blockY * m_BlocksWide + blockX] = hiZDepth;
+            }
+        }
+    }
+}
+
+
+void SoftwareRenderer::RasterizeTile(uint32_t tileIndex, RasterStats& rStats, PipelineStats& rPipelineStats)
+{
+    if (m_TileBins[tileIndex].GetSize() == 0)
+    {
+        return;
+    }
+    ClearTile(tileIndex, ClearFlags::All);
+
+    const uint32_t tileXMin = (tileIndex % m_TilesWide) * TILE_SIZE;
+    const uint32_t tileYMin = (tileIndex / m_TilesWide) * TILE_SIZE;
+    const uint32_t tileXMax = std::min(tileXMin + TILE_SIZE, m_FrameWidth) - 1;
+    const uint32_t tileYMax = std::min(tileYMin + TILE_SIZE, m_FrameHeight) - 1;
+
+    m_TileBins[tileIndex].ForEach([&](const RasterTriangle* pTriangle) {
+        const auto& rTriangle = *pTriangle;
+        const uint32_t xmin = std::max(rTriangle.xmin, tileXMin);
+        const uint32_t xmax = std::min(rTriangle.xmax, tileXMax);
+        const uint32_t ymin = std::max(rTriangle.ymin, tileYMin);
+        const uint32_t ymax = std::min(rTriangle.ymax, tileYMax);
+
+        const PixelPipeline& rPipeline = *rTriangle.pPipeline;
+        if (m_RasterMode == RasterMode::FixedPoint)
+        {
+            (this->*rPipeline.rasterizeFixed)(rTriangle, rTriangle.fixedEdges, xmin, xmax, ymin, ymax, rStats, rPipelineStats);
+        }
+        else
+        {
+            (this->*rPipeline.rasterize)(rTriangle, rTriangle.edges, xmin, xmax, ymin, ymax, rStats, rPipelineStats);
+        }
+    });
+}
+
+
+// Draws the part of a binned triangle inside the given (inclusive) pixel bounds,
+// using either its floating point or its fixed point edges. State is its
+// RasterPixelState.
+template <typename Edges, uint32_t State>
+void SoftwareRenderer::RasterizeTriangle(
+    const RasterTriangle& triangle, const Edges& edges, uint32_t xmin, uint32_t xmax, uint32_t ymin, uint32_t ymax,
+    RasterStats& rStats, PipelineStats& rPipelineStats
+)
+{
+    const bool depthTest = (State & PIXEL_DEPTH_TEST) != 0;
+    const bool depthWrite = (State & PIXEL_DEPTH_WRITE) != 0;
+    const bool deferred = (State & PIXEL_DEFERRED) != 0;
+
+    // Nothing to do if everything already drawn under the triangle is nearer.
+    if (depthTest)
+    {
+        float farthestDepth = 0.0f;
+        for (uint32_t blockY = ymin / BLOCK_SIZE; blockY <= ymax / BLOCK_SIZE; blockY++)
+        {
+            for (uint32_t blockX = xmin / BLOCK_SIZE; blockX <= xmax / BLOCK_SIZE; blockX++)
+            {
+                farthestDepth = std::max(farthestDepth, m_HiZBuffer[blockY * m_BlocksWide + blockX]);
+            }
+        }
+        if (GetNearestDepth(edges, xmin, ymin, xmax, ymax) >= farthestDepth)
+        {
+            rStats.hiZRejectedTriangles++;
+            return;
+        }
+    }
+
+    rStats.boundingBoxPixels += static_cast<uint64_t>(xmax - xmin + 1) * (ymax - ymin + 1);
+
+    // Spans start on a block boundary, so the kernel's
+    // groups of pixels line up with the blocks.
+    const uint32_t spanX = xmin & ~(BLOCK_SIZE - 1);
+    RasterSpan spans[QUAD_SIZE];
+
+    // Depth is tested before anything is textured. Unless the alpha test
+    // could still discard a fragment, its depth is written then too.
+    const bool alphaTest = (State & PIXEL_ALPHA_TEST) != 0;
+
+    // With a visibility buffer, pixels are shaded once the whole tile has
+    // been rasterized, and only as far as the alpha test needs until then.
+    // Depth-only draws aren't shaded at all, unless for the alpha test.
+    const ShadeFunction shade = triangle.pPipeline->shade;
+    const bool writesColor = ! deferred && (triangle.pPipeline->state & PIXEL_COLOR_WRITE) != 0;
+    const Texture* pLodTexture = shade != nullptr ? GetLodTexture(triangle) : nullptr;
+
+    for (uint32_t blockY = ymin & ~(BLOCK_SIZE - 1); blockY <= ymax; blockY += BLOCK_SIZE)
+    {
+        const uint32_t blockYMin = std::max(blockY, ymin);
+        const uint32_t blockYMax = std::min(blockY + BLOCK_SIZE - 1, ymax);
+
+        // For each row in this row of blocks: pixels known to be inside
+        // the triangle, and pixels which still need their edges tested.
+        uint64_t acceptedRows[BLOCK_SIZE] = {};
+        uint64_t testRows[BLOCK_SIZE] = {};
+        auto markPixels = [spanX, blockY](uint64_t rows[], uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1) {
+            const uint64_t bits = ((uint64_t { 1 } << (x1 - x0 + 1)) - 1) << (x0 - spanX);
+            for (uint32_t y = y0; y <= y1; y++)
+            {
+                rows[y - blockY] |= bits;
+            }
+        };
+
+        // Throw out blocks entirely outside the triangle, or hidden behind what
+        // is already drawn, take blocks entirely inside it as they are, and
+        // only look closer at the rest, 2x2 at a time.
+        for (uint32_t blockX = spanX; blockX <= xmax; blockX += BLOCK_SIZE)
+        {
+            const uint32_t blockXMin = std::max(blockX, xmin);
+            const uint32_t blockXMax = std::min(blockX + BLOCK_SIZE - 1, xmax);
+
+            const RectCoverage blockCoverage = ClassifyRect(edges, blockXMin, blockYMin, blockXMax, blockYMax);
+            if (depthTest && blockCoverage != RectCoverage::Outside &&
+                GetNearestDepth(edges, blockXMin, blockYMin, blockXMax, blockYMax) >= m_HiZBuffer[(blockY / BLOCK_SIZE) * m_BlocksWide + blockX / BLOCK_SIZE])
+            {
+                rStats.hiZRejectedBlocks++;
+                continue;
+            }
+
+            switch (blockCoverage)
+            {
+            case RectCoverage::Outside:
+                rStats.rejectedBlocks++;
+                break;
+
+            case RectCoverage::Inside:
+                rStats.acceptedBlocks++;
+                markPixels(acceptedRows, blockXMin, blockXMax, blockYMin, blockYMax);
+                break;
+
+            case RectCoverage::Partial:
+                rStats.partialBlocks++;
+                for (uint32_t quadY = blockYMin & ~(QUAD_SIZE - 1); quadY <= blockYMax; quadY += QUAD_SIZE)
+                {
+                    const uint32_t quadYMin = std::max(quadY, blockYMin);
+                    const uint32_t quadYMax = std::min(quadY + QUAD_SIZE - 1, blockYMax);
+                    for (uint32_t quadX = blockXMin & ~(QUAD_SIZE - 1); quadX <= blockXMax; quadX += QUAD_SIZE)
+                    {
+                        const uint32_t quadXMin = std::max(quadX, blockXMin);
+                        const uint32_t quadXMax = std::min(quadX + QUAD_SIZE - 1, blockXMax);
+
+                        switch (ClassifyRect(edges, quadXMin, quadYMin, quadXMax, quadYMax))
+                        {
+                        case RectCoverage::Outside:
+                            rStats.rejectedQuads++;
+                            break;
+                        case RectCoverage::Inside:
+                            rStats.acceptedQuads++;
+                            markPixels(acceptedRows, quadXMin, quadXMax, quadYMin, quadYMax);
+                            break;
+                        case RectCoverage::Partial:
+                            rStats.partialQuads++;
+                            markPixels(testRows, quadXMin, quadXMax, quadYMin, quadYMax);
+                            break;
+                        }
+                    }
+                }
+                break;
+            }
+        }
+
+        // Pixels are shaded a 2x2 quad at a time, two rows at once, so that
+        // texture coordinates can be differenced across each quad to pick a
+        // mip level. When that's needed, the pixels of a quad outside the
+        // triangle are evaluated too, but never drawn.
+        uint64_t drawnPixels = 0;
+        for (uint32_t y = blockYMin & ~(QUAD_SIZE - 1); y <= blockYMax; y += QUAD_SIZE)
+        {
+            const uint32_t row = y - blockY;
+            const uint64_t candidates = acceptedRows[row] | testRows[row] | acceptedRows[row + 1] | testRows[row + 1];
+            if (candidates == 0)
+            {
+                continue;
+            }
+
+            // Every pixel in a quad with anything to draw. Spans start on
+            // a block boundary, so quads are pairs of bits.
+            uint64_t quads = (candidates | (candidates >> 1)) & 0x5555555555555555;
+            quads |= quads << 1;
+
+            uint64_t coverage[QUAD_SIZE];
+            for (uint32_t i = 0; i < QUAD_SIZE; i++)
+            {
+                const uint64_t accepted = acceptedRows[row + i];
+                const uint64_t test = testRows[row + i];
+                const uint64_t active = pLodTexture != nullptr ? quads : accepted | test;
+                if (active == 0)
+                {
+                    coverage[i] = 0;
+                    continue;
+                }
+
+                // Accepted pixels still need their barycentrics and depth,
+                // they just skip the edge test.
+                RasterizeRow(edges, spanX, y + i, active, spans[i]);
+                rStats.testedPixels += __builtin_popcountll(test);
+
+                // TODO: Test for top and left edges in floating point mode too, to prevent drawing
+                // over the same edge of adjacent triangles (RasterMode::FixedPoint already does)
+                coverage[i] = (spans[i].coverage & test) | accepted;
+
+                // Early depth test.
+                const uint32_t rowStart = (y + i) * m_FrameWidth + spanX;
+                const uint32_t coveredCount = __builtin_popcountll(coverage[i]);
+                if (depthTest || (depthWrite && ! alphaTest))
+                {
+                    const RasterSpan& rSpan = spans[i];
+                    uint64_t& rCoverage = coverage[i];
+                    WithDepthCodec(m_DepthFormat, [&](auto codec) {
+                        uint8_t* pDepthRow = &m_DepthBuffer[rowStart * codec.SIZE];
+                        for (uint64_t pixels = rCoverage; pixels != 0; pixels &= pixels - 1)
+                        {
+                            const uint32_t spanIndex = __builtin_ctzll(pixels);
+                            uint8_t* pDepth = pDepthRow + spanIndex * codec.SIZE;
+                            const auto depth = codec.Encode(rSpan.depth[spanIndex], m_DepthScale);
+                            if (depthTest && ! codec.IsNearer(depth, codec.Load(pDepth)))
+                            {
+                                rCoverage &= ~(uint64_t { 1 } << spanIndex);
+                            }
+                            else if (depthWrite && ! alphaTest)
+                            {
+                                codec.Store(pDepth, depth);
+                                if (deferred)
+                                {
+                                    m_VisibilityBuffer[rowStart + spanIndex] = triangle.id;
+                                }
+                            }
+                        }
+                    });
+                }
+                rStats.depthRejectedPixels += coveredCount - __builtin_popcountll(coverage[i]);
+                if (writesColor)
+                {
+                    rStats.shadedPixels += __builtin_popcountll(coverage[i]);
+                }
+                if (PIPELINE_STATS_ENABLED)
+                {
+                    rPipelineStats.fragmentsDepthTested += coveredCount;
+                    rPipelineStats.fragmentsPassedDepth += __builtin_popcountll(coverage[i]);
+                }
+            }
+
+            drawnPixels |= coverage[0] | coverage[1];
+            if (shade != nullptr)
+            {
+                const uint32_t passedCount = (this->*shade)(triangle, spans, spanX, y, coverage, pLodTexture);
+                if (PIPELINE_STATS_ENABLED)
+                {
+                    if (alphaTest)
+                    {
+                        rPipelineStats.fragmentsAlphaTested += __builtin_popcountll(coverage[0]) + __builtin_popcountll(coverage[1]);
+                        rPipelineStats.fragmentsPassedAlpha += passedCount;
+                    }
+                    if (writesColor)
+                    {
+                        rPipelineStats.pixelsWritten += passedCount;
+                    }
+                }
+            }
+        }
+
+        if (depthWrite)
+        {
+            for (uint32_t blockX = spanX; blockX <= xmax; blockX += BLOCK_SIZE)
+            {
+                if (((drawnPixels >> (blockX - spanX)) & 0xff) != 0)
+                {
+                    UpdateHiZ(blockX / BLOCK_SIZE, blockY / BLOCK_SIZE);
+                }
+            }
+        }
+    }
+}
+
+
+// Only mipmapped textures need a level of detail.
+const Texture* SoftwareRenderer::GetLodTexture(const RasterTriangle& triangle)
+{
+    if (triangle.textureID != 0 && triangle.sampler.mipFilter != MipFilter::None && GetTexture(triangle.textureID).levelCount > 1)
+    {
+        return &GetTexture(triangle.textureID);
+    }
+    return nullptr;
+}
+
+
+// Shades the pixels set in coverage, in a pair of rows starting at (spanX, y),
+// a 2x2 quad at a time. The varyings are interpolated once, at (spanX, y),
+// and stepped from there to each quad. With a pLodTexture, every pixel of a
+// quad with any coverage must have been rasterized, for the texture
+// coordinate derivatives.
+// Returns how many of the pixels passed the alpha test. State is the
+// triangle's ShadePixelState or ResolvePixelState.
+template <uint32_t State>
+uint32_t SoftwareRenderer::ShadeQuads(
+    const RasterTriangle& triangle, const RasterSpan spans[], uint32_t spanX, uint32_t y,
+    const uint64_t coverage[], const Texture* pLodTexture
+)
+{
+    const Texture* pTexture = (State & PIXEL_TEXTURED) != 0 ? &GetTexture(triangle.textureID) : nullptr;
+
+    // Only the varyings the pixels are going to read, which are in a row.
+    const uint32_t u = static_cast<uint32_t>(VertexVarying::TexcoordU);
+    const uint32_t v = static_cast<uint32_t>(VertexVarying::TexcoordV);
+    const bool useColor = (State & PIXEL_VERTEX_COLOR) != 0;
+    const bool useTexcoords = (State & PIXEL_TEXTURED) != 0 || pLodTexture != nullptr;
+    const uint32_t firstVarying = useColor ? static_cast<uint32_t>(VertexVarying::ColorR) : u;
+    const uint32_t lastVarying = useTexcoords ? v + 1 : (useColor ? static_cast<uint32_t>(VertexVarying::ColorB) + 1 : u);
+
+    float spanVaryings[VERTEX_MAX_VARYINGS];
+    InterpolatePixel(triangle.varyings, firstVarying, lastVarying, spanX, y, spanVaryings);
+
+    uint32_t passedCount = 0;
+    const uint64_t covered = coverage[0] | coverage[1];
+    for (uint64_t coveredQuads = (covered | (covered >> 1)) & 0x5555555555555555; coveredQuads != 0; coveredQuads &= coveredQuads - 1)
+    {
+        const uint32_t quadIndex = __builtin_ctzll(coveredQuads);
+
+        float varyings[QUAD_SIZE * QUAD_SIZE][VERTEX_MAX_VARYINGS];
+        InterpolateQuad(triangle.varyings, firstVarying, lastVarying, spanVaryings, quadIndex, varyings);
+
+        // Perspective correct texture coordinates, before they wrap.
+        auto texcoords = [&varyings, u, v](uint32_t pixel, float depth) {
+            return glm::vec2 { varyings[pixel][u], varyings[pixel][v] } * depth;
+        };
+
+        float lod = 0.0f;
+        if (pLodTexture != nullptr)
+        {
+            const glm::vec2 topLeft = texcoords(0, spans[0].depth[quadIndex]);
+            lod = ComputeTextureLod(
+                *pLodTexture,
+                texcoords(1, spans[0].depth[quadIndex + 1]) - topLeft,
+                texcoords(QUAD_SIZE, spans[1].depth[quadIndex]) - topLeft
+            );
+        }
+
+        // Texels stay in their compact format until they are needed, so
+        // only the ones being sampled are converted, a quad at a time.
+        glm::vec4 texels[QUAD_SIZE * QUAD_SIZE];
+        if (State & PIXEL_TEXTURED)
+        {
+            glm::vec2 quadTexcoords[QUAD_SIZE * QUAD_SIZE];
+            uint32_t mask = 0;
+            for (uint32_t i = 0; i < QUAD_SIZE; i++)
+            {
+                for (uint32_t spanIndex = quadIndex; spanIndex < quadIndex + QUAD_SIZE; spanIndex++)
+                {
+                    if ((coverage[i] >> spanIndex) & 1)
+                    {
+                        const uint32_t pixel = i * QUAD_SIZE + spanIndex - quadIndex;
+                        quadTexcoords[pixel] = texcoords(pixel, spans[i].depth[spanIndex]);
+                        mask |= 1u << pixel;
+                    }
+                }
+            }
+            triangle.sampleQuad(*pTexture, triangle.sampler, quadTexcoords, lod, mask, texels);
+        }
+
+        for (uint32_t i = 0; i < QUAD_SIZE; i++)
+        {
+            for (uint32_t spanIndex = quadIndex; spanIndex < quadIndex + QUAD_SIZE; spanIndex++)
+            {
+                if ((coverage[i] >> spanIndex) & 1)
+                {
+                    const uint32_t pixel = i * QUAD_SIZE + spanIndex - quadIndex;
+                    const glm::vec4 texel = (State & PIXEL_TEXTURED) != 0 ? texels[pixel] : glm::vec4 { 1.0f };
+                    if (ShadePixel<State>(triangle, spanX + spanIndex, y + i, varyings[pixel], spans[i].depth[spanIndex], texel))
+                    {
+                        passedCount++;
+                    }
+                }
+            }
+        }
+    }
+    return passedCount;
+}
+
+
+// Shades every pixel of a tile left in the visibility buffer with the triangle
+// it names, a pair of rows at a time, and empties the buffer for the next flush.
+void SoftwareRenderer::ResolveTile(uint32_t tileIndex, RasterStats& rStats, PipelineStats& rPipelineStats)
+{
+    const uint32_t tileXMin = (tileIndex % m_TilesWide) * TILE_SIZE;
+    const uint32_t tileYMin = (tileIndex / m_TilesWide) * TILE_SIZE;
+    const uint32_t tileXMax = std::min(tileXMin + TILE_SIZE, m_FrameWidth) - 1;
+    const uint32_t tileYMax = std::min(tileYMin + TILE_SIZE, m_FrameHeight) - 1;
+
+    for (uint32_t y = tileYMin; y <= tileYMax; y += QUAD_SIZE)
+    {
+        // Each triangle left in the pair of rows is shaded in one go,
+        // and its pixels emptied, so the scan moves on to the next.
+        const uint32_t rowCount = std::min(QUAD_SIZE, tileYMax - y + 1);
+        for (uint32_t row = 0; row < rowCount; row++)
+        {
+            for (uint32_t x = tileXMin; x <= tileXMax; x++)
+            {
+                const uint32_t id = m_VisibilityBuffer[(y + row) * m_FrameWidth + x];
+                if (id == 0)
+                {
+                    continue;
+                }
+
+                const RasterTriangle& rTriangle = *m_BinnedTriangles[id - 1];
+                const uint32_t xmin = std::max(rTriangle.xmin, tileXMin);
+                const uint32_t xmax = std::min(rTriangle.xmax, tileXMax);
+                const uint32_t spanX = xmin & ~(BLOCK_SIZE - 1);
+                uint64_t visible[QUAD_SIZE] = {};
+                for (uint32_t i = row; i < rowCount; i++)
+                {
+                    uint32_t* pRow = &m_VisibilityBuffer[(y + i) * m_FrameWidth];
+                    for (uint32_t pixelX = xmin; pixelX <= xmax; pixelX++)
+                    {
+                        if (pRow[pixelX] == id)
+                        {
+                            visible[i] |= uint64_t { 1 } << (pixelX - spanX);
+                            pRow[pixelX] = 0;
+                        }
+                    }
+                }
+
+                if (m_RasterMode == RasterMode::FixedPoint)
+                {
+                    ResolveTriangle(rTriangle, rTriangle.fixedEdges, spanX, y, visible, rStats, rPipelineStats);
+                }
+                else
+                {
+                    ResolveTriangle(rTriangle, rTriangle.edges, spanX, y, visible, rStats, rPipelineStats);
+                }
+            }
+        }
+    }
+}
+
+
+// Rasterizes a triangle again, over just the pixels it is visible in, and shades
+// them. Spans start where RasterizeTriangle started them, so the barycentrics
+// and depth come out exactly the same.
+template <typename Edges>
+void SoftwareRenderer::ResolveTriangle(const RasterTriangle& triangle, const Edges& edges, uint32_t spanX, uint32_t y, const uint64_t visible[], RasterStats& rStats, PipelineStats& rPipelineStats)
+{
+    const Texture* pLodTexture = GetLodTexture(triangle);
+
+    uint64_t quads = ((visible[0] | visible[1]) | ((visible[0] | visible[1]) >> 1)) & 0x5555555555555555;
+    quads |= quads << 1;
+
+    RasterSpan spans[QUAD_SIZE];
+    for (uint32_t i = 0; i < QUAD_SIZE; i++)
+    {
+        const uint64_t active = pLodTexture != nullptr ? quads : visible[i];
+        if (active != 0)
+        {
+            RasterizeRow(edges, spanX, y + i, active, spans[i]);
+        }
+        rStats.shadedPixels += __builtin_popcountll(visible[i]);
+    }
+
+    // Depth was written, and the alpha test done, while rasterizing.
+    const uint32_t writtenCount = (this->*triangle.pPipeline->resolve)(triangle, spans, spanX, y, visible, pLodTexture);
+    if (PIPELINE_STATS_ENABLED)
+    {
+        rPipelineStats.pixelsWritten += writtenCount;
+    }
+}
+
+
+// Brings a block of the hierarchical depth buffer up to date
+// with the depth buffer, after depths in it have been written.
+void SoftwareRenderer::UpdateHiZ(uint32_t blockX, uint32_t blockY)
+{
+    const uint32_t xmin = blockX * BLOCK_SIZE;
+    const uint32_t ymin = blockY * BLOCK_SIZE;
+    const uint32_t xmax = std::min(xmin + BLOCK_SIZE, m_FrameWidth);
+    const uint32_t ymax = std::min(ymin + BLOCK_SIZE, m_FrameHeight);
+
+    m_HiZBuffer[blockY * m_BlocksWide + blockX] = WithDepthCodec(m_DepthFormat, [&](auto codec) {
+        auto farthestDepth = codec.Load(&m_DepthBuffer[(ymin * m_FrameWidth + xmin) * codec.SIZE]);
+        for (uint32_t y = ymin; y < ymax; y++)
+        {
+            for (uint32_t x = xmin; x < xmax; x++)
+            {
+                const auto depth = codec.Load(&m_DepthBuffer[(y * m_FrameWidth + x) * codec.SIZE]);
+                if (codec.IsNearer(farthestDepth, depth))
+                {
+                    farthestDepth = depth;
+                }
+            }
+        }
+        return codec.Decode(farthestDepth, m_DepthScale);
+    });
+}
+
+
+void SoftwareRenderer::RasterizeRow(const TriangleEdges& edges, uint32_t x, uint32_t y, uint64_t activeMask, RasterSpan& rSpan) const
+{
+    float rowEdges[3];
+    for (int i = 0; i < 3; i++)
+    {
+        rowEdges[i] = edges.a[i] * static_cast<float>(x) + edges.b[i] * static_cast<float>(y) + edges.c[i];
+    }
+    m_RasterRow(edges, rowEdges, activeMask, rSpan);
+}
+
+
+void SoftwareRenderer::RasterizeRow(const FixedTriangleEdges& edges, uint32_t x, uint32_t y, uint64_t activeMask, RasterSpan& rSpan) const
+{
+    RasterRowFixed(edges, x, y, activeMask, rSpan);
+}
+
+
+// The pixel has already passed the depth test. With the alpha test on,
+// its depth is only written once it has passed that too. Returns false
+// if the alpha test discarded it. The texel is the pixel's sample of the
+// triangle's texture, if it has one. State is as for ShadeQuads.
+template <uint32_t State>
+bool SoftwareRenderer::ShadePixel(const RasterTriangle& triangle, uint32_t x, uint32_t y, const float varyings[VERTEX_MAX_VARYINGS], float depth, const glm::vec4& texel)
+{
+    // The varyings were divided by w, and depth is w.
+    auto varying = [varyings, depth](VertexVarying which)
+    {
+        return varyings[static_cast<uint32_t>(which)] * depth;
+    };
+
+    uint32_t pixelIndex = (y * m_FrameWidth + x);
+
+    // The depth passed in has already been through the reciprocal for
+    // perspective correction, as 1 / (1/w interpolated across the triangle)
+
+    // Alpha Test
+    if (State & PIXEL_ALPHA_TEST)
+    {
+        if (texel.a < ALPHA_TEST_REFERENCE)
+        {
+            return false;
+        }
+        if (State & PIXEL_DEPTH_WRITE)
+        {
+            WithDepthCodec(m_DepthFormat, [this, pixelIndex, depth](auto codec) {
+                codec.Store(&m_DepthBuffer[pixelIndex * codec.SIZE], codec.Encode(depth, m_DepthScale));
+            });
+        }
+
+        // The rest waits until the visibility buffer is resolved.
+        if (State & PIXEL_DEFERRED)
+        {
+            m_VisibilityBuffer[pixelIndex] = triangle.id;
+            return true;
+        }
+    }
+    if ((State & PIXEL_COLOR_WRITE) == 0)
+    {
+        return true;
+    }
+
+    glm::vec3 color = triangle.debugColor;
+    if (State & PIXEL_VERTEX_COLOR)
+    {
+        color = { varying(VertexVarying::ColorR), varying(VertexVarying::ColorG), varying(VertexVarying::ColorB) };
+    }
+
+    if (State & PIXEL_REPLACE)
+    {
+        color = glm::vec3 { texel };
+    }
+    else if (State & PIXEL_MODULATE)
+    {
+        color *= glm::vec3 { texel };
+    }
+    else if (State & PIXEL_TEXTURED)
+    {
+        color = 0.5f * color + 0.5f * glm::vec3 { texel };
+    }
+
+    StoreColor(pixelIndex, color);
+    return true;
+}
+
+
+// Writes a pixel in the color format. The color format is the same for every
+// pixel the renderer draws, so which way it goes is always predicted. Colors
+// are clamped, and the 5 and 6 bit formats round them the way textures do.
+void SoftwareRenderer::StoreColor(uint32_t pixelIndex, const glm::vec3& color)
+{
+    uint8_t* pPixel = &m_pFramebuffer[pixelIndex * m_ColorSize];
+    switch (m_ColorFormat)
+    {
+    case TextureFormat::RGB565:
+    {
+        const uint16_t pixel =
+            (QuantizeUnorm(color.r, 31) << 11) |
+            (QuantizeUnorm(color.g, 63) << 5) |
+            QuantizeUnorm(color.b, 31);
+        memcpy(pPixel, &pixel, sizeof(pixel));
+        break;
+    }
+
+    case TextureFormat::RGB666:
+    {
+        const uint32_t pixel =
+            (QuantizeUnorm(color.r, 63) << 12) |
+            (QuantizeUnorm(color.g, 63) << 6) |
+            QuantizeUnorm(color.b, 63);
+        pPixel[0] = pixel & 0xff;
+        pPixel[1] = (pixel >> 8) & 0xff;
+        pPixel[2] = (pixel >> 16) & 0xff;
+        break;
+    }
+
+    case TextureFormat::RGBA8:
+    default:
+        // Truncated rather than rounded, which the reference images expect.
+        pPixel[0] = static_cast<uint8_t>(0xff * glm::clamp(color.b, 0.0f, 1.0f));
+        pPixel[1] = static_cast<uint8_t>(0xff * glm::clamp(color.g, 0.0f, 1.0f));
+        pPixel[2] = static_cast<uint8_t>(0xff * glm::clamp(color.r, 0.0f, 1.0f));
+        pPixel[3] = 0xff;  // TODO: Alpha Blending
+        break;
+    }
+}
+
+
+template <uint32_t State>
+SoftwareRenderer::PixelPipeline SoftwareRenderer::MakePixelPipeline()
+{
+    const uint32_t rasterState = RasterPixelState(State);
+    const uint32_t shadeState = ShadePixelState(State);
+    const uint32_t resolveState = ResolvePixelState(State);
+
+    PixelPipeline pipeline {
+        CanonicalPixelState(State),
+        &SoftwareRenderer::RasterizeTriangle<TriangleEdges, rasterState>,
+        &SoftwareRenderer::RasterizeTriangle<FixedTriangleEdges, rasterState>,
+        nullptr,
+        nullptr,
+    };
+    if constexpr (shadeState != PIXEL_NO_LOOP)
+    {
+        pipeline.shade = &SoftwareRenderer::ShadeQuads<shadeState>;
+    }
+    if constexpr (resolveState != PIXEL_NO_LOOP)
+    {
+        pipeline.resolve = &SoftwareRenderer::ShadeQuads<resolveState>;
+    }
+    return pipeline;
+}
+
+
+template <size_t... States>
+std::array<SoftwareRenderer::PixelPipeline, sizeof...(States)> SoftwareRenderer::MakePixelPipelines(std::index_sequence<States...>)
+{
+    return { MakePixelPipeline<States>()... };
+}
+
+
+// Every state has an entry, but states which draw the same way share
+// loops, so only the ones counted by CountPixelLoops are built.
+const SoftwareRenderer::PixelPipeline& SoftwareRenderer::GetPixelPipeline(uint32_t state)
+{
+    static const auto pipelines = MakePixelPipelines(std::make_index_sequence<PIXEL_STATE_COUNT> {});
+    return pipelines[state];
+}
+
+
+// Picks the per-pixel loops for the draw about to start.
+void SoftwareRenderer::SelectPixelPipeline()
+{
+    uint32_t state = 0;
+    state |= m_DepthTest ? PIXEL_DEPTH_TEST : 0;
+    state |= m_DepthWrite ? PIXEL_DEPTH_WRITE : 0;
+    state |= m_ColorWrite ? PIXEL_COLOR_WRITE : 0;
+    state |= m_ShadingMode == ShadingMode::VisibilityBuffer ? PIXEL_DEFERRED : 0;
+    state |= m_ColorSource == ColorSource::VertexColor ? PIXEL_VERTEX_COLOR : 0;
+    state |= m_BlendMode == BlendMode::Modulate ? PIXEL_MODULATE : 0;
+    state |= m_BlendMode == BlendMode::Replace ? PIXEL_REPLACE : 0;
+
+    // Textures only change once everything drawn with them is flushed.
+    m_DrawSampleQuad = nullptr;
+    if (m_ActiveTextureID != 0)
+    {
+        const Texture& rTexture = GetTexture(m_ActiveTextureID);
+        state |= PIXEL_TEXTURED;
+        if (rTexture.minAlpha < ALPHA_TEST_REFERENCE)
+        {
+            state |= PIXEL_ALPHA_TEST;
+        }
+        m_DrawSampleQuad = GetSampleQuadFunction(rTexture, m_ActiveSampler);
+    }
+    m_pDrawPipeline = &GetPixelPipeline(state);
+}
+
+
+const uint8_t* SoftwareRenderer::GetFramebufferPointer()
+{
+    Flush();
+
+    // Tiles nothing was drawn in might not be cleared yet.
+    if (m_LazyClears)
+    {
+        StageTimer timer { m_PipelineStats.clearNanoseconds };
+        m_ThreadPool.ParallelFor(m_TilesWide * m_TilesHigh, [this](uint32_t tileIndex, uint32_t) {
+            ClearTile(tileIndex, ClearFlags::Color);
+        });
+    }
+
+    // A row of tiles at a time, as for clears.
+    if ( ! m_DisplayBuffers.empty())
+    {
+        m_ThreadPool.ParallelFor(m_TilesHigh, [this](uint32_t tileY, uint32_t) {
+            const uint32_t firstPixel = tileY * TILE_SIZE * m_FrameWidth;
+            const uint32_t pixelCount = std::min(TILE_SIZE, m_FrameHeight - tileY * TILE_SIZE) * m_FrameWidth;
+            ConvertTexelsToBGRA(&m_pFramebuffer[firstPixel * m_ColorSize], pixelCount, m_ColorFormat, &m_DisplayBuffers[m_BackBufferIndex][firstPixel * 4]);
+        });
+    }
+    return GetDisplayPointer();
+}
+
+
+// Where the back buffer is read from, once it is converted to RGBA8.
+const uint8_t* SoftwareRenderer::GetDisplayPointer() const
+{
+    return m_DisplayBuffers.empty() ? m_pFramebuffer : m_DisplayBuffers[m_BackBufferIndex].data();
+}
+
+
+void SoftwareRenderer::SetPresentFunction(const Presenter::PresentFunction& func)
+{
+    // Anything already queued is presented with the old function.
+    m_pPresenter.reset();
+    m_PresentWaitMilliseconds = 0.0;
+    if (func)
+    {
+        m_pPresenter = std::make_unique<Presenter>(func);
+    }
+}
+
+
+const uint8_t* SoftwareRenderer::Present()
+{
+    const uint8_t* pFinished = GetFramebufferPointer();
+    if (m_pPresenter)
+    {
+        m_pPresenter->Submit(pFinished);
+    }
+
+    m_BackBufferIndex = (m_BackBufferIndex + 1) % m_SwapChain.size();
+    m_pFramebuffer = &m_SwapChain[m_BackBufferIndex][0];
+
+    // With one buffer, this waits for the frame just submitted.
+    if (m_pPresenter)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        m_pPresenter->Wait(GetDisplayPointer());
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        m_PresentWaitMilliseconds += elapsed.count();
+    }
+    return pFinished;
+}
+
+
+PresentStats SoftwareRenderer::GetPresentStats() const
+{
+    PresentStats stats;
+    if (m_pPresenter)
+    {
+        stats.presentedFrames = m_pPresenter->GetPresentedFrames();
+        stats.presentMilliseconds = m_pPresenter->GetPresentMilliseconds();
+    }
+    stats.waitMilliseconds = m_PresentWaitMilliseconds;
+    return stats;
+}
+
+
+RasterStats SoftwareRenderer::GetRasterStats() const
+{
+    RasterStats total;
+    for (const auto& rStats : m_ThreadRasterStats)
+    {
+        total += rStats;
+    }
+    return total;
+}
+
+
+PipelineStats SoftwareRenderer::GetPipelineStats() const
+{
+    PipelineStats total = m_PipelineStats;
+    for (const auto& rStats : m_ThreadPipelineStats)
+    {
+        total += rStats;
+    }
+    return total;
+}
+
+
+VertexCacheStats SoftwareRenderer::GetVertexCacheStats() const
+{
+    return m_VertexCacheStats;
+}
+
+
+ScratchArenaStats SoftwareRenderer::GetDrawArenaStats() const
+{
+    return m_DrawArena.GetStats();
+}
+
+
+ScratchArenaStats SoftwareRenderer::GetFrameArenaStats() const
+{
+    return m_FrameArena.GetStats();
+}
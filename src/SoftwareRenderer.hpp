@@ -1,68 +1,587 @@
-
-#ifndef SOFTWARE_RENDERER_HPP
-#define SOFTWARE_RENDERER_HPP
-
-#include <stdint.h>
-#include <glm/glm.hpp>
-
-#include <vector>
-
-#include "Vertex.hpp"
-
-
-// TODO: Make abstract class above this one.
-class SoftwareRenderer
-{
-public:
-
-    SoftwareRenderer(uint32_t frameWidth, uint32_t frameHeight);
-
-    void Clear(uint8_t r, uint8_t g, uint8_t b);
-
-    void DrawTriangleList(const std::vector<Vertex>& vertices);
-
-    void SetProjectionMatrix(const glm::mat4& value);
-    void SetViewModelMatrix(const glm::mat4& value);
-
-    uint32_t CreateTexture();
-    void UpdateTexture(uint32_t id, uint32_t width, uint32_t height, const uint8_t* pData);
-    void DestroyTexture(uint32_t id);
-    void UseTexture(uint32_t id);
-
-    // TODO: Is this a part of the real API? Would be almost
-    // impossible in hardware, but easy on any simulated version.
-    const uint8_t* GetFramebufferPointer() const;
-
-private:
-
-    struct Texture
-    {
-        uint32_t width;
-        uint32_t height;
-        std::vector<float> data;
-    };
-
-    // TODO: Fix naming issue
-    // void RenderTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2);
-    void RenderTriangle(Vertex& v0, Vertex& v1, Vertex& v2);
-
-    Texture& GetActiveTexture();
-
-
-    const uint32_t m_FrameWidth;
-    const uint32_t m_FrameHeight;
-    std::vector<uint8_t> m_Framebuffer;
-    std::vector<float> m_DepthBuffer;
-
-    std::vector<Texture> m_Textures;
-    uint32_t m_ActiveTextureID;
-
-    glm::mat4 m_ProjectionMatrix;
-    glm::mat4 m_ViewModelMatrix;
-
-};
-
-
-
-
-#endif
+
+#ifndef SOFTWARE_RENDERER_HPP
+#define SOFTWARE_RENDERER_HPP
+
+#include <stdint.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "AttributePlanes.hpp"
+#include "CommandBuffer.hpp"
+#include "FixedPointRaster.hpp"
+#include "Presenter.hpp"
+#include "RasterKernel.hpp"
+#include "RasterState.hpp"
+#include "ScratchArena.hpp"
+#include "Texture.hpp"
+#include "ThreadPool.hpp"
+#include "Vertex.hpp"
+#include "VertexBuffer.hpp"
+#include "VertexTransform.hpp"
+
+
+enum class RasterMode
+{
+    FloatingPoint,
+
+    // Snaps vertices to a subpixel grid and rasterizes with integer edge
+    // functions and a top-left fill rule, the way the hardware would.
+    // Triangles sharing an edge never both draw, or both skip, a pixel on it.
+    FixedPoint,
+};
+
+
+enum class ShadingMode
+{
+    // Pixels are shaded as soon as they pass the depth test, so a pixel
+    // drawn over several times is shaded several times.
+    Forward,
+
+    // Each tile is rasterized first, keeping just the depth and the nearest
+    // triangle's ID for each pixel, and then every visible pixel is shaded
+    // exactly once. Shading no longer depends on how much overdraw there is.
+    VisibilityBuffer,
+};
+
+
+// How the depth buffer keeps each pixel's depth.
+enum class DepthFormat
+{
+    // The pixel's w, so nearer is smaller.
+    Float32,
+
+    // Reversed 1/w: RendererOptions::depthNear / w scaled to the full range
+    // of the integer, so nearer is bigger and the far plane goes towards 0.
+    // 24 bit depths are 3 bytes, least significant first.
+    Unorm16,
+    Unorm24,
+};
+
+
+// Which buffers Clear clears. Combine them with |.
+enum class ClearFlags : uint32_t
+{
+    None = 0,
+    Color = 1 << 0,
+    Depth = 1 << 1,
+    All = Color | Depth,
+};
+
+inline ClearFlags operator|(ClearFlags a, ClearFlags b)
+{
+    return static_cast<ClearFlags>(static_cast<uint32_t>(a) | static_cast<uint32_t>(b));
+}
+
+inline ClearFlags operator&(ClearFlags a, ClearFlags b)
+{
+    return static_cast<ClearFlags>(static_cast<uint32_t>(a) & static_cast<uint32_t>(b));
+}
+
+
+struct RendererOptions
+{
+    // Number of threads used to rasterize, including the thread which
+    // draws. Zero uses one thread per hardware thread. The output is
+    // identical no matter how many threads are used.
+    uint32_t threadCount = 0;
+
+    RasterMode rasterMode = RasterMode::FloatingPoint;
+
+    // Fractional bits of the subpixel grid used in FixedPoint mode,
+    // e.g. 4 for 28.4 coordinates. At most 8.
+    uint32_t subpixelBits = 4;
+
+    ShadingMode shadingMode = ShadingMode::Forward;
+
+    // Clear just remembers which tiles it cleared, and each one is filled the
+    // first time something is drawn in it, or when the frame is read back.
+    // Tiles which aren't drawn in aren't filled until then at all.
+    bool lazyClears = false;
+
+    // Color buffers to draw into in turn. With more than one, a frame can be
+    // drawn while the ones before it are still being presented.
+    uint32_t swapChainLength = 1;
+
+    // Formats of the color and depth buffers. The smaller ones touch less
+    // memory for each pixel drawn. Whatever the color format, the frame is
+    // read back and presented as RGBA8.
+    TextureFormat colorFormat = TextureFormat::RGBA8;
+    DepthFormat depthFormat = DepthFormat::Float32;
+
+    // For the integer depth formats, the nearest w they tell apart, which
+    // is usually the projection's near plane. Anything nearer gets the
+    // same depth.
+    float depthNear = 0.1f;
+};
+
+
+// What the hierarchical rasterizer did, summed over all threads.
+// Triangles are tested in 8x8 blocks, and partially covered
+// blocks are tested again in 2x2 quads.
+struct RasterStats
+{
+    uint64_t rejectedBlocks = 0;
+    uint64_t acceptedBlocks = 0;
+    uint64_t partialBlocks = 0;
+
+    uint64_t rejectedQuads = 0;
+    uint64_t acceptedQuads = 0;
+    uint64_t partialQuads = 0;
+
+    // Pixels which needed a per-pixel edge test, compared to how
+    // many pixels a full bounding box scan would have tested.
+    uint64_t testedPixels = 0;
+    uint64_t boundingBoxPixels = 0;
+
+    // Work skipped because everything already drawn there is nearer.
+    // Triangles are counted once for each tile they are thrown out of,
+    // and blocks only once they are known to be inside the triangle.
+    uint64_t hiZRejectedTriangles = 0;
+    uint64_t hiZRejectedBlocks = 0;
+
+    // Covered pixels which failed the depth test before being
+    // textured, and the ones which were shaded.
+    uint64_t depthRejectedPixels = 0;
+    uint64_t shadedPixels = 0;
+
+    RasterStats& operator+=(const RasterStats& other);
+};
+
+
+// Defined by the GPU_PIPELINE_STATS build option. When it is off, every
+// count and timing below is compiled out and GetPipelineStats gives zeros.
+#ifdef GPU_PIPELINE_STATS
+const bool PIPELINE_STATS_ENABLED = true;
+#else
+const bool PIPELINE_STATS_ENABLED = false;
+#endif
+
+
+// What each stage of the pipeline did. Clipping can turn a triangle into
+// several, so the counts after it are of the triangles it made.
+struct PipelineStats
+{
+    // Vertices are transformed a batch at a time, padding and all.
+    uint64_t verticesTransformed = 0;
+    uint64_t trianglesSubmitted = 0;
+
+    // Outside the view volume, or off the edges of the frame.
+    uint64_t trianglesFrustumCulled = 0;
+    uint64_t trianglesClipped = 0;
+
+    // Culled for the way they face, by the cull mode. Triangles which don't
+    // cross the plane of the camera are culled, and also checked for zero
+    // area and size, before they are clipped or even put together.
+    uint64_t trianglesBackfaceCulled = 0;
+
+    // Including triangles with a repeated vertex, and ones which have no
+    // area once they are snapped.
+    uint64_t trianglesZeroArea = 0;
+
+    // Bounding boxes with no pixel center in them.
+    uint64_t trianglesTooSmall = 0;
+
+    // Binned into tiles.
+    uint64_t trianglesRasterized = 0;
+
+    // Fragments are the pixels a triangle covers. The alpha test is only
+    // done on fragments of textures with some transparency.
+    uint64_t fragmentsDepthTested = 0;
+    uint64_t fragmentsPassedDepth = 0;
+    uint64_t fragmentsAlphaTested = 0;
+    uint64_t fragmentsPassedAlpha = 0;
+    uint64_t pixelsWritten = 0;
+
+    // Geometry is transforming, clipping, setting up and binning triangles.
+    // Raster and resolve are summed over every thread, and include any
+    // lazy clears of the tiles, so compare them with the wall clock time
+    // spent flushing to see how well the threads were used.
+    uint64_t clearNanoseconds = 0;
+    uint64_t geometryNanoseconds = 0;
+    uint64_t rasterNanoseconds = 0;
+    uint64_t resolveNanoseconds = 0;
+    uint64_t flushNanoseconds = 0;
+
+    PipelineStats& operator+=(const PipelineStats& other);
+};
+
+
+// Counts for indexed draws. A hit is an index referring to a vertex
+// which was already transformed earlier in the same draw.
+struct VertexCacheStats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
+
+
+// Totals since the present function was set.
+struct PresentStats
+{
+    uint64_t presentedFrames = 0;
+
+    // Time spent in the present function, on the presenter thread.
+    double presentMilliseconds = 0.0;
+
+    // Time Present spent waiting for the next buffer to be presented,
+    // before it could be drawn into again.
+    double waitMilliseconds = 0.0;
+};
+
+
+// TODO: Make abstract class above this one.
+class SoftwareRenderer
+{
+public:
+
+    SoftwareRenderer(uint32_t frameWidth, uint32_t frameHeight, const RendererOptions& options = {});
+
+    SoftwareRenderer(const SoftwareRenderer&) = delete;
+    SoftwareRenderer& operator=(const SoftwareRenderer&) = delete;
+
+    // Clears the color and depth buffers. Depth is cleared to the farthest
+    // it can be, so that anything drawn afterwards passes the depth test.
+    void Clear(uint8_t r, uint8_t g, uint8_t b);
+    void Clear(ClearFlags flags, uint8_t r, uint8_t g, uint8_t b, float depth = std::numeric_limits<float>::infinity());
+
+    // Arrays of Vertex structures are converted to a VertexBuffer
+    // for every draw, so keep a VertexBuffer around instead when possible.
+    void DrawTriangleList(const std::vector<Vertex>& vertices);
+    void DrawTriangleList(const VertexBuffer& vertices);
+
+    // Each group of three indices is a triangle. A vertex shared by several
+    // triangles is only transformed (and tested against the clipping planes)
+    // once per draw.
+    void DrawIndexedTriangles(const std::vector<Vertex>& vertices, const std::vector<uint16_t>& indices);
+    void DrawIndexedTriangles(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+    void DrawIndexedTriangles(const VertexBuffer& vertices, const std::vector<uint16_t>& indices);
+    void DrawIndexedTriangles(const VertexBuffer& vertices, const std::vector<uint32_t>& indices);
+
+    // Draws the vertices once for each instance matrix, which goes after the
+    // view-model matrix. The result is exactly what drawing each instance on
+    // its own, in order, with SetViewModelMatrix(viewModel * instance) would
+    // give, but every vertex is transformed for every instance, and the setup
+    // is done once. Instances are transformed a group at a time, in parallel.
+    void DrawTriangleListInstanced(const VertexBuffer& vertices, const std::vector<glm::mat4>& instanceMatrices);
+    void DrawIndexedTrianglesInstanced(const VertexBuffer& vertices, const std::vector<uint16_t>& indices, const std::vector<glm::mat4>& instanceMatrices);
+    void DrawIndexedTrianglesInstanced(const VertexBuffer& vertices, const std::vector<uint32_t>& indices, const std::vector<glm::mat4>& instanceMatrices);
+
+    void SetProjectionMatrix(const glm::mat4& value);
+    void SetViewModelMatrix(const glm::mat4& value);
+
+    // Back faces are culled by default. Faces which are kept are drawn
+    // either way round.
+    void SetFrontFace(FrontFace value);
+    void SetCullMode(CullMode value);
+
+    // Raster state for the draws which follow. Command buffers record their
+    // own. Each draw picks per-pixel loops built for just its state, so
+    // untextured or depth-only draws don't test for texturing, and so on, at
+    // every pixel. Turning off the depth test, depth writes or color writes
+    // needs ShadingMode::Forward. Otherwise they stay on, and the setter
+    // returns false. Submit does the same with what was recorded.
+    bool SetDepthTest(bool value);
+    bool SetDepthWrite(bool value);
+    bool SetColorWrite(bool value);
+    void SetColorSource(ColorSource value);
+    void SetBlendMode(BlendMode value);
+
+    uint32_t CreateTexture();
+    // pData holds width * height texels in the given format, row by row.
+    // The layout only changes how they are kept in memory. A mip chain
+    // is built here, once, and sampled with the sampler's mip filter.
+    void UpdateTexture(
+        uint32_t id, uint32_t width, uint32_t height, const uint8_t* pData,
+        TextureFormat format = TextureFormat::RGBA8, TextureLayout layout = TextureLayout::Linear,
+        bool buildMipChain = false
+    );
+    void DestroyTexture(uint32_t id);
+    void UseTexture(uint32_t id);
+
+    // Samplers say how the texture in use is addressed and filtered. They
+    // can't be changed once created. Sampler 0 is SamplerState's defaults.
+    uint32_t CreateSampler(const SamplerState& state);
+    void UseSampler(uint32_t id);
+
+    // Draws everything recorded in the command buffer, each with the state it
+    // was recorded with, optionally reordered. The renderer's own state is
+    // left as it was. Draws marked as inside the frustum skip clipping.
+    void Submit(const CommandBuffer& commands, const SubmitOptions& options = {});
+
+    // Draws are binned into screen tiles and rasterized later, all at once.
+    // This waits until everything drawn so far is in the framebuffer.
+    void Flush();
+
+    // Present finishes the frame, queues it for the present function (which
+    // runs on a thread of its own) and moves on to the next buffer of the
+    // swap chain, waiting for it first if it's still queued. The new buffer
+    // still holds an old frame, so start each frame with a Clear. Returns the
+    // finished frame's pixels, which stay as they are until the swap chain
+    // comes round to their buffer again.
+    void SetPresentFunction(const Presenter::PresentFunction& func);
+    const uint8_t* Present();
+    PresentStats GetPresentStats() const;
+
+    // The buffer being drawn into, as RGBA8. Other color formats are
+    // converted into a buffer of their own first.
+    // TODO: Is this a part of the real API? Would be almost
+    // impossible in hardware, but easy on any simulated version.
+    const uint8_t* GetFramebufferPointer();
+
+    // Counts for everything drawn since the last Clear.
+    RasterStats GetRasterStats() const;
+    PipelineStats GetPipelineStats() const;
+    VertexCacheStats GetVertexCacheStats() const;
+
+    // Scratch memory for one draw at a time (converted and transformed
+    // vertices), and for the triangles binned until the next Flush.
+    ScratchArenaStats GetDrawArenaStats() const;
+    ScratchArenaStats GetFrameArenaStats() const;
+
+private:
+
+    static constexpr uint32_t TILE_SIZE = 64;
+    static_assert(TILE_SIZE <= RASTER_SPAN_MAX, "A tile row must fit in one raster span");
+
+    // Instances are transformed in groups of about this many vertices, so that
+    // a group is still in the cache when its triangles are put together.
+    static constexpr uint32_t INSTANCE_GROUP_VERTICES = 4096;
+
+    static constexpr uint32_t BLOCK_SIZE = 8;
+    static constexpr uint32_t QUAD_SIZE = 2;
+    static_assert(BLOCK_SIZE == RASTER_GROUP_SIZE, "Blocks must line up with the raster kernel's pixel groups");
+
+    struct PixelPipeline;
+
+    // A triangle in raster space waiting in the tile bins.
+    struct RasterTriangle
+    {
+        // Divided by w, so multiply by a pixel's depth to use them.
+        // Ones past the vertex buffer's varyings are 0.
+        AttributePlanes<VERTEX_MAX_VARYINGS> varyings;
+
+        // Only the ones for the renderer's raster mode are set up.
+        TriangleEdges edges;
+        FixedTriangleEdges fixedEdges;
+
+        // Inclusive pixel bounds, already clamped to the framebuffer.
+        uint32_t xmin;
+        uint32_t xmax;
+        uint32_t ymin;
+        uint32_t ymax;
+
+        // Where it is in m_BinnedTriangles, plus one,
+        // so that a visibility ID of 0 means no triangle.
+        uint32_t id;
+
+        uint32_t textureID;
+        SamplerState sampler;
+        SampleQuadFunction sampleQuad;
+        glm::vec3 debugColor;
+
+        // Picked for the draw it came from.
+        const PixelPipeline* pPipeline;
+    };
+
+    // The per-pixel loops for one combination of raster state. The state is a
+    // template argument of each loop, so they have no branches on it. States
+    // which draw the same way share loops; see GetPixelPipeline.
+    template <typename Edges>
+    using RasterizeFunction = void (SoftwareRenderer::*)(
+        const RasterTriangle& triangle, const Edges& edges, uint32_t xmin, uint32_t xmax, uint32_t ymin, uint32_t ymax,
+        RasterStats& rStats, PipelineStats& rPipelineStats
+    );
+    using ShadeFunction = uint32_t (SoftwareRenderer::*)(
+        const RasterTriangle& triangle, const RasterSpan spans[], uint32_t spanX, uint32_t y,
+        const uint64_t coverage[], const Texture* pLodTexture
+    );
+    struct PixelPipeline
+    {
+        uint32_t state;
+        RasterizeFunction<TriangleEdges> rasterize;
+        RasterizeFunction<FixedTriangleEdges> rasterizeFixed;
+
+        // Shades pixels as they are rasterized. Null if nothing needs to be.
+        ShadeFunction shade;
+
+        // Shades what's left in the visibility buffer, for ShadingMode::VisibilityBuffer.
+        ShadeFunction resolve;
+    };
+
+    // The order Submit draws things in. Sorted by each field in turn.
+    struct SubmitKey
+    {
+        bool alphaTest;
+        uint32_t textureID;
+        uint32_t samplerID;
+        float depth;
+        uint32_t drawIndex;
+    };
+
+    typedef uint32_t (SoftwareRenderer::*AssembleTriangleFunction)(const VertexStreams& vertices, uint32_t i0, uint32_t i1, uint32_t i2);
+
+    // TODO: Fix naming issue
+    template <uint32_t N>
+    void RenderTriangle(ClipVertex<N>& v0, ClipVertex<N>& v1, ClipVertex<N>& v2);
+    template <uint32_t N>
+    uint32_t ClipTriangle(const ClipVertex<N>& v0, const ClipVertex<N>& v1, const ClipVertex<N>& v2, uint8_t outcodes);
+    void DrawTriangles(const VertexStreams& vertices);
+    template <typename Index>
+    void DrawIndexed(const VertexStreams& vertices, const std::vector<Index>& indices);
+    template <typename AssembleFunction>
+    void DrawInstances(const VertexStreams& vertices, const std::vector<glm::mat4>& instanceMatrices, const AssembleFunction& assemble);
+    VertexStreams ConvertVertices(const std::vector<Vertex>& vertices);
+    void PrepareVertexCache(const VertexStreams& vertices);
+    void TransformBatches(const VertexStreams& vertices, const glm::mat4& transformMatrix, uint32_t firstBatch, uint32_t batchCount);
+    void TransformVertices(
+        const VertexStreams& vertices, const glm::mat4& transformMatrix, uint32_t first, uint32_t count,
+        float* const pClipPositions[4], uint8_t* pClipOutcodes
+    ) const;
+    uint32_t AssembleTriangle(const VertexStreams& vertices, uint32_t i0, uint32_t i1, uint32_t i2);
+    template <uint32_t N>
+    uint32_t AssembleTriangle(const VertexStreams& vertices, uint32_t i0, uint32_t i1, uint32_t i2);
+    template <size_t... Counts>
+    static std::array<AssembleTriangleFunction, sizeof...(Counts)> MakeAssembleFunctions(std::index_sequence<Counts...>);
+    bool CullTriangle(uint32_t i0, uint32_t i1, uint32_t i2);
+    bool IsFaceCulled(float area) const;
+    glm::vec2 ViewportTransform(float x, float y) const;
+    void DiscardBins();
+    void ClearTile(uint32_t tileIndex, ClearFlags flags);
+    void ClearRect(ClearFlags flags, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+    void RasterizeTile(uint32_t tileIndex, RasterStats& rStats, PipelineStats& rPipelineStats);
+    template <typename Edges, uint32_t State>
+    void RasterizeTriangle(
+        const RasterTriangle& triangle, const Edges& edges, uint32_t xmin, uint32_t xmax, uint32_t ymin, uint32_t ymax,
+        RasterStats& rStats, PipelineStats& rPipelineStats
+    );
+    void RasterizeRow(const TriangleEdges& edges, uint32_t x, uint32_t y, uint64_t activeMask, RasterSpan& rSpan) const;
+    void RasterizeRow(const FixedTriangleEdges& edges, uint32_t x, uint32_t y, uint64_t activeMask, RasterSpan& rSpan) const;
+    template <uint32_t State>
+    uint32_t ShadeQuads(
+        const RasterTriangle& triangle, const RasterSpan spans[], uint32_t spanX, uint32_t y,
+        const uint64_t coverage[], const Texture* pLodTexture
+    );
+    void ResolveTile(uint32_t tileIndex, RasterStats& rStats, PipelineStats& rPipelineStats);
+    template <typename Edges>
+    void ResolveTriangle(const RasterTriangle& triangle, const Edges& edges, uint32_t spanX, uint32_t y, const uint64_t visible[], RasterStats& rStats, PipelineStats& rPipelineStats);
+    void UpdateHiZ(uint32_t blockX, uint32_t blockY);
+    void StoreColor(uint32_t pixelIndex, const glm::vec3& color);
+    const uint8_t* GetDisplayPointer() const;
+    template <uint32_t State>
+    bool ShadePixel(const RasterTriangle& triangle, uint32_t x, uint32_t y, const float varyings[VERTEX_MAX_VARYINGS], float depth, const glm::vec4& texel);
+    template <uint32_t State>
+    static PixelPipeline MakePixelPipeline();
+    template <size_t... States>
+    static std::array<PixelPipeline, sizeof...(States)> MakePixelPipelines(std::index_sequence<States...>);
+    static const PixelPipeline& GetPixelPipeline(uint32_t state);
+    void SelectPixelPipeline();
+
+    Texture& GetTexture(uint32_t id);
+    const Texture* GetLodTexture(const RasterTriangle& triangle);
+
+
+    const uint32_t m_FrameWidth;
+    const uint32_t m_FrameHeight;
+    const RasterMode m_RasterMode;
+    const int m_SubpixelBits;
+    const ShadingMode m_ShadingMode;
+
+    // Drawing goes into m_pFramebuffer, one of the swap chain's buffers.
+    const TextureFormat m_ColorFormat;
+    const uint32_t m_ColorSize;
+    std::vector<std::vector<uint8_t>> m_SwapChain;
+    uint32_t m_BackBufferIndex;
+    uint8_t* m_pFramebuffer;
+
+    // Unless the color format is RGBA8, each buffer of the
+    // swap chain is converted into one of these to be read.
+    std::vector<std::vector<uint8_t>> m_DisplayBuffers;
+
+    // Declared after the swap chain, so that it stops before the buffers go.
+    std::unique_ptr<Presenter> m_pPresenter;
+    double m_PresentWaitMilliseconds;
+
+    // In m_DepthFormat, m_DepthSize bytes a pixel. For the integer
+    // formats, m_DepthScale is the depth stored for a w of 1.
+    const DepthFormat m_DepthFormat;
+    const uint32_t m_DepthSize;
+    const float m_DepthScale;
+    std::vector<uint8_t> m_DepthBuffer;
+
+    // The farthest depth (as w) in each BLOCK_SIZE square of the depth buffer.
+    const uint32_t m_BlocksWide;
+    const uint32_t m_BlocksHigh;
+    std::vector<float> m_HiZBuffer;
+
+    // For ShadingMode::VisibilityBuffer, the ID of the triangle each pixel
+    // is waiting to be shaded with. Only used while flushing.
+    std::vector<uint32_t> m_VisibilityBuffer;
+
+    const uint32_t m_TilesWide;
+    const uint32_t m_TilesHigh;
+    ScratchArena m_FrameArena;
+    std::vector<const RasterTriangle*> m_BinnedTriangles;
+    std::vector<ScratchList<const RasterTriangle*>> m_TileBins;
+
+    // The buffers each tile still has to clear, and what to clear them to.
+    const bool m_LazyClears;
+    std::vector<ClearFlags> m_PendingClears;
+    uint8_t m_ClearColor[4];
+    float m_ClearDepth;
+    ThreadPool m_ThreadPool;
+    RasterRowFunction m_RasterRow;
+
+    // One per thread, so that they can be updated without locking.
+    std::vector<RasterStats> m_ThreadRasterStats;
+    std::vector<PipelineStats> m_ThreadPipelineStats;
+
+    // The stages run on the thread which draws.
+    PipelineStats m_PipelineStats;
+    uint32_t m_FrameTriangleCount;
+
+    // Post-transform vertex cache for the current draw, by vertex index, in
+    // the draw arena. Vertices are transformed a batch at a time. Indexed
+    // draws fill it as they go, others all at once.
+    TransformFunction m_TransformPositions;
+    ScratchArena m_DrawArena;
+    float* m_pClipPositions[4];
+    uint8_t* m_pClipOutcodes;
+    bool* m_pTransformedBatches;
+
+    // Set by Submit for draws the scene found entirely inside the view volume.
+    bool m_DrawInsideFrustum;
+    VertexCacheStats m_VertexCacheStats;
+
+    std::vector<Texture> m_Textures;
+    uint32_t m_ActiveTextureID;
+    std::vector<SamplerState> m_Samplers;
+    SamplerState m_ActiveSampler;
+
+    glm::mat4 m_ProjectionMatrix;
+    glm::mat4 m_ViewModelMatrix;
+    FrontFace m_FrontFace;
+    CullMode m_CullMode;
+    bool m_DepthTest;
+    bool m_DepthWrite;
+    bool m_ColorWrite;
+    ColorSource m_ColorSource;
+    BlendMode m_BlendMode;
+
+    // For the draw going on now. The sampler is null without a texture.
+    const PixelPipeline* m_pDrawPipeline;
+    SampleQuadFunction m_DrawSampleQuad;
+
+    // Kept between calls to Submit, so that it doesn't allocate every time.
+    std::vector<SubmitKey> m_SubmitKeys;
+
+};
+
+
+
+
+#endif
@@ -0,0 +1,475 @@
+
+#include <cassert>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "Texture.hpp"
+
+
+// Writes a color (red, green, blue, alpha from 0 to 1) as one texel.
+static void EncodeTexel(TextureFormat format, const glm::vec4& color, uint8_t* pTexel)
+{
+    switch (format)
+    {
+    case TextureFormat::RGBA8:
+        pTexel[0] = QuantizeUnorm(color.b, 0xff);
+        pTexel[1] = QuantizeUnorm(color.g, 0xff);
+        pTexel[2] = QuantizeUnorm(color.r, 0xff);
+        pTexel[3] = QuantizeUnorm(color.a, 0xff);
+        break;
+
+    case TextureFormat::RGB565:
+    {
+        const uint16_t texel = (QuantizeUnorm(color.r, 31) << 11) | (QuantizeUnorm(color.g, 63) << 5) | QuantizeUnorm(color.b, 31);
+        memcpy(pTexel, &texel, sizeof(texel));
+        break;
+    }
+
+    case TextureFormat::RGB666:
+    {
+        const uint32_t texel = (QuantizeUnorm(color.r, 63) << 12) | (QuantizeUnorm(color.g, 63) << 6) | QuantizeUnorm(color.b, 63);
+        pTexel[0] = texel & 0xff;
+        pTexel[1] = (texel >> 8) & 0xff;
+        pTexel[2] = (texel >> 16) & 0xff;
+        break;
+    }
+    }
+}
+
+
+void StoreTexels(Texture& rTexture, uint32_t width, uint32_t height, const uint8_t* pTexels, bool buildMipChain)
+{
+    rTexture.width = width;
+    rTexture.height = height;
+
+    // Tiled levels are padded out to whole tiles.
+    const uint32_t texelSize = GetTexelSize(rTexture.format);
+    const uint32_t padding = rTexture.layout == TextureLayout::Tiled ? TEXTURE_TILE_SIZE - 1 : 0;
+    uint32_t size = 0;
+
+    rTexture.levelCount = 0;
+    do
+    {
+        assert(rTexture.levelCount < TEXTURE_MAX_LEVELS);
+        TextureLevel& rLevel = rTexture.levels[rTexture.levelCount++];
+        rLevel.width = width;
+        rLevel.height = height;
+        rLevel.offset = size;
+        size += ((width + padding) & ~padding) * ((height + padding) & ~padding) * texelSize;
+
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+    while (buildMipChain && (rTexture.levels[rTexture.levelCount - 1].width > 1 || rTexture.levels[rTexture.levelCount - 1].height > 1));
+
+    rTexture.data.assign(size, 0);
+    if (rTexture.layout == TextureLayout::Linear)
+    {
+        memcpy(rTexture.data.data(), pTexels, rTexture.width * rTexture.height * texelSize);
+    }
+    else
+    {
+        for (uint32_t y = 0; y < rTexture.height; y++)
+        {
+            for (uint32_t x = 0; x < rTexture.width; x++)
+            {
+                memcpy(
+                    &rTexture.data[GetTexelIndex(rTexture, 0, x, y) * texelSize],
+                    &pTexels[(y * rTexture.width + x) * texelSize],
+                    texelSize
+                );
+            }
+        }
+    }
+
+    // Each texel is the average of the 2x2 texels it covers in the level
+    // above. A level with an odd size repeats its last row or column.
+    for (uint32_t level = 1; level < rTexture.levelCount; level++)
+    {
+        const TextureLevel& rSource = rTexture.levels[level - 1];
+        const TextureLevel& rLevel = rTexture.levels[level];
+        for (uint32_t y = 0; y < rLevel.height; y++)
+        {
+            const uint32_t y0 = std::min(2 * y, rSource.height - 1);
+            const uint32_t y1 = std::min(2 * y + 1, rSource.height - 1);
+            for (uint32_t x = 0; x < rLevel.width; x++)
+            {
+                const uint32_t x0 = std::min(2 * x, rSource.width - 1);
+                const uint32_t x1 = std::min(2 * x + 1, rSource.width - 1);
+                const glm::vec4 color = 0.25f * (
+                    FetchTexel(rTexture, level - 1, x0, y0) +
+                    FetchTexel(rTexture, level - 1, x1, y0) +
+                    FetchTexel(rTexture, level - 1, x0, y1) +
+                    FetchTexel(rTexture, level - 1, x1, y1)
+                );
+                EncodeTexel(rTexture.format, color, &rTexture.data[rLevel.offset + GetTexelIndex(rTexture, level, x, y) * texelSize]);
+            }
+        }
+    }
+
+    rTexture.minAlpha = 1.0f;
+    if (rTexture.format == TextureFormat::RGBA8)
+    {
+        for (uint32_t level = 0; level < rTexture.levelCount; level++)
+        {
+            for (uint32_t y = 0; y < rTexture.levels[level].height; y++)
+            {
+                for (uint32_t x = 0; x < rTexture.levels[level].width; x++)
+                {
+                    rTexture.minAlpha = std::min(rTexture.minAlpha, FetchTexel(rTexture, level, x, y).a);
+                }
+            }
+        }
+    }
+}
+
+
+void ConvertTexels(const uint8_t* pBGRA, uint32_t count, TextureFormat format, uint8_t* pTexels)
+{
+    // Rounds an 8 bit channel to the nearest n bit value.
+    auto quantize = [](uint8_t value, uint32_t maximum) -> uint32_t {
+        return (value * maximum + 127) / 255;
+    };
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const uint8_t* pSource = &pBGRA[i * 4];
+        switch (format)
+        {
+        case TextureFormat::RGBA8:
+            memcpy(&pTexels[i * 4], pSource, 4);
+            break;
+
+        case TextureFormat::RGB565:
+        {
+            const uint16_t texel =
+                (quantize(pSource[2], 31) << 11) |
+                (quantize(pSource[1], 63) << 5) |
+                quantize(pSource[0], 31);
+            memcpy(&pTexels[i * 2], &texel, sizeof(texel));
+            break;
+        }
+
+        case TextureFormat::RGB666:
+        {
+            const uint32_t texel =
+                (quantize(pSource[2], 63) << 12) |
+                (quantize(pSource[1], 63) << 6) |
+                quantize(pSource[0], 63);
+            pTexels[i * 3 + 0] = texel & 0xff;
+            pTexels[i * 3 + 1] = (texel >> 8) & 0xff;
+            pTexels[i * 3 + 2] = (texel >> 16) & 0xff;
+            break;
+        }
+        }
+    }
+}
+
+
+void ConvertTexelsToBGRA(const uint8_t* pTexels, uint32_t count, TextureFormat format, uint8_t* pBGRA)
+{
+    // Widens an n bit channel to 8 bits.
+    auto expand = [](uint32_t value, uint32_t maximum) -> uint8_t {
+        return static_cast<uint8_t>((value * 255 + maximum / 2) / maximum);
+    };
+
+    switch (format)
+    {
+    case TextureFormat::RGBA8:
+        memcpy(pBGRA, pTexels, static_cast<size_t>(count) * 4);
+        break;
+
+    case TextureFormat::RGB565:
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint16_t texel;
+            memcpy(&texel, &pTexels[i * 2], sizeof(texel));
+            pBGRA[i * 4 + 0] = expand(texel & 0x1f, 31);
+            pBGRA[i * 4 + 1] = expand((texel >> 5) & 0x3f, 63);
+            pBGRA[i * 4 + 2] = expand(texel >> 11, 31);
+            pBGRA[i * 4 + 3] = 0xff;
+        }
+        break;
+
+    case TextureFormat::RGB666:
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const uint8_t* pTexel = &pTexels[i * 3];
+            const uint32_t texel = pTexel[0] | (pTexel[1] << 8) | (pTexel[2] << 16);
+            pBGRA[i * 4 + 0] = expand(texel & 0x3f, 63);
+            pBGRA[i * 4 + 1] = expand((texel >> 6) & 0x3f, 63);
+            pBGRA[i * 4 + 2] = expand((texel >> 12) & 0x3f, 63);
+            pBGRA[i * 4 + 3] = 0xff;
+        }
+        break;
+    }
+}
+
+
+float ComputeTextureLod(const Texture& texture, const glm::vec2& texcoordsDx, const glm::vec2& texcoordsDy)
+{
+    // The longer of the two steps, in base level texels.
+    const glm::vec2 size { static_cast<float>(texture.width), static_cast<float>(texture.height) };
+    const float lengthSquared = std::max(glm::dot(texcoordsDx * size, texcoordsDx * size), glm::dot(texcoordsDy * size, texcoordsDy * size));
+    return 0.5f * std::log2(lengthSquared);
+}
+
+
+// Rounds down, without a call into the C library. Defined for any value:
+// beyond 2^30 texels a float can't say where in the texture it is anyway.
+// SSE2's conversion gives INT32_MIN for those, and for NaN, and otherwise
+// they're clamped first, so that the cast is defined.
+static int32_t FloorToInt(float value)
+{
+#if defined(__SSE2__)
+    const int32_t truncated = _mm_cvttss_si32(_mm_set_ss(value));
+#else
+    const float limit = static_cast<float>(1 << 30);
+    value = std::min(std::max(-limit, value), limit);
+    const int32_t truncated = static_cast<int32_t>(value);
+#endif
+    // Unsigned, so that INT32_MIN less one wraps around.
+    return static_cast<int32_t>(static_cast<uint32_t>(truncated) - (value < static_cast<float>(truncated)));
+}
+
+
+// Brings a texel coordinate into [0, size). Power of two sizes,
+// which mipmapped textures usually are, only need a mask.
+template <TextureWrap Wrap>
+static uint32_t WrapCoordinate(int32_t coordinate, uint32_t size)
+{
+    const bool powerOfTwo = (size & (size - 1)) == 0;
+    if (Wrap == TextureWrap::ClampToEdge)
+    {
+        return std::clamp(coordinate, 0, static_cast<int32_t>(size) - 1);
+    }
+    else if (Wrap == TextureWrap::MirroredRepeat)
+    {
+        // Every other copy runs backwards: 0 1 2 3 3 2 1 0 0 1 ...
+        const uint32_t period = 2 * size;
+        uint32_t position;
+        if (powerOfTwo)
+        {
+            position = static_cast<uint32_t>(coordinate) & (period - 1);
+        }
+        else
+        {
+            const int32_t remainder = coordinate % static_cast<int32_t>(period);
+            position = remainder < 0 ? remainder + period : remainder;
+        }
+        return position < size ? position : period - 1 - position;
+    }
+    else
+    {
+        if (powerOfTwo)
+        {
+            return static_cast<uint32_t>(coordinate) & (size - 1);
+        }
+        const int32_t remainder = coordinate % static_cast<int32_t>(size);
+        return remainder < 0 ? remainder + size : remainder;
+    }
+}
+
+
+// Blends texels (x0, y0), (x1, y0), (x0, y1) and (x1, y1) of a level,
+// weighting the second column by fx and the second row by fy.
+template <TextureFormat Format, TextureLayout Layout>
+static glm::vec4 BlendTexels(const Texture& texture, uint32_t level, uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1, float fx, float fy)
+{
+#if defined(__SSE2__)
+    // All four texels in one register when they're RGBA8.
+    if (Format == TextureFormat::RGBA8)
+    {
+        // Each texel is then widened to a float vector of its own.
+        uint32_t texels[4];
+        memcpy(&texels[0], GetTexelPointer<Format, Layout>(texture, level, x0, y0), 4);
+        memcpy(&texels[1], GetTexelPointer<Format, Layout>(texture, level, x1, y0), 4);
+        memcpy(&texels[2], GetTexelPointer<Format, Layout>(texture, level, x0, y1), 4);
+        memcpy(&texels[3], GetTexelPointer<Format, Layout>(texture, level, x1, y1), 4);
+        const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(texels));
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i top = _mm_unpacklo_epi8(packed, zero);
+        const __m128i bottom = _mm_unpackhi_epi8(packed, zero);
+        const __m128 c00 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(top, zero));
+        const __m128 c10 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(top, zero));
+        const __m128 c01 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(bottom, zero));
+        const __m128 c11 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(bottom, zero));
+
+        const __m128 weightX = _mm_set1_ps(fx);
+        const __m128 weightY = _mm_set1_ps(fy);
+        const __m128 row0 = _mm_add_ps(c00, _mm_mul_ps(_mm_sub_ps(c10, c00), weightX));
+        const __m128 row1 = _mm_add_ps(c01, _mm_mul_ps(_mm_sub_ps(c11, c01), weightX));
+        __m128 color = _mm_add_ps(row0, _mm_mul_ps(_mm_sub_ps(row1, row0), weightY));
+        color = _mm_mul_ps(color, _mm_set1_ps(1.0f / 255.0f));
+
+        // Blue, green, red, alpha to red, green, blue, alpha.
+        color = _mm_shuffle_ps(color, color, _MM_SHUFFLE(3, 0, 1, 2));
+        glm::vec4 result;
+        _mm_storeu_ps(&result.x, color);
+        return result;
+    }
+#endif
+
+    const glm::vec4 row0 = glm::mix(FetchTexel<Format, Layout>(texture, level, x0, y0), FetchTexel<Format, Layout>(texture, level, x1, y0), fx);
+    const glm::vec4 row1 = glm::mix(FetchTexel<Format, Layout>(texture, level, x0, y1), FetchTexel<Format, Layout>(texture, level, x1, y1), fx);
+    return glm::mix(row0, row1, fy);
+}
+
+
+// Samples one level of a texture, for the pixels of a quad set in mask.
+template <TextureFilter Filter, TextureWrap WrapU, TextureWrap WrapV, TextureFormat Format, TextureLayout Layout>
+static void SampleLevel(const Texture& texture, uint32_t level, const glm::vec2 texcoords[], uint32_t mask, glm::vec4 texels[])
+{
+    const TextureLevel& rLevel = texture.levels[level];
+    const float width = static_cast<float>(rLevel.width);
+    const float height = static_cast<float>(rLevel.height);
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        if (((mask >> i) & 1) == 0)
+        {
+            continue;
+        }
+
+        // In texels, from the top left corner, since rows are stored top first.
+        const float x = texcoords[i].x * width;
+        const float y = (1.0f - texcoords[i].y) * height;
+
+        if (Filter == TextureFilter::Nearest)
+        {
+            texels[i] = FetchTexel<Format, Layout>(
+                texture, level,
+                WrapCoordinate<WrapU>(FloorToInt(x), rLevel.width),
+                WrapCoordinate<WrapV>(FloorToInt(y), rLevel.height)
+            );
+            continue;
+        }
+
+        // Texel centers are halfway between whole coordinates.
+        const float left = x - 0.5f;
+        const float top = y - 0.5f;
+        const int32_t x0 = FloorToInt(left);
+        const int32_t y0 = FloorToInt(top);
+        texels[i] = BlendTexels<Format, Layout>(
+            texture, level,
+            WrapCoordinate<WrapU>(x0, rLevel.width),
+            WrapCoordinate<WrapU>(x0 + 1, rLevel.width),
+            WrapCoordinate<WrapV>(y0, rLevel.height),
+            WrapCoordinate<WrapV>(y0 + 1, rLevel.height),
+            left - static_cast<float>(x0),
+            top - static_cast<float>(y0)
+        );
+    }
+}
+
+
+// The level to sample for a level of detail, and how much of the next one to
+// blend in. Magnified, or no mip chain to pick from, samples the base level.
+// The comparison is false for a NaN lod, too.
+static uint32_t PickLevel(const Texture& texture, const SamplerState& sampler, float lod, float& rBlend)
+{
+    rBlend = 0.0f;
+    if (sampler.mipFilter == MipFilter::None || texture.levelCount <= 1 || !(lod > 0.0f))
+    {
+        return 0;
+    }
+
+    lod = std::min(lod, static_cast<float>(texture.levelCount - 1));
+    if (sampler.mipFilter == MipFilter::Nearest)
+    {
+        return static_cast<uint32_t>(lod + 0.5f);
+    }
+    const uint32_t level = static_cast<uint32_t>(lod);
+    rBlend = lod - static_cast<float>(level);
+    return level;
+}
+
+
+// A SampleQuadFunction for one filter, pair of wrap modes, format and layout.
+template <TextureFilter Filter, TextureWrap WrapU, TextureWrap WrapV, TextureFormat Format, TextureLayout Layout>
+static void SampleQuad(const Texture& texture, const SamplerState& sampler, const glm::vec2 texcoords[], float lod, uint32_t mask, glm::vec4 texels[])
+{
+    float blend;
+    const uint32_t level = PickLevel(texture, sampler, lod, blend);
+    SampleLevel<Filter, WrapU, WrapV, Format, Layout>(texture, level, texcoords, mask, texels);
+    if (blend > 0.0f)
+    {
+        glm::vec4 nextTexels[4];
+        SampleLevel<Filter, WrapU, WrapV, Format, Layout>(texture, level + 1, texcoords, mask, nextTexels);
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            if ((mask >> i) & 1)
+            {
+                texels[i] = glm::mix(texels[i], nextTexels[i], blend);
+            }
+        }
+    }
+}
+
+
+// Picks the SampleQuad for a texture and sampler one
+// template argument at a time, from the last one back.
+template <TextureFilter Filter, TextureWrap WrapU, TextureWrap WrapV, TextureFormat Format>
+static SampleQuadFunction GetSampleQuadFunction(const Texture& texture, const SamplerState&)
+{
+    if (texture.layout == TextureLayout::Linear)
+    {
+        return SampleQuad<Filter, WrapU, WrapV, Format, TextureLayout::Linear>;
+    }
+    return SampleQuad<Filter, WrapU, WrapV, Format, TextureLayout::Tiled>;
+}
+
+template <TextureFilter Filter, TextureWrap WrapU, TextureWrap WrapV>
+static SampleQuadFunction GetSampleQuadFunction(const Texture& texture, const SamplerState& sampler)
+{
+    switch (texture.format)
+    {
+    case TextureFormat::RGB565: return GetSampleQuadFunction<Filter, WrapU, WrapV, TextureFormat::RGB565>(texture, sampler);
+    case TextureFormat::RGB666: return GetSampleQuadFunction<Filter, WrapU, WrapV, TextureFormat::RGB666>(texture, sampler);
+    case TextureFormat::RGBA8:
+    default: return GetSampleQuadFunction<Filter, WrapU, WrapV, TextureFormat::RGBA8>(texture, sampler);
+    }
+}
+
+template <TextureFilter Filter, TextureWrap WrapU>
+static SampleQuadFunction GetSampleQuadFunction(const Texture& texture, const SamplerState& sampler)
+{
+    switch (sampler.wrapV)
+    {
+    case TextureWrap::MirroredRepeat: return GetSampleQuadFunction<Filter, WrapU, TextureWrap::MirroredRepeat>(texture, sampler);
+    case TextureWrap::ClampToEdge: return GetSampleQuadFunction<Filter, WrapU, TextureWrap::ClampToEdge>(texture, sampler);
+    case TextureWrap::Repeat:
+    default: return GetSampleQuadFunction<Filter, WrapU, TextureWrap::Repeat>(texture, sampler);
+    }
+}
+
+template <TextureFilter Filter>
+static SampleQuadFunction GetSampleQuadFunction(const Texture& texture, const SamplerState& sampler)
+{
+    switch (sampler.wrapU)
+    {
+    case TextureWrap::MirroredRepeat: return GetSampleQuadFunction<Filter, TextureWrap::MirroredRepeat>(texture, sampler);
+    case TextureWrap::ClampToEdge: return GetSampleQuadFunction<Filter, TextureWrap::ClampToEdge>(texture, sampler);
+    case TextureWrap::Repeat:
+    default: return GetSampleQuadFunction<Filter, TextureWrap::Repeat>(texture, sampler);
+    }
+}
+
+SampleQuadFunction GetSampleQuadFunction(const Texture& texture, const SamplerState& sampler)
+{
+    if (sampler.filter == TextureFilter::Nearest)
+    {
+        return GetSampleQuadFunction<TextureFilter::Nearest>(texture, sampler);
+    }
+    return GetSampleQuadFunction<TextureFilter::Bilinear>(texture, sampler);
+}
+
+
+glm::vec4 SampleTexture(const Texture& texture, const SamplerState& sampler, const glm::vec2& texcoords, float lod)
+{
+    glm::vec4 texel;
+    GetSampleQuadFunction(texture, sampler)(texture, sampler, &texcoords, lod, 1, &texel);
+    return texel;
+}
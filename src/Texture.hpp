@@ -0,0 +1,300 @@
+
+#ifndef TEXTURE_HPP
+#define TEXTURE_HPP
+
+#include <stdint.h>
+#include <string.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+
+// How texels are laid out in memory. Textures are kept in their own format,
+// and only turned into floats when they are sampled.
+enum class TextureFormat
+{
+    // 4 bytes per texel: blue, green, red and alpha, the same as the framebuffer.
+    RGBA8,
+
+    // 16 bit words: 5 bits of red at the top, then 6 of green and 5 of blue. Opaque.
+    RGB565,
+
+    // The hardware's 18 bit color: 6 bits each of red (at the top), green and
+    // blue, in the low bits of 3 bytes, least significant first. Opaque.
+    RGB666,
+};
+
+
+// Where each texel goes in memory.
+enum class TextureLayout
+{
+    // Row by row.
+    Linear,
+
+    // Square tiles of TEXTURE_TILE_SIZE texels, row by row, with the tiles
+    // themselves in rows. Texels next to each other in any direction are
+    // usually in the same cache line, so rotated and vertical spans sample
+    // much faster. The texture is padded out to whole tiles.
+    Tiled,
+};
+
+// An RGBA8 tile is 64 bytes, one cache line.
+const uint32_t TEXTURE_TILE_SIZE = 4;
+
+
+// How the level to sample is picked from the level of detail.
+enum class MipFilter
+{
+    // Always the base level.
+    None,
+
+    // The closest level.
+    Nearest,
+
+    // A blend of the two closest levels.
+    Linear,
+};
+
+// What happens to texture coordinates outside of 0 to 1.
+enum class TextureWrap
+{
+    Repeat,
+
+    // Repeats, flipping every other copy of the texture.
+    MirroredRepeat,
+
+    // Uses the texel at the nearest edge.
+    ClampToEdge,
+};
+
+
+// How a level is sampled.
+enum class TextureFilter
+{
+    // The texel the coordinates fall in.
+    Nearest,
+
+    // A blend of the 2x2 texels with centers closest to the coordinates.
+    Bilinear,
+};
+
+
+// How a texture is addressed and filtered. Separate from the
+// texture, so that one texture can be sampled different ways.
+struct SamplerState
+{
+    TextureWrap wrapU = TextureWrap::Repeat;
+    TextureWrap wrapV = TextureWrap::Repeat;
+    TextureFilter filter = TextureFilter::Nearest;
+    MipFilter mipFilter = MipFilter::Linear;
+};
+
+
+// Enough for a 32k texture.
+const uint32_t TEXTURE_MAX_LEVELS = 16;
+
+
+struct TextureLevel
+{
+    uint32_t width;
+    uint32_t height;
+
+    // Where the level's texels start in Texture::data, in bytes.
+    uint32_t offset;
+};
+
+
+struct Texture
+{
+    // Size of the base level.
+    uint32_t width;
+    uint32_t height;
+
+    TextureFormat format;
+    TextureLayout layout;
+
+    // Level 0 is the full size texture, and each one after
+    // it is half the size of the last, down to 1x1.
+    uint32_t levelCount;
+    TextureLevel levels[TEXTURE_MAX_LEVELS];
+
+    // The smallest alpha of any texel, in any level. Filtering only
+    // blends texels, so no sample can come out below it either.
+    float minAlpha;
+
+    std::vector<uint8_t> data;
+};
+
+
+constexpr uint32_t GetTexelSize(TextureFormat format)
+{
+    switch (format)
+    {
+    case TextureFormat::RGB565: return 2;
+    case TextureFormat::RGB666: return 3;
+    case TextureFormat::RGBA8:
+    default: return 4;
+    }
+}
+
+// Replaces the texture's texels with width * height of them in its format,
+// given row by row, and lays them out in memory for its layout. With a mip
+// chain, each smaller level is box filtered from the one before it.
+void StoreTexels(Texture& rTexture, uint32_t width, uint32_t height, const uint8_t* pTexels, bool buildMipChain);
+
+// Converts blue, green, red, alpha bytes to another format, rounding to the nearest value.
+void ConvertTexels(const uint8_t* pBGRA, uint32_t count, TextureFormat format, uint8_t* pTexels);
+
+// The other way, rounding each channel to the nearest byte.
+void ConvertTexelsToBGRA(const uint8_t* pTexels, uint32_t count, TextureFormat format, uint8_t* pBGRA);
+
+
+// Turns an n bit channel into a float from 0 to 1,
+// exactly as value / (2^n - 1) would.
+template <uint32_t Bits>
+constexpr std::array<float, 1 << Bits> MakeUnormTable()
+{
+    std::array<float, 1 << Bits> table {};
+    for (uint32_t i = 0; i < table.size(); i++)
+    {
+        table[i] = static_cast<float>(i) / static_cast<float>(table.size() - 1);
+    }
+    return table;
+}
+
+inline constexpr std::array<float, 32> UNORM5_TO_FLOAT = MakeUnormTable<5>();
+inline constexpr std::array<float, 64> UNORM6_TO_FLOAT = MakeUnormTable<6>();
+inline constexpr std::array<float, 256> UNORM8_TO_FLOAT = MakeUnormTable<8>();
+
+// The other way: a float clamped to 0 to 1 and rounded to the nearest
+// value from 0 to maximum.
+inline uint32_t QuantizeUnorm(float value, uint32_t maximum)
+{
+    return static_cast<uint32_t>(glm::clamp(value, 0.0f, 1.0f) * static_cast<float>(maximum) + 0.5f);
+}
+
+
+// Position of texel (x, y) in its level, counted in texels.
+template <TextureLayout Layout>
+inline uint32_t GetTexelIndex(const Texture& texture, uint32_t level, uint32_t x, uint32_t y)
+{
+    const uint32_t width = texture.levels[level].width;
+    if (Layout == TextureLayout::Linear)
+    {
+        return y * width + x;
+    }
+
+    static_assert((TEXTURE_TILE_SIZE & (TEXTURE_TILE_SIZE - 1)) == 0, "Tiles must be a power of two wide");
+    const uint32_t tileShift = __builtin_ctz(TEXTURE_TILE_SIZE);
+    const uint32_t tileMask = TEXTURE_TILE_SIZE - 1;
+    const uint32_t tilesWide = (width + tileMask) >> tileShift;
+
+    const uint32_t tile = (y >> tileShift) * tilesWide + (x >> tileShift);
+    return (tile << (2 * tileShift)) + ((y & tileMask) << tileShift) + (x & tileMask);
+}
+
+inline uint32_t GetTexelIndex(const Texture& texture, uint32_t level, uint32_t x, uint32_t y)
+{
+    return texture.layout == TextureLayout::Linear
+        ? GetTexelIndex<TextureLayout::Linear>(texture, level, x, y)
+        : GetTexelIndex<TextureLayout::Tiled>(texture, level, x, y);
+}
+
+
+template <TextureFormat Format, TextureLayout Layout>
+inline const uint8_t* GetTexelPointer(const Texture& texture, uint32_t level, uint32_t x, uint32_t y)
+{
+    const uint32_t index = GetTexelIndex<Layout>(texture, level, x, y);
+    return &texture.data[texture.levels[level].offset + index * GetTexelSize(Format)];
+}
+
+inline const uint8_t* GetTexelPointer(const Texture& texture, uint32_t level, uint32_t x, uint32_t y)
+{
+    const uint32_t index = GetTexelIndex(texture, level, x, y);
+    return &texture.data[texture.levels[level].offset + index * GetTexelSize(texture.format)];
+}
+
+
+// A texel in memory as red, green, blue and alpha from 0 to 1.
+template <TextureFormat Format>
+inline glm::vec4 DecodeTexel(const uint8_t* pTexel)
+{
+    if (Format == TextureFormat::RGB565)
+    {
+        uint16_t texel;
+        memcpy(&texel, pTexel, sizeof(texel));
+        return {
+            UNORM5_TO_FLOAT[texel >> 11],
+            UNORM6_TO_FLOAT[(texel >> 5) & 0x3f],
+            UNORM5_TO_FLOAT[texel & 0x1f],
+            1.0f
+        };
+    }
+    else if (Format == TextureFormat::RGB666)
+    {
+        const uint32_t texel = pTexel[0] | (pTexel[1] << 8) | (pTexel[2] << 16);
+        return {
+            UNORM6_TO_FLOAT[(texel >> 12) & 0x3f],
+            UNORM6_TO_FLOAT[(texel >> 6) & 0x3f],
+            UNORM6_TO_FLOAT[texel & 0x3f],
+            1.0f
+        };
+    }
+    else
+    {
+        return {
+            UNORM8_TO_FLOAT[pTexel[2]],
+            UNORM8_TO_FLOAT[pTexel[1]],
+            UNORM8_TO_FLOAT[pTexel[0]],
+            UNORM8_TO_FLOAT[pTexel[3]]
+        };
+    }
+}
+
+
+// The texel at (x, y) of a level as red, green, blue and alpha from 0 to 1.
+// The templated one is for code that has already picked the texture's
+// format and layout, and so has no branches on them.
+template <TextureFormat Format, TextureLayout Layout>
+inline glm::vec4 FetchTexel(const Texture& texture, uint32_t level, uint32_t x, uint32_t y)
+{
+    return DecodeTexel<Format>(GetTexelPointer<Format, Layout>(texture, level, x, y));
+}
+
+inline glm::vec4 FetchTexel(const Texture& texture, uint32_t level, uint32_t x, uint32_t y)
+{
+    const uint8_t* pTexel = GetTexelPointer(texture, level, x, y);
+    switch (texture.format)
+    {
+    case TextureFormat::RGB565: return DecodeTexel<TextureFormat::RGB565>(pTexel);
+    case TextureFormat::RGB666: return DecodeTexel<TextureFormat::RGB666>(pTexel);
+    case TextureFormat::RGBA8:
+    default: return DecodeTexel<TextureFormat::RGBA8>(pTexel);
+    }
+}
+
+
+// The level of detail for a pixel, from the change in texture
+// coordinates to the next pixel across and the next one down.
+float ComputeTextureLod(const Texture& texture, const glm::vec2& texcoordsDx, const glm::vec2& texcoordsDy);
+
+// Samples the texture at texcoords, where (0, 0) is the bottom left corner
+// of the texture and (1, 1) the top right, from the levels picked by the
+// sampler's mip filter.
+glm::vec4 SampleTexture(const Texture& texture, const SamplerState& sampler, const glm::vec2& texcoords, float lod);
+
+// Samples the pixels of a 2x2 quad set in mask, bit i for pixel i counting
+// row by row, writing texels[i] for texcoords[i]. All four share the level of
+// detail, as their derivatives do. The sampler's wrap modes and filter, and
+// the texture's format and layout, are built in: a draw picks one up front,
+// and no sample has to look at them again. Only for textures and samplers set
+// up the same way as the ones it was picked for.
+typedef void (*SampleQuadFunction)(
+    const Texture& texture, const SamplerState& sampler, const glm::vec2 texcoords[], float lod, uint32_t mask, glm::vec4 texels[]
+);
+SampleQuadFunction GetSampleQuadFunction(const Texture& texture, const SamplerState& sampler);
+
+
+#endif
@@ -0,0 +1,162 @@
+
+#include "ThreadPool.hpp"
+
+
+ThreadPool::ThreadPool(uint32_t threadCount) :
+    m_ThreadCount { threadCount == 0 ? 1 : threadCount },
+    m_Workers {},
+    m_Queues {},
+    m_Mutex {},
+    m_WakeCondition {},
+    m_DoneCondition {},
+    m_pFunc { nullptr },
+    m_Generation { 0 },
+    m_FinishedWorkers { 0 },
+    m_ShuttingDown { false }
+{
+    for (uint32_t i = 0; i < m_ThreadCount; i++)
+    {
+        m_Queues.push_back(std::make_unique<WorkQueue>());
+    }
+
+    // Thread 0 is whoever calls ParallelFor.
+    for (uint32_t i = 1; i < m_ThreadCount; i++)
+    {
+        m_Workers.emplace_back(&ThreadPool::WorkerMain, this, i);
+    }
+}
+
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock { m_Mutex };
+        m_ShuttingDown = true;
+    }
+    m_WakeCondition.notify_all();
+
+    for (auto& rWorker : m_Workers)
+    {
+        rWorker.join();
+    }
+}
+
+
+uint32_t ThreadPool::GetThreadCount() const
+{
+    return m_ThreadCount;
+}
+
+
+void ThreadPool::ParallelFor(uint32_t taskCount, const TaskFunction& func)
+{
+    if (m_Workers.empty() || taskCount <= 1)
+    {
+        for (uint32_t i = 0; i < taskCount; i++)
+        {
+            func(i, 0);
+        }
+        return;
+    }
+
+    // Hand out contiguous runs of tasks so that neighbouring tasks
+    // (which tend to touch neighbouring memory) start on the same thread.
+    for (uint32_t queueIndex = 0; queueIndex < m_ThreadCount; queueIndex++)
+    {
+        const uint32_t first = static_cast<uint32_t>(static_cast<uint64_t>(taskCount) * queueIndex / m_ThreadCount);
+        const uint32_t last = static_cast<uint32_t>(static_cast<uint64_t>(taskCount) * (queueIndex + 1) / m_ThreadCount);
+
+        auto& rQueue = *m_Queues[queueIndex];
+        std::lock_guard<std::mutex> lock { rQueue.mutex };
+        rQueue.next = first;
+        rQueue.end = last;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock { m_Mutex };
+        m_pFunc = &func;
+        m_FinishedWorkers = 0;
+        m_Generation++;
+    }
+    m_WakeCondition.notify_all();
+
+    RunTasks(0, func);
+
+    // Every worker has to check in, even if there was nothing left for it
+    // to steal, so that none of them can still be holding on to func
+    // when the next batch starts.
+    std::unique_lock<std::mutex> lock { m_Mutex };
+    m_DoneCondition.wait(lock, [this]() {
+        return m_FinishedWorkers == m_Workers.size();
+    });
+    m_pFunc = nullptr;
+}
+
+
+void ThreadPool::WorkerMain(uint32_t threadIndex)
+{
+    uint64_t seenGeneration = 0;
+    while (true)
+    {
+        const TaskFunction* pFunc;
+        {
+            std::unique_lock<std::mutex> lock { m_Mutex };
+            m_WakeCondition.wait(lock, [this, seenGeneration]() {
+                return m_ShuttingDown || m_Generation != seenGeneration;
+            });
+            if (m_ShuttingDown)
+            {
+                return;
+            }
+            seenGeneration = m_Generation;
+            pFunc = m_pFunc;
+        }
+
+        RunTasks(threadIndex, *pFunc);
+
+        {
+            std::lock_guard<std::mutex> lock { m_Mutex };
+            m_FinishedWorkers++;
+        }
+        m_DoneCondition.notify_all();
+    }
+}
+
+
+void ThreadPool::RunTasks(uint32_t threadIndex, const TaskFunction& func)
+{
+    uint32_t taskIndex;
+    while (PopTask(threadIndex, taskIndex))
+    {
+        func(taskIndex, threadIndex);
+    }
+}
+
+
+bool ThreadPool::PopTask(uint32_t threadIndex, uint32_t& rTaskIndex)
+{
+    // Take our own work in order first...
+    {
+        auto& rQueue = *m_Queues[threadIndex];
+        std::lock_guard<std::mutex> lock { rQueue.mutex };
+        if (rQueue.next != rQueue.end)
+        {
+            rTaskIndex = rQueue.next++;
+            return true;
+        }
+    }
+
+    // ...then steal from the far end of everyone else's.
+    for (uint32_t i = 1; i < m_ThreadCount; i++)
+    {
+        auto& rQueue = *m_Queues[(threadIndex + i) % m_ThreadCount];
+        std::lock_guard<std::mutex> lock { rQueue.mutex };
+        if (rQueue.next != rQueue.end)
+        {
+            rTaskIndex = --rQueue.end;
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,73 @@
+
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// A fixed set of worker threads which run batches of indexed tasks.
+//
+// Each thread owns a queue of task indices. When a thread runs out of its
+// own work it steals from the back of the other queues, so a few expensive
+// tasks (e.g. tiles with lots of overdraw) don't leave the other threads idle.
+class ThreadPool
+{
+public:
+
+    using TaskFunction = std::function<void(uint32_t taskIndex, uint32_t threadIndex)>;
+
+    // The thread count includes the thread calling ParallelFor,
+    // so a pool of one thread never starts any workers.
+    explicit ThreadPool(uint32_t threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    uint32_t GetThreadCount() const;
+
+    // Calls func once for every task index in [0, taskCount) and returns
+    // once all of them have finished. The calling thread runs tasks too,
+    // as thread index 0.
+    void ParallelFor(uint32_t taskCount, const TaskFunction& func);
+
+private:
+
+    // Each queue is handed a contiguous run of tasks, [next, end).
+    struct WorkQueue
+    {
+        WorkQueue() : mutex {}, next {0}, end {0} {}
+
+        std::mutex mutex;
+        uint32_t next;
+        uint32_t end;
+    };
+
+    void WorkerMain(uint32_t threadIndex);
+    void RunTasks(uint32_t threadIndex, const TaskFunction& func);
+    bool PopTask(uint32_t threadIndex, uint32_t& rTaskIndex);
+
+
+    const uint32_t m_ThreadCount;
+    std::vector<std::thread> m_Workers;
+    std::vector<std::unique_ptr<WorkQueue>> m_Queues;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_WakeCondition;
+    std::condition_variable m_DoneCondition;
+    const TaskFunction* m_pFunc;
+    uint64_t m_Generation;
+    uint32_t m_FinishedWorkers;
+    bool m_ShuttingDown;
+
+};
+
+
+#endif
@@ -2,8 +2,11 @@
 #ifndef VERTEX_HPP
 #define VERTEX_HPP
 
+#include <stdint.h>
 #include <glm/glm.hpp>
 
+#include <array>
+
 
 struct Vertex
 {
@@ -11,11 +14,11 @@ struct Vertex
     glm::vec3 color;
     glm::vec2 texcoords;
 
-    // TODO: This is only on the internal vertex, and should be
-    // cached instead of computed every time.
-    float oneOverW()
+    Vertex() :
+        position {},
+        color {},
+        texcoords {}
     {
-        return 1.0 / position.w;
     }
 
     Vertex(glm::vec3 p, glm::vec3 c, glm::vec2 t) :
@@ -39,4 +42,14 @@ struct Vertex
 };
 
 
+// A vertex inside the renderer, being put together into a triangle
+// and clipped, with the N varyings of the buffer it came from.
+template <uint32_t N>
+struct ClipVertex
+{
+    glm::vec4 position;
+    std::array<float, N> varyings;
+};
+
+
 #endif
@@ -0,0 +1,161 @@
+
+#include <algorithm>
+#include <cassert>
+
+#include "VertexBuffer.hpp"
+
+
+VertexBuffer::VertexBuffer() :
+    VertexBuffer { VERTEX_VARYING_COUNT }
+{
+}
+
+
+VertexBuffer::VertexBuffer(uint32_t varyingCount) :
+    m_VertexCount {0},
+    m_VaryingCount { varyingCount },
+    m_Positions {},
+    m_Varyings {}
+{
+    assert(varyingCount <= VERTEX_MAX_VARYINGS);
+}
+
+
+VertexBuffer::VertexBuffer(const std::vector<Vertex>& vertices) :
+    VertexBuffer {}
+{
+    Resize(vertices.size());
+    for (uint32_t i = 0; i < vertices.size(); i++)
+    {
+        SetVertex(i, vertices[i]);
+    }
+}
+
+
+uint32_t VertexBuffer::GetVertexCount() const
+{
+    return m_VertexCount;
+}
+
+
+uint32_t VertexBuffer::GetBatchCount() const
+{
+    return GetStreams().GetBatchCount();
+}
+
+
+uint32_t VertexBuffer::GetVaryingCount() const
+{
+    return m_VaryingCount;
+}
+
+
+void VertexBuffer::Resize(uint32_t vertexCount)
+{
+    m_VertexCount = vertexCount;
+    const uint32_t paddedCount = GetBatchCount() * VERTEX_BATCH_SIZE;
+    for (uint32_t i = 0; i < VERTEX_POSITION_STREAMS; i++)
+    {
+        // Padding is a valid point, just in case.
+        const float fill = static_cast<VertexStream>(i) == VertexStream::PositionW ? 1.0f : 0.0f;
+        m_Positions[i].resize(paddedCount, fill);
+    }
+    for (uint32_t i = 0; i < m_VaryingCount; i++)
+    {
+        m_Varyings[i].resize(paddedCount, 0.0f);
+    }
+}
+
+
+void VertexBuffer::SetVertex(uint32_t index, const Vertex& vertex)
+{
+    assert(index < m_VertexCount);
+    GetStream(VertexStream::PositionX)[index] = vertex.position.x;
+    GetStream(VertexStream::PositionY)[index] = vertex.position.y;
+    GetStream(VertexStream::PositionZ)[index] = vertex.position.z;
+    GetStream(VertexStream::PositionW)[index] = vertex.position.w;
+
+    const float varyings[VERTEX_VARYING_COUNT] = {
+        vertex.color.r,
+        vertex.color.g,
+        vertex.color.b,
+        vertex.texcoords.x,
+        vertex.texcoords.y,
+    };
+    for (uint32_t i = 0; i < std::min(m_VaryingCount, VERTEX_VARYING_COUNT); i++)
+    {
+        GetVaryingStream(i)[index] = varyings[i];
+    }
+}
+
+
+Vertex VertexBuffer::GetVertex(uint32_t index) const
+{
+    assert(index < m_VertexCount);
+    float varyings[VERTEX_VARYING_COUNT] {};
+    for (uint32_t i = 0; i < std::min(m_VaryingCount, VERTEX_VARYING_COUNT); i++)
+    {
+        varyings[i] = GetVaryingStream(i)[index];
+    }
+
+    return {
+        glm::vec4 {
+            GetStream(VertexStream::PositionX)[index],
+            GetStream(VertexStream::PositionY)[index],
+            GetStream(VertexStream::PositionZ)[index],
+            GetStream(VertexStream::PositionW)[index],
+        },
+        {
+            varyings[static_cast<uint32_t>(VertexVarying::ColorR)],
+            varyings[static_cast<uint32_t>(VertexVarying::ColorG)],
+            varyings[static_cast<uint32_t>(VertexVarying::ColorB)],
+        },
+        {
+            varyings[static_cast<uint32_t>(VertexVarying::TexcoordU)],
+            varyings[static_cast<uint32_t>(VertexVarying::TexcoordV)],
+        }
+    };
+}
+
+
+float* VertexBuffer::GetStream(VertexStream stream)
+{
+    return m_Positions[static_cast<uint32_t>(stream)].data();
+}
+
+
+const float* VertexBuffer::GetStream(VertexStream stream) const
+{
+    return m_Positions[static_cast<uint32_t>(stream)].data();
+}
+
+
+float* VertexBuffer::GetVaryingStream(uint32_t index)
+{
+    assert(index < m_VaryingCount);
+    return m_Varyings[index].data();
+}
+
+
+const float* VertexBuffer::GetVaryingStream(uint32_t index) const
+{
+    assert(index < m_VaryingCount);
+    return m_Varyings[index].data();
+}
+
+
+VertexStreams VertexBuffer::GetStreams() const
+{
+    VertexStreams streams {};
+    for (uint32_t i = 0; i < VERTEX_POSITION_STREAMS; i++)
+    {
+        streams.pPositions[i] = m_Positions[i].data();
+    }
+    for (uint32_t i = 0; i < m_VaryingCount; i++)
+    {
+        streams.pVaryings[i] = m_Varyings[i].data();
+    }
+    streams.varyingCount = m_VaryingCount;
+    streams.vertexCount = m_VertexCount;
+    return streams;
+}
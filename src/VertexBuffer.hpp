@@ -0,0 +1,119 @@
+
+#ifndef VERTEX_BUFFER_HPP
+#define VERTEX_BUFFER_HPP
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "AlignedAllocator.hpp"
+#include "Vertex.hpp"
+
+
+// Vertices are transformed this many at a time, so every
+// stream is padded out to a whole number of batches.
+const uint32_t VERTEX_BATCH_SIZE = 8;
+
+// Streams are aligned for the widest SIMD loads.
+const size_t VERTEX_STREAM_ALIGNMENT = 32;
+
+
+// A vertex's position is four streams.
+enum class VertexStream
+{
+    PositionX,
+    PositionY,
+    PositionZ,
+    PositionW,
+};
+
+const uint32_t VERTEX_POSITION_STREAMS = 4;
+
+
+// Everything else about a vertex is one of its varyings: a stream of its
+// own, interpolated across triangles. The ones here are a Vertex's, which
+// the renderer shades with. Buffers can have more after them, up to
+// VERTEX_MAX_VARYINGS, such as normals or a second set of texture coordinates.
+enum class VertexVarying
+{
+    ColorR,
+    ColorG,
+    ColorB,
+    TexcoordU,
+    TexcoordV,
+};
+
+const uint32_t VERTEX_VARYING_COUNT = 5;
+const uint32_t VERTEX_MAX_VARYINGS = 8;
+
+
+// The streams of a VertexBuffer, or of vertices converted into
+// some other (padded and aligned) storage, to draw from.
+struct VertexStreams
+{
+    const float* pPositions[VERTEX_POSITION_STREAMS];
+    const float* pVaryings[VERTEX_MAX_VARYINGS];
+    uint32_t varyingCount;
+    uint32_t vertexCount;
+
+    const float* Get(VertexStream stream) const
+    {
+        return pPositions[static_cast<uint32_t>(stream)];
+    }
+
+    const float* GetVarying(uint32_t index) const
+    {
+        return pVaryings[index];
+    }
+
+    uint32_t GetBatchCount() const
+    {
+        return (vertexCount + VERTEX_BATCH_SIZE - 1) / VERTEX_BATCH_SIZE;
+    }
+};
+
+
+// Vertex attributes as a structure of arrays: each component
+// is its own aligned stream, so that a batch of vertices can be
+// loaded straight into SIMD registers.
+class VertexBuffer
+{
+public:
+
+    // With a Vertex's varyings.
+    VertexBuffer();
+
+    // With varyingCount of them, up to VERTEX_MAX_VARYINGS.
+    explicit VertexBuffer(uint32_t varyingCount);
+
+    // Converts from an array of Vertex structures.
+    explicit VertexBuffer(const std::vector<Vertex>& vertices);
+
+    uint32_t GetVertexCount() const;
+    uint32_t GetBatchCount() const;
+    uint32_t GetVaryingCount() const;
+
+    void Resize(uint32_t vertexCount);
+
+    // Only the varyings the buffer has are set. Ones it
+    // doesn't have come back as 0 from GetVertex.
+    void SetVertex(uint32_t index, const Vertex& vertex);
+    Vertex GetVertex(uint32_t index) const;
+
+    float* GetStream(VertexStream stream);
+    const float* GetStream(VertexStream stream) const;
+    float* GetVaryingStream(uint32_t index);
+    const float* GetVaryingStream(uint32_t index) const;
+    VertexStreams GetStreams() const;
+
+private:
+
+    uint32_t m_VertexCount;
+    uint32_t m_VaryingCount;
+    AlignedVector<float, VERTEX_STREAM_ALIGNMENT> m_Positions[VERTEX_POSITION_STREAMS];
+    AlignedVector<float, VERTEX_STREAM_ALIGNMENT> m_Varyings[VERTEX_MAX_VARYINGS];
+
+};
+
+
+#endif
@@ -0,0 +1,71 @@
+
+#include "VertexTransform.hpp"
+
+
+// The reference kernel. Sums the products in the same order as glm does,
+// and the SIMD kernels must do the same.
+void TransformPositionsScalar(const glm::mat4& matrix, const float* const pPositions[4], float* const pClipPositions[4], uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const float x = pPositions[0][i];
+        const float y = pPositions[1][i];
+        const float z = pPositions[2][i];
+        const float w = pPositions[3][i];
+        for (int row = 0; row < 4; row++)
+        {
+            pClipPositions[row][i] =
+                (matrix[0][row] * x + matrix[1][row] * y) +
+                (matrix[2][row] * z + matrix[3][row] * w);
+        }
+    }
+}
+
+
+void ComputeOutcodes(const float* const pClipPositions[4], uint8_t* pOutcodes, uint32_t count)
+{
+    const float* pX = pClipPositions[0];
+    const float* pY = pClipPositions[1];
+    const float* pZ = pClipPositions[2];
+    const float* pW = pClipPositions[3];
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const float guardBand = CLIP_GUARD_BAND * pW[i];
+        pOutcodes[i] =
+            (pX[i] > pW[i] ? OUTCODE_POSITIVE_X : 0) |
+            (pX[i] < -pW[i] ? OUTCODE_NEGATIVE_X : 0) |
+            (pY[i] > pW[i] ? OUTCODE_POSITIVE_Y : 0) |
+            (pY[i] < -pW[i] ? OUTCODE_NEGATIVE_Y : 0) |
+            (pZ[i] > pW[i] ? OUTCODE_FAR : 0) |
+            (pZ[i] < -pW[i] ? OUTCODE_NEAR : 0) |
+            (pX[i] > guardBand || pX[i] < -guardBand ? OUTCODE_GUARD_BAND_X : 0) |
+            (pY[i] > guardBand || pY[i] < -guardBand ? OUTCODE_GUARD_BAND_Y : 0);
+    }
+}
+
+
+const std::vector<TransformKernel>& GetAvailableTransformKernels()
+{
+    static const std::vector<TransformKernel> kernels = []() {
+        std::vector<TransformKernel> available { { "scalar", TransformPositionsScalar } };
+#ifdef GPU_X86_KERNELS
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("sse4.1"))
+        {
+            available.push_back({ "sse4", TransformPositionsSSE4 });
+        }
+        if (__builtin_cpu_supports("avx2"))
+        {
+            available.push_back({ "avx2", TransformPositionsAVX2 });
+        }
+#endif
+        return available;
+    }();
+    return kernels;
+}
+
+
+const TransformKernel& GetTransformKernel()
+{
+    return GetAvailableTransformKernels().back();
+}
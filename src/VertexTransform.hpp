@@ -0,0 +1,67 @@
+
+#ifndef VERTEX_TRANSFORM_HPP
+#define VERTEX_TRANSFORM_HPP
+
+#include <stdint.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "VertexBuffer.hpp"
+
+
+// Multiplies count positions (a multiple of VERTEX_BATCH_SIZE) by the matrix.
+// Both are streams of x, y, z and w. Every kernel gives exactly the same
+// results as glm's matrix * vector.
+typedef void (*TransformFunction)(const glm::mat4& matrix, const float* const pPositions[4], float* const pClipPositions[4], uint32_t count);
+
+
+struct TransformKernel
+{
+    const char* name;
+    TransformFunction function;
+};
+
+
+// Every kernel this CPU can run, starting with the scalar fallback.
+const std::vector<TransformKernel>& GetAvailableTransformKernels();
+
+// The fastest kernel this CPU can run, picked the first time it is asked for.
+const TransformKernel& GetTransformKernel();
+
+
+// X and Y are only clipped against a guard band this many times the size of
+// the viewport. Anything inside it can be rasterized as it is, since the
+// rasterizer only visits pixels in the frame anyway.
+const float CLIP_GUARD_BAND = 4.0f;
+
+// Outcode bits, for the planes of the view volume a clip space position is outside of.
+const uint8_t OUTCODE_POSITIVE_X = 0x01;     // x > w
+const uint8_t OUTCODE_NEGATIVE_X = 0x02;     // x < -w
+const uint8_t OUTCODE_POSITIVE_Y = 0x04;     // y > w
+const uint8_t OUTCODE_NEGATIVE_Y = 0x08;     // y < -w
+const uint8_t OUTCODE_FAR = 0x10;            // z > w
+const uint8_t OUTCODE_NEAR = 0x20;           // z < -w
+const uint8_t OUTCODE_GUARD_BAND_X = 0x40;   // |x| > CLIP_GUARD_BAND * w
+const uint8_t OUTCODE_GUARD_BAND_Y = 0x80;   // |y| > CLIP_GUARD_BAND * w
+
+// A triangle with every vertex outside one of these planes can't be seen.
+const uint8_t OUTCODE_REJECT = 0x3f;
+
+// A triangle with any vertex outside one of these planes has to be clipped.
+const uint8_t OUTCODE_CLIP = OUTCODE_NEAR | OUTCODE_FAR | OUTCODE_GUARD_BAND_X | OUTCODE_GUARD_BAND_Y;
+
+
+// Works out the outcode of each of count clip space positions.
+void ComputeOutcodes(const float* const pClipPositions[4], uint8_t* pOutcodes, uint32_t count);
+
+
+void TransformPositionsScalar(const glm::mat4& matrix, const float* const pPositions[4], float* const pClipPositions[4], uint32_t count);
+
+#ifdef GPU_X86_KERNELS
+void TransformPositionsSSE4(const glm::mat4& matrix, const float* const pPositions[4], float* const pClipPositions[4], uint32_t count);
+void TransformPositionsAVX2(const glm::mat4& matrix, const float* const pPositions[4], float* const pClipPositions[4], uint32_t count);
+#endif
+
+
+#endif
@@ -0,0 +1,34 @@
+
+// Built with -mavx2, and only called if the CPU supports it.
+
+#include <immintrin.h>
+
+#include "VertexTransform.hpp"
+
+
+void TransformPositionsAVX2(const glm::mat4& matrix, const float* const pPositions[4], float* const pClipPositions[4], uint32_t count)
+{
+    __m256 m[4][4];
+    for (int column = 0; column < 4; column++)
+    {
+        for (int row = 0; row < 4; row++)
+        {
+            m[column][row] = _mm256_set1_ps(matrix[column][row]);
+        }
+    }
+
+    // Eight vertices at a time, one output component per row of the matrix.
+    for (uint32_t i = 0; i < count; i += 8)
+    {
+        const __m256 x = _mm256_load_ps(&pPositions[0][i]);
+        const __m256 y = _mm256_load_ps(&pPositions[1][i]);
+        const __m256 z = _mm256_load_ps(&pPositions[2][i]);
+        const __m256 w = _mm256_load_ps(&pPositions[3][i]);
+        for (int row = 0; row < 4; row++)
+        {
+            const __m256 xy = _mm256_add_ps(_mm256_mul_ps(m[0][row], x), _mm256_mul_ps(m[1][row], y));
+            const __m256 zw = _mm256_add_ps(_mm256_mul_ps(m[2][row], z), _mm256_mul_ps(m[3][row], w));
+            _mm256_store_ps(&pClipPositions[row][i], _mm256_add_ps(xy, zw));
+        }
+    }
+}
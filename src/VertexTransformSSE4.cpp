@@ -0,0 +1,34 @@
+
+// Built with -msse4.1, and only called if the CPU supports it.
+
+#include <smmintrin.h>
+
+#include "VertexTransform.hpp"
+
+
+void TransformPositionsSSE4(const glm::mat4& matrix, const float* const pPositions[4], float* const pClipPositions[4], uint32_t count)
+{
+    __m128 m[4][4];
+    for (int column = 0; column < 4; column++)
+    {
+        for (int row = 0; row < 4; row++)
+        {
+            m[column][row] = _mm_set1_ps(matrix[column][row]);
+        }
+    }
+
+    // Four vertices at a time, one output component per row of the matrix.
+    for (uint32_t i = 0; i < count; i += 4)
+    {
+        const __m128 x = _mm_load_ps(&pPositions[0][i]);
+        const __m128 y = _mm_load_ps(&pPositions[1][i]);
+        const __m128 z = _mm_load_ps(&pPositions[2][i]);
+        const __m128 w = _mm_load_ps(&pPositions[3][i]);
+        for (int row = 0; row < 4; row++)
+        {
+            const __m128 xy = _mm_add_ps(_mm_mul_ps(m[0][row], x), _mm_mul_ps(m[1][row], y));
+            const __m128 zw = _mm_add_ps(_mm_mul_ps(m[2][row], z), _mm_mul_ps(m[3][row], w));
+            _mm_store_ps(&pClipPositions[row][i], _mm_add_ps(xy, zw));
+        }
+    }
+}
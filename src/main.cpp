@@ -1,13 +1,18 @@
 
 #include <stdint.h>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <thread>
 
 #include <SDL2/SDL.h>
 #include <glm/gtc/matrix_transform.hpp>
 #include <stb_image.h>
 
+#include "Scene.hpp"
 #include "SoftwareRenderer.hpp"
 #include "Vertex.hpp"
+#include "VertexBuffer.hpp"
 
 
 const uint32_t FRAME_SCALING = 1;
@@ -18,13 +23,26 @@ const uint32_t DISPLAY_SCALING = 2;
 const uint32_t DISPLAY_WIDTH = FRAME_WIDTH * DISPLAY_SCALING;
 const uint32_t DISPLAY_HEIGHT = FRAME_HEIGHT * DISPLAY_SCALING;
 
+// Frames can be drawn while up to two others wait to be presented.
+const uint32_t SWAP_CHAIN_LENGTH = 3;
+const std::chrono::microseconds FRAME_INTERVAL { 1000000 / 60 };
 
-std::vector<Vertex> MakeMesh()
+
+struct Mesh
 {
-    // "VBO" (TODO: Use indexing to render, rather than duplicating vertices)
-    std::vector<Vertex> mesh;
+    VertexBuffer vertices;
+    std::vector<uint16_t> indices;
+};
+
 
-    auto makeSide = [&mesh](const glm::vec3& axis, float angle, const glm::vec3& color) {
+Mesh MakeMesh()
+{
+    // Each side has its own color and texture coordinates,
+    // so only its two triangles share vertices.
+    std::vector<Vertex> vertices;
+    std::vector<uint16_t> indices;
+
+    auto makeSide = [&vertices, &indices](const glm::vec3& axis, float angle, const glm::vec3& color) {
         glm::mat4 transform { 1.0 };
         transform = glm::rotate(transform, angle, axis);
 
@@ -38,17 +56,18 @@ std::vector<Vertex> MakeMesh()
         glm::vec2 tex_downLeft = {0.0, 0.0};
         glm::vec2 tex_downRight = {1.0, 0.0};
 
-        glm::vec3 red     = {1.0, 0.0, 0.0};
-        glm::vec3 green   = {0.0, 1.0, 0.0};
-        glm::vec3 blue    = {0.0, 0.0, 1.0};
-
-        mesh.push_back({top_downLeft, color, tex_downLeft});
-        mesh.push_back({top_downRight, color, tex_downRight});
-        mesh.push_back({top_upLeft, color, tex_upLeft});
+        const uint16_t base = vertices.size();
+        vertices.push_back({top_downLeft, color, tex_downLeft});
+        vertices.push_back({top_downRight, color, tex_downRight});
+        vertices.push_back({top_upLeft, color, tex_upLeft});
+        vertices.push_back({top_upRight, color, tex_upRight});
 
-        mesh.push_back({top_downRight, color, tex_downRight});
-        mesh.push_back({top_upRight, color, tex_upRight});
-        mesh.push_back({top_upLeft, color, tex_upLeft});
+        const uint16_t downLeft = base + 0;
+        const uint16_t downRight = base + 1;
+        const uint16_t upLeft = base + 2;
+        const uint16_t upRight = base + 3;
+        indices.insert(indices.end(), { downLeft, downRight, upLeft });
+        indices.insert(indices.end(), { downRight, upRight, upLeft });
 
     };
 
@@ -68,7 +87,7 @@ std::vector<Vertex> MakeMesh()
     makeSide(left, static_cast<float>(glm::radians(90.0f)), blue);  // BACKWARD)
     makeSide(left, static_cast<float>(glm::radians(270.0f)), yellow);  // FORWARD)
 
-    return mesh;
+    return { VertexBuffer { vertices }, indices };
 }
 
 
@@ -103,7 +122,7 @@ uint32_t MakeCheckerboardTexture(SoftwareRenderer& rContext, bool hollowCenters
     }
 
     uint32_t textureID = rContext.CreateTexture();
-    rContext.UpdateTexture(textureID, TEXTURE_WIDTH, TEXTURE_HEIGHT, &data[0]);
+    rContext.UpdateTexture(textureID, TEXTURE_WIDTH, TEXTURE_HEIGHT, &data[0], TextureFormat::RGBA8, TextureLayout::Tiled, true);
     return textureID;
 }
 
@@ -131,7 +150,7 @@ uint32_t MakeTextureFromFile(SoftwareRenderer& rContext, const char* filename)
     stbi_image_free(pRawData);
 
     uint32_t textureID = rContext.CreateTexture();
-    rContext.UpdateTexture(textureID, width, height, &data[0]);
+    rContext.UpdateTexture(textureID, width, height, &data[0], TextureFormat::RGBA8, TextureLayout::Tiled, true);
     return textureID;
 }
 
@@ -161,6 +180,10 @@ int main(int argc, char** argv)
         return 1;
     }
 
+    RendererOptions options;
+    options.swapChainLength = SWAP_CHAIN_LENGTH;
+    SoftwareRenderer context {FRAME_WIDTH, FRAME_HEIGHT, options};
+
     SDL_Renderer* pRenderer = SDL_CreateRenderer(pWindow, -1, SDL_RENDERER_ACCELERATED);
     if (pRenderer == nullptr)
     {
@@ -176,7 +199,20 @@ int main(int argc, char** argv)
         FRAME_HEIGHT
     );
 
-    SoftwareRenderer context {FRAME_WIDTH, FRAME_HEIGHT};
+    using Clock = std::chrono::steady_clock;
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    // SDL must only be called from this thread, so each frame is shown here,
+    // straight from its swap chain buffer, as Present hands it back. The
+    // presenter thread only paces: it holds each buffer until the frame's
+    // slot comes round, so Present waits for a buffer once this thread gets
+    // two frames ahead. The upload and present still take turns with drawing,
+    // since drawing happens on this thread as well.
+    Clock::time_point nextSlot = Clock::now();
+    context.SetPresentFunction([&nextSlot](const uint8_t*) {
+        nextSlot = std::max(nextSlot + FRAME_INTERVAL, Clock::now());
+        std::this_thread::sleep_until(nextSlot);
+    });
 
     auto texture = MakeCheckerboardTexture(context);
     auto texture2 = MakeTextureFromFile(context, "textures/moon.png");
@@ -186,8 +222,16 @@ int main(int argc, char** argv)
         return 1;
     }
 
-    auto cube1 = MakeMesh();
-    auto cube2 = MakeMesh();
+    // The checkerboard keeps its hard edges, but the moon is smoothed.
+    auto bilinearSampler = context.CreateSampler({TextureWrap::Repeat, TextureWrap::Repeat, TextureFilter::Bilinear, MipFilter::Linear});
+
+    auto cube = MakeMesh();
+
+    // Model matrices are set every frame.
+    Scene scene;
+    const uint32_t cubeObject1 = scene.AddObject(cube.vertices, cube.indices, glm::mat4 {1.0}, texture, 0);
+    const uint32_t cubeObject2 = scene.AddObject(cube.vertices, cube.indices, glm::mat4 {1.0}, texture2, bilinearSampler);
+    CommandBuffer commands;
 
     float cameraRoll = 0.0;
     float cameraPitch = 0.0;
@@ -197,10 +241,23 @@ int main(int argc, char** argv)
     float cameraY = 0;
     float cameraZ = 10;
 
+    // Drawing time, the time taken to upload and present each frame, and
+    // the time spent waiting on the swap chain are reported once a second.
+    Clock::time_point lastFrameStart = Clock::now();
+    Clock::time_point reportStart = lastFrameStart;
+    uint32_t reportFrames = 0;
+    double reportCpuMilliseconds = 0.0;
+    double reportPresentMilliseconds = 0.0;
+    PresentStats reportPresentStats = context.GetPresentStats();
+
     float t = 0;
     bool isRunning = true;
     while (isRunning)
     {
+        const Clock::time_point frameStart = Clock::now();
+        t += std::chrono::duration<float>(frameStart - lastFrameStart).count();
+        lastFrameStart = frameStart;
+
         SDL_Event event;
         while (SDL_PollEvent(&event))
         {
@@ -278,17 +335,13 @@ int main(int argc, char** argv)
         model2 = glm::translate(model2, glm::vec3 {10.0, 0.0, 0.0});
         model2 = glm::rotate(model2, static_cast<float>(glm::radians(180.0)), glm::vec3 {0.0, 1.0, 0.0});
 
-        context.SetProjectionMatrix(glm::perspective(
+        const glm::mat4 projection = glm::perspective(
             glm::radians(45.0f),
             static_cast<float>(FRAME_WIDTH) / static_cast<float>(FRAME_HEIGHT),
             5.0f,
             100.0f
-        ));
-
-        // Take the inverse of the projection matrix to find clipping planes.
-        //
-        // Compare bounding spheres of potential objects to draw with frustum
-        // planes to do coarse pruning of objects to draw to draw.
+        );
+        context.SetProjectionMatrix(projection);
 
         float cameraRadius = 30.0;
         float cameraAngle = 45.0;
@@ -298,7 +351,6 @@ int main(int argc, char** argv)
             cameraRadius * std::sin(glm::radians(cameraAngle)),
             cameraRadius * std::cos(glm::radians(cameraAngle))
         };
-        std::cout << cameraX << std::endl;
 
         glm::vec3 target = {-cameraX, 0.0, 0.0};
         glm::vec3 up = {0.0, 1.0, 0.0};
@@ -310,31 +362,67 @@ int main(int argc, char** argv)
 
         context.Clear(0x64, 0x95, 0xed);
 
-        context.UseTexture(texture);
-        // context.UseTexture(texture2);
-        context.SetViewModelMatrix(view * model1);
-        context.DrawTriangleList(cube1);
+        // Only the cubes which might be in view are drawn, and
+        // the ones entirely in view aren't clipped.
+        scene.SetModelMatrix(cubeObject1, model1);
+        scene.SetModelMatrix(cubeObject2, model2);
+        commands.Reset();
+        scene.Cull(projection, view, commands);
+        context.Submit(commands);
+
+        context.Flush();
+        reportCpuMilliseconds += Milliseconds(Clock::now() - frameStart).count();
+        reportFrames++;
 
-        context.UseTexture(texture2);
-        context.SetViewModelMatrix(view * model2);
-        context.DrawTriangleList(cube2);
+        // Waits only if every other buffer is still queued to be presented,
+        // which is what keeps this loop to the presenter's pace.
+        const uint8_t* pFrame = context.Present();
 
+        const Clock::time_point presentStart = Clock::now();
         // TODO: Use the SDL_PixelFormat struct to get rid of the 4 magic number
-        SDL_UpdateTexture(pDisplayTexture, NULL, context.GetFramebufferPointer(), FRAME_WIDTH * 4);
+        SDL_UpdateTexture(pDisplayTexture, NULL, pFrame, FRAME_WIDTH * 4);
         SDL_RenderCopy(pRenderer, pDisplayTexture, NULL, NULL);
         SDL_RenderPresent(pRenderer);
+        reportPresentMilliseconds += Milliseconds(Clock::now() - presentStart).count();
+
+        const Clock::time_point now = Clock::now();
+        if (now - reportStart >= std::chrono::seconds { 1 })
+        {
+            const PresentStats presentStats = context.GetPresentStats();
+            const double waitMilliseconds = presentStats.waitMilliseconds - reportPresentStats.waitMilliseconds;
 
-        // TODO: Use std::chrono
-        SDL_Delay(16);
-        t += 0.016;
+            std::cout << "FPS: " << reportFrames / std::chrono::duration<double>(now - reportStart).count()
+                      << "  CPU: " << reportCpuMilliseconds / reportFrames << " ms"
+                      << "  present: " << reportPresentMilliseconds / reportFrames << " ms"
+                      << "  waiting for a buffer: " << waitMilliseconds / reportFrames << " ms"
+                      << std::endl;
 
+            // The frame just presented, up to the next Clear.
+            if (PIPELINE_STATS_ENABLED)
+            {
+                const PipelineStats pipelineStats = context.GetPipelineStats();
+                std::cout << "  triangles: " << pipelineStats.trianglesRasterized << " of " << pipelineStats.trianglesSubmitted << " drawn"
+                          << "  pixels written: " << pipelineStats.pixelsWritten
+                          << "  geometry: " << pipelineStats.geometryNanoseconds / 1e6 << " ms"
+                          << "  raster: " << pipelineStats.rasterNanoseconds / 1e6 << " ms"
+                          << "  flush: " << pipelineStats.flushNanoseconds / 1e6 << " ms"
+                          << std::endl;
+            }
+
+            reportStart = now;
+            reportFrames = 0;
+            reportCpuMilliseconds = 0.0;
+            reportPresentMilliseconds = 0.0;
+            reportPresentStats = presentStats;
+        }
     }
 
     context.DestroyTexture(texture);
     context.DestroyTexture(texture2);
 
-    SDL_DestroyTexture(pDisplayTexture);
-    SDL_DestroyRenderer(pRenderer);
+    // Lets the presenter finish pacing, and stops it. Destroying the
+    // window destroys its renderer and texture as well.
+    context.SetPresentFunction(nullptr);
     SDL_DestroyWindow(pWindow);
     SDL_Quit();
 }